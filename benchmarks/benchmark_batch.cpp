@@ -0,0 +1,83 @@
+/*
+	Measures the throughput, in tickers per second, of the batch engine (bev::SolveBatch, see batch.h) on a universe of
+	n_tickers price series made by writing copies of the given CSV (half as CSVs, half as price caches) to the working
+	directory, removed afterwards. Compares against solving the tickers one after another with a BEV object each, and 
+	checks that every batch surface is identical to the one solved directly.
+
+	Usage:	benchmark_batch [path to CSV, default ../GOOG.csv] [number of tickers, default 256] [threads, default all cores]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_batch benchmark_batch.cpp ../bev/batch.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/mapped_file.cpp ../bev/utils/csv_loader.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo), where the run_benchmark_batch target builds and runs it.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "batch.h"
+#include "csv_loader.h"
+#include "price_cache.h"
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	int n_tickers = argc > 2 ? std::stoi(argv[2]) : 256;
+	int n_threads = argc > 3 ? std::stoi(argv[3]) : (int) std::thread::hardware_concurrency();
+
+	// build the universe
+	data_utils::CSVColumns columns;
+	data_utils::CSVStatus status = data_utils::LoadCSVColumns(csv_path, {"Close"}, columns);
+	if (status != data_utils::CSVStatus::Ok) {
+		std::cout << "Could not load " << csv_path << ": " << data_utils::CSVStatusMessage(status) << std::endl;
+		return 1;
+	}
+	std::ifstream csv(csv_path);
+	std::stringstream text;
+	text << csv.rdbuf();
+	std::vector<std::string> paths;
+	for (int i = 0; i < n_tickers; i++) {
+		if (i % 2 == 0) {
+			paths.push_back("benchmark_batch_" + std::to_string(i) + ".csv");
+			std::ofstream(paths.back()) << text.str();
+		}
+		else {
+			paths.push_back("benchmark_batch_" + std::to_string(i) + ".bevc");
+			data_utils::WritePriceCache(paths.back(), columns);
+		}
+	}
+
+	bev::BatchSettings settings;
+	settings.strikes = {0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.15, 1.2};
+	settings.maturities = {1, 2, 3, 6, 9, 12};
+	settings.n_threads = n_threads;
+
+	// one ticker after another
+	auto start = std::chrono::steady_clock::now();
+	Eigen::ArrayXXd expected;
+	for (int i = 0; i < n_tickers; i++) {
+		data_utils::CSVColumns series;
+		data_utils::LoadCSVColumns(csv_path, {"Close"}, series);
+		bev::BEV bev(series.values, settings.interest_rate, settings.strikes, settings.maturities);
+		expected = bev.SolveForBEV();
+	}
+	double serial_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	bool identical = true;
+	bev::BatchStats stats = bev::SolveBatch(paths, settings, [&] (const bev::SeriesResult& result) {
+		identical = identical && result.error.empty() && (result.surface == expected).all();
+	});
+
+	std::cout << n_tickers << " tickers, " << settings.strikes.size() << " strikes x " << settings.maturities.size() << " maturities" << std::endl;
+	std::cout << "  one at a time:           " << n_tickers / serial_seconds << " tickers/s" << std::endl;
+	std::cout << "  SolveBatch, " << n_threads << " threads:   " << stats.SeriesPerSecond() << " tickers/s (" << serial_seconds / stats.seconds << "x)" << std::endl;
+	std::cout << "  surfaces identical: " << (identical ? "yes" : "NO") << ", failed: " << stats.n_failed << std::endl;
+
+	for (const std::string& path : paths)
+		std::remove(path.c_str());
+	return 0;
+}
@@ -0,0 +1,62 @@
+/*
+	Times BEV::Bootstrap on the GOOG surface: percentile bands from n_resamples resamples of the subpaths of every 
+	maturity, drawing single subpaths and blocks of consecutive subpaths, averaging PnLs and averaging subpath BEVs. 
+	Also checks that the bands are the same with and without a thread pool.
+
+	Usage:	benchmark_bootstrap [number of resamples, default 10000] [threads, default 4]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_bootstrap benchmark_bootstrap.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+
+using bev::BEV;
+using bev::BootstrapBands;
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintBands(const BootstrapBands& bands, const std::vector<int>& maturities) {
+	std::cout << std::setprecision(4);
+	for (int row = 0; row < (int) maturities.size(); row++) {
+		std::cout << "    " << std::setw(2) << maturities[row] << "m:";
+		for (int col = 0; col < bands.estimate.cols(); col++)
+			std::cout << "  " << bands.estimate(row, col) << " [" << bands.bands.front()(row, col) << ", " << bands.bands.back()(row, col) << "]";
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int n_resamples = argc > 1 ? std::stoi(argv[1]) : 10000;
+	int n_threads = argc > 2 ? std::stoi(argv[2]) : 4;
+	std::vector<double> strikes = {0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.15, 1.2};
+	std::vector<int> maturities = {1, 2, 3, 6, 9, 12};
+	BEV bev("../GOOG.csv", 0.015, strikes, maturities, -1, true, "Close");
+
+	std::cout << n_resamples << " resamples of a " << maturities.size() << " x " << strikes.size() << " surface, 90% bands" << std::fixed << std::endl;
+	struct Case { const char* name; bool average_pnls; int block_length; };
+	for (Case c : {Case{"average PnL, single subpaths", true, 1}, Case{"average PnL, blocks of 3 subpaths", true, 3}, Case{"average subpath BEVs, single subpaths", false, 1}}) {
+		bev.SetThreadCount(1);
+		auto start = std::chrono::steady_clock::now();
+		BootstrapBands serial = bev.Bootstrap(n_resamples, {0.05, 0.95}, c.average_pnls, c.block_length);
+		double serial_seconds = SecondsSince(start);
+		bev.SetThreadCount(n_threads);
+		start = std::chrono::steady_clock::now();
+		BootstrapBands threaded = bev.Bootstrap(n_resamples, {0.05, 0.95}, c.average_pnls, c.block_length);
+		double threaded_seconds = SecondsSince(start);
+		bool identical = (serial.bands[0] == threaded.bands[0]).all() && (serial.bands[1] == threaded.bands[1]).all();
+
+		std::cout << std::setprecision(3) << "  " << c.name << ": " << serial_seconds << " s serial, " << threaded_seconds << " s with " 
+			<< n_threads << " threads, identical: " << (identical ? "yes" : "NO") << std::endl;
+		PrintBands(serial, maturities);
+	}
+	return 0;
+}
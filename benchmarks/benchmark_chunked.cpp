@@ -0,0 +1,117 @@
+/*
+	Memory and speed of chunked evaluation (see BEV::SetChunkedEvaluation) against the cached PnL terms, on long GBM
+	histories. For each history length, solves the surface with the terms cached for the whole path, then in blocks
+	with the prices read in place from memory (SetData with a view) and from a memory-mapped price cache on disk
+	(written to the working directory and removed afterwards). Reports the most heap memory each solve held at once
+	(beyond what was in use before it), the solve times and the largest differences from the cached surface. The chunked
+	solves should hold about the same whatever the length of the history, apart from their results, while the cached
+	ones grow with it. The block each thread keeps between solves is only counted by the first chunked solve of the
+	thread. Exits with status 1 if an average-PnL surface differs from the cached one by more than 1e-10.
+	Heap memory is measured with bev_utils::PeakHeapBytes (on glibc only), see allocation_counter.h.
+
+	Usage:	benchmark_chunked [prices per block, default 4096] [years of GBM data, default 100 1000 4000]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_chunked benchmark_chunked.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "utils.h"
+#include "price_cache.h"
+#define BEV_COUNT_ALLOCATIONS
+#include "allocation_counter.h"
+
+// Peak heap bytes held by and wall time of one surface solve into surface, starting from an empty cache
+struct Solve {
+	long long bytes;
+	double seconds;
+};
+
+Solve TimeSolve(bev::BEV& bev_obj, bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev_utils::ResetPeakHeapBytes();
+	long long before = bev_utils::LiveHeapBytes();
+	auto start = std::chrono::steady_clock::now();
+	surface = bev_obj.SolveForBEV(average_pnls);
+	Solve solve;
+	solve.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	solve.bytes = bev_utils::PeakHeapBytes() - before;
+	return solve;
+}
+
+int main(int argc, char* argv[]) {
+	int chunk_prices = argc > 1 ? std::atoi(argv[1]) : 4096;
+	std::vector<int> years_list;
+	for (int k = 2; k < argc; k++)
+		years_list.push_back(std::atoi(argv[k]));
+	if (years_list.empty())
+		years_list = {100, 1000, 4000};
+	std::vector<double> strikes = {0.90, 0.95, 1.00, 1.05, 1.10};
+	std::vector<int> maturities = {1, 3, 6, 12};
+	const std::string cache_path = "benchmark_chunked.bevc";
+	if (!bev_utils::AllocationCountingEnabled())
+		std::cerr << "Allocation counting is not installed, the heap bytes will be zero." << std::endl;
+	bool passed = true;
+
+	for (int years : years_list) {
+		data_utils::CSVColumns columns;
+		data_utils::GenerateGBMData(columns.values, 100, 0.07, 0.2, years, 12345);
+		columns.names = {"Close"};
+		std::shared_ptr<data_utils::PriceCache> cache = std::make_shared<data_utils::PriceCache>();
+		if (data_utils::WritePriceCache(cache_path, columns) != data_utils::CacheStatus::Ok || cache->Open(cache_path) != data_utils::CacheStatus::Ok) {
+			std::cout << "Could not write " << cache_path << std::endl;
+			return 1;
+		}
+		Eigen::Map<const Eigen::ArrayXd> prices(columns.values.data(), columns.values.size());
+
+		std::cout << "\n" << years << " years of GBM data (" << prices.size() << " prices, " << maturities.size() << " maturities x "
+			<< strikes.size() << " strikes), blocks of " << chunk_prices << " prices" << std::endl;
+		std::cout << std::left << std::setw(14) << "aggregation" << std::setw(10) << "solve" << std::setw(16) << "terms" << std::right
+			<< std::setw(14) << "peak heap" << std::setw(12) << "ms" << std::setw(12) << "speed" << std::setw(14) << "max |diff|" << std::endl;
+		for (bool average_pnls : {true, false}) {
+			for (bool batched : {false, true}) {
+				Eigen::ArrayXXd cached_surface;
+				double cached_seconds = 0;
+				for (int source = 0; source < 3; source++) { // cached, chunked from memory, chunked from the file
+					bev::BEV bev_obj(prices, 0.015, strikes, maturities);
+					if (source == 2)
+						bev_obj.SetData(cache, "Close");
+					bev_obj.SetRootFinder(bev::RootFinder::NewtonBrent);
+					bev_obj.SetBatchedSolve(batched);
+					bev_obj.SetChunkedEvaluation(source == 0 ? 0 : chunk_prices);
+					Eigen::ArrayXXd surface;
+					Solve solve = TimeSolve(bev_obj, average_pnls, surface);
+					double max_diff = 0;
+					if (source == 0) {
+						cached_surface = surface;
+						cached_seconds = solve.seconds;
+					}
+					else {
+						// cells without a root are NaN in both
+						max_diff = (cached_surface.isNaN() && surface.isNaN()).select(0.0, (surface - cached_surface).abs()).maxCoeff();
+						if (average_pnls && !(max_diff <= 1e-10))
+							passed = false;
+					}
+					const char* terms = source == 0 ? "cached" : source == 1 ? "chunked, memory" : "chunked, file";
+					std::cout << std::left << std::setw(14) << (average_pnls ? "PnLs" : "BEVs") << std::setw(10) << (batched ? "batched" : "by cell")
+						<< std::setw(16) << terms << std::right << std::setw(14) << solve.bytes << std::fixed << std::setprecision(1) << std::setw(12)
+						<< solve.seconds * 1e3 << std::setprecision(2) << std::setw(12) << cached_seconds / solve.seconds << std::scientific
+						<< std::setw(14) << max_diff << std::endl;
+				}
+			}
+		}
+		cache.reset();
+		std::remove(cache_path.c_str());
+	}
+
+	std::cout << "\n" << (passed ? "The chunked surfaces match the cached ones." : "Some chunked surfaces differ from the cached ones.") << std::endl;
+	return passed ? 0 : 1;
+}
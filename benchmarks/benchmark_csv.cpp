@@ -0,0 +1,93 @@
+/*
+	Compares CSV loading with the memory-mapped loader (data_utils::LoadCSVColumns, see csv_loader.h) against the
+	previous line-by-line parser (std::getline, a std::stringstream per line and std::stod, reproduced below), on
+	the given file and on a larger file made by repeating its data lines. Checks that both give identical values.
+
+	Usage:	benchmark_csv [path to CSV, default ../GOOG.csv] [repeats for the large file, default 200] [threads, default 4]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev/utils -o benchmark_csv benchmark_csv.cpp ../bev/utils/csv_loader.cpp ../bev/utils/thread_pool.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "csv_loader.h"
+
+// Previous parser: reads column col_no of every line after the header.
+Eigen::ArrayXXd GetlineColumn(const std::string& csv_path, int col_no) {
+	std::ifstream csv(csv_path);
+	std::string line;
+	std::getline(csv, line);
+	std::vector<double> values;
+	while (std::getline(csv, line)) {
+		std::stringstream lineStream(line);
+		std::string cell;
+		for (int j = 0; j <= col_no; j++)
+			std::getline(lineStream, cell, ',');
+		values.push_back(std::stod(cell));
+	}
+	return Eigen::Map<Eigen::ArrayXXd>(values.data(), values.size(), 1);
+}
+
+// Average wall time in milliseconds of f() over n_reps calls
+template <typename F>
+double TimeMs(F f, int n_reps) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < n_reps; i++)
+		f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / n_reps;
+}
+
+void Compare(const std::string& csv_path, int n_threads, int n_reps) {
+	data_utils::CSVColumns columns;
+	data_utils::CSVStatus status = data_utils::LoadCSVColumns(csv_path, {"Close", "Adj Close"}, columns);
+	if (status != data_utils::CSVStatus::Ok) {
+		std::cout << "Could not load " << csv_path << ": " << data_utils::CSVStatusMessage(status) << std::endl;
+		return;
+	}
+	Eigen::ArrayXXd close = GetlineColumn(csv_path, 4), adj_close = GetlineColumn(csv_path, 5);
+	bool identical = (columns.values.col(0) == close.col(0)).all() && (columns.values.col(1) == adj_close.col(0)).all();
+
+	double getline_ms = TimeMs([&] { GetlineColumn(csv_path, 4); GetlineColumn(csv_path, 5); }, n_reps);
+	double mapped_ms = TimeMs([&] { data_utils::LoadCSVColumns(csv_path, {"Close", "Adj Close"}, columns); }, n_reps);
+	double threaded_ms = TimeMs([&] { data_utils::LoadCSVColumns(csv_path, {"Close", "Adj Close"}, columns, n_threads); }, n_reps);
+
+	std::cout << csv_path << ": " << columns.values.rows() << " rows, Close and Adj Close, values identical: " << (identical ? "yes" : "NO") << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  getline/stringstream/stod (two passes): " << getline_ms << " ms" << std::endl;
+	std::cout << "  LoadCSVColumns, 1 thread:              " << mapped_ms << " ms (" << getline_ms / mapped_ms << "x)" << std::endl;
+	std::cout << "  LoadCSVColumns, " << n_threads << " threads:             " << threaded_ms << " ms (" << getline_ms / threaded_ms << "x)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	int n_repeats = argc > 2 ? std::stoi(argv[2]) : 200;
+	int n_threads = argc > 3 ? std::stoi(argv[3]) : 4;
+
+	Compare(csv_path, n_threads, 50);
+
+	// larger file: the header followed by the data lines repeated n_repeats times
+	std::string large_path = "benchmark_csv_large.csv";
+	{
+		std::ifstream csv(csv_path);
+		std::string header, line, data;
+		std::getline(csv, header);
+		while (std::getline(csv, line))
+			data += line + "\n";
+		std::ofstream large(large_path);
+		large << header << "\n";
+		for (int i = 0; i < n_repeats; i++)
+			large << data;
+	}
+	Compare(large_path, n_threads, 3);
+	std::remove(large_path.c_str());
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+	Dense skews by adaptive nodes and monotone interpolation (see BEV::SolveDenseSkew) against solving every strike of
+	the grid. For each aggregation method and a few maturities, solves the skew at every one of n_strikes strikes evenly
+	spread from 0.7 to 1.3 with SolveForBEV (batched), then with SolveDenseSkew at a few tolerances. Reports the nodes
+	solved (as a share of the grid), the times, the largest actual error of the dense skew against the full one, and the
+	error estimate and last refinement error the dense solve reported.
+
+	Usage:	benchmark_dense_skew [path to CSV, default ../GOOG.csv] [strikes in the grid, default 500]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_dense_skew benchmark_dense_skew.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "csv_loader.h"
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	int n_strikes = argc > 2 ? std::atoi(argv[2]) : 500;
+	data_utils::CSVColumns columns;
+	if (data_utils::LoadCSVColumns(csv_path, {"Close"}, columns) != data_utils::CSVStatus::Ok) {
+		std::cout << "Could not load " << csv_path << std::endl;
+		return 1;
+	}
+	std::vector<double> strikes(n_strikes);
+	for (int k = 0; k < n_strikes; k++)
+		strikes[k] = 0.7 + 0.6 * k / std::max(n_strikes - 1, 1);
+
+	std::cout << "\nSkews over " << n_strikes << " strikes from 0.7 to 1.3 on " << csv_path << ", times in ms" << std::endl;
+	std::cout << std::left << std::setw(14) << "aggregation" << std::right << std::setw(6) << "term" << std::setw(10) << "tolerance"
+		<< std::setw(8) << "nodes" << std::setw(8) << "share" << std::setw(8) << "rounds" << std::setw(10) << "full" << std::setw(10) << "dense"
+		<< std::setw(9) << "speedup" << std::setw(12) << "max error" << std::setw(12) << "estimate" << std::setw(12) << "refinement" << std::endl;
+	for (bool average_pnls : {true, false}) {
+		for (int term_in_months : {1, 3, 6, 12}) {
+			bev::BEV full(columns.values, 0.015, strikes, {term_in_months});
+			full.SetBatchedSolve(true);
+			auto start = std::chrono::steady_clock::now();
+			Eigen::ArrayXXd reference = full.SolveForBEV(average_pnls);
+			double full_seconds = SecondsSince(start);
+
+			for (double tolerance : {1e-3, 1e-4, 1e-5}) {
+				bev::BEV dense(columns.values, 0.015, {1.0}, {term_in_months});
+				dense.SetBatchedSolve(true);
+				start = std::chrono::steady_clock::now();
+				bev::DenseSkew skew = dense.SolveDenseSkew(term_in_months, strikes, average_pnls, tolerance);
+				double dense_seconds = SecondsSince(start);
+				double max_error = 0;
+				for (int k = 0; k < n_strikes; k++) {
+					double error = std::abs(skew.BEVs(k) - reference(0, k));
+					if (!(error <= max_error) && !(std::isnan(skew.BEVs(k)) && std::isnan(reference(0, k)))) // NaN where only one is NaN
+						max_error = error;
+				}
+				std::cout << std::left << std::setw(14) << (average_pnls ? "average PnL" : "average BEV") << std::right << std::setw(6) << term_in_months
+					<< std::scientific << std::setprecision(0) << std::setw(10) << tolerance << std::setw(8) << skew.nodes.size()
+					<< std::fixed << std::setprecision(2) << std::setw(8) << (double) skew.nodes.size() / n_strikes << std::setw(8) << skew.rounds
+					<< std::setw(10) << full_seconds * 1e3 << std::setw(10) << dense_seconds * 1e3 << std::setprecision(1) << std::setw(9) << full_seconds / dense_seconds
+					<< std::scientific << std::setprecision(2) << std::setw(12) << max_error << std::setw(12) << skew.max_error_estimate
+					<< std::setw(12) << skew.max_refinement_error << std::endl;
+			}
+		}
+	}
+	std::cout << "\nThe average-BEV skews jump where subpath roots change branch, and a jump between two nodes that agree with each other\n"
+		"is not seen by the error estimate, so their actual errors can exceed the tolerance." << std::endl;
+	return 0;
+}
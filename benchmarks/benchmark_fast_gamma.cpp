@@ -0,0 +1,157 @@
+/*
+	Accuracy and speed of the fast gamma mode (see BEV::SetFastGamma) against the exact evaluation. First checks the
+	relative error of the fast exp of the normal density against std::exp over its whole range, exp(-d1^2 / 2) for
+	|d1| up to 40, which must stay below kernels::kFastGammaTolerance. Then times the PnL evaluations (single subpath
+	kernels and lockstep lanes) of a GBM history in both modes, and finally solves the surfaces of GOOG.csv and
+	sampledata.csv in both modes, for both root finders and aggregation methods, reporting the largest and mean
+	absolute differences from the exact surface and the solve times. Exits with status 1 if the error bound is exceeded.
+
+	Usage:	benchmark_fast_gamma [path to GOOG CSV, default ../GOOG.csv] [path to sample data CSV, default ../examples/sampledata.csv] [years of GBM data, default 20]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_fast_gamma benchmark_fast_gamma.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "pnl_context.h"
+#include "utils.h"
+
+// Largest relative error of the fast exp against std::exp over n points of x = -d1^2 / 2, for d1 evenly spaced in [0, max_d1]
+double MaxDensityError(double max_d1, int n) {
+	using namespace Eigen::internal;
+	typedef packet_traits<double>::type Packet;
+	double max_error = 0;
+	for (int k = 0; k <= n; k++) {
+		double d1 = max_d1 * k / n;
+		double x = -0.5 * d1 * d1;
+		double exact = std::exp(x);
+		if (exact < 1e-300) // clamped range, see kernels::detail::FastNegativeExp
+			continue;
+		double fast = pfirst(bev::kernels::GaussianExp<true, double>(pset1<Packet>(x)));
+		max_error = std::max(max_error, std::abs(fast - exact) / exact);
+	}
+	return max_error;
+}
+
+// Nanoseconds per evaluation of fn, averaged over n_reps calls
+template <typename F>
+double TimeEvaluations(F fn, int n_reps) {
+	auto start = std::chrono::steady_clock::now();
+	for (int k = 0; k < n_reps; k++)
+		fn(k);
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n_reps;
+}
+
+// Wall time in seconds of a surface solve in the given gamma mode, starting from an empty cache
+double TimeSolve(bev::BEV& bev_obj, bool fast_gamma, bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev_obj.SetFastGamma(fast_gamma); // also clears the results of the previous solve
+	auto start = std::chrono::steady_clock::now();
+	surface = bev_obj.SolveForBEV(average_pnls);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	std::string goog_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string sample_path = argc > 2 ? argv[2] : "../examples/sampledata.csv";
+	int years = argc > 3 ? std::atoi(argv[3]) : 20;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+
+	// error of the density itself, near the money (where the terms are largest) and over the whole range
+	double near_error = MaxDensityError(4.0, 4000000);
+	double full_error = MaxDensityError(40.0, 40000000);
+	bool passed = near_error < bev::kernels::kFastGammaTolerance && full_error < bev::kernels::kFastGammaTolerance;
+	std::cout << "\nRelative error of the fast normal density exp(-d1^2 / 2), bound " << std::scientific << std::setprecision(1)
+		<< bev::kernels::kFastGammaTolerance << std::endl;
+	std::cout << std::left << std::setw(16) << "|d1| <= 4" << std::setprecision(2) << near_error << std::endl;
+	std::cout << std::left << std::setw(16) << "|d1| <= 40" << full_error << (passed ? "" : "  FAILED") << std::endl;
+
+	// PnL evaluations over the non-overlapping subpaths and every window (stride 1) of a GBM history, 12 month maturity
+	Eigen::ArrayXXd S;
+	data_utils::GenerateGBMData(S, 100, 0.07, 0.2, years, 12345);
+	const int days = 12 * 21;
+	bev::PnLContext::RowVector tau = Eigen::ArrayXd::LinSpaced(days, days - 1, 0.0) / 252.0;
+	std::cout << "\n" << years << " years of GBM data, 12 month subpaths, ns per average PnL evaluation" << std::endl;
+	std::cout << std::left << std::setw(32) << "evaluation" << std::right << std::setw(14) << "exact" << std::setw(14) << "fast"
+		<< std::setw(10) << "speedup" << std::setw(14) << "max rel diff" << std::endl;
+	for (int stride : {days, 1}) {
+		bev::PnLContext exact = bev::PnLContext::FromHistory(S.data(), (int) S.size(), stride, tau, 0.015, 1.0 / 252);
+		bev::PnLContext fast = exact.WithStrike(1.05);
+		exact = exact.WithStrike(1.05);
+		fast.SetFastGamma(true);
+		int n_reps = stride == 1 ? 20 : 4000;
+
+		std::vector<double> sigmas(bev::kernels::kMaxLanes), strikes_lanes(bev::kernels::kMaxLanes);
+		std::vector<int> paths(bev::kernels::kMaxLanes, -1);
+		std::vector<double> exact_pnls(sigmas.size()), fast_pnls(sigmas.size()), dpnls(sigmas.size());
+		for (size_t l = 0; l < sigmas.size(); l++) {
+			sigmas[l] = 0.1 + 0.02 * l;
+			strikes_lanes[l] = 0.8 + 0.025 * l;
+		}
+
+		for (int with_derivative = 0; with_derivative < 2; with_derivative++) {
+			double max_diff = 0;
+			auto Evaluate = [&] (const bev::PnLContext& context, double sigma) {
+				return with_derivative ? context.PnLAndDerivative(sigma).first : context.PnL(sigma);
+			};
+			double exact_ns = TimeEvaluations([&] (int k) { Evaluate(exact, 0.15 + 1e-4 * (k % 100)); }, n_reps);
+			double fast_ns = TimeEvaluations([&] (int k) { Evaluate(fast, 0.15 + 1e-4 * (k % 100)); }, n_reps);
+			for (int k = 0; k < 100; k++) {
+				double sigma = 0.05 + 0.005 * k;
+				max_diff = std::max(max_diff, std::abs(Evaluate(fast, sigma) - Evaluate(exact, sigma)) / std::abs(Evaluate(exact, sigma)));
+			}
+			std::cout << std::left << std::setw(32) << (std::string(with_derivative ? "PnL and derivative" : "PnL") + (stride == 1 ? ", stride 1" : ""))
+				<< std::right << std::fixed << std::setprecision(0) << std::setw(14) << exact_ns << std::setw(14) << fast_ns << std::setprecision(2)
+				<< std::setw(10) << exact_ns / fast_ns << std::scientific << std::setw(14) << max_diff << std::endl;
+		}
+
+		double exact_ns = TimeEvaluations([&] (int) { exact.PnLLanes((int) sigmas.size(), sigmas.data(), strikes_lanes.data(), paths.data(), exact_pnls.data(), dpnls.data()); }, n_reps);
+		double fast_ns = TimeEvaluations([&] (int) { fast.PnLLanes((int) sigmas.size(), sigmas.data(), strikes_lanes.data(), paths.data(), fast_pnls.data(), dpnls.data()); }, n_reps);
+		double max_diff = 0;
+		for (size_t l = 0; l < sigmas.size(); l++)
+			max_diff = std::max(max_diff, std::abs(fast_pnls[l] - exact_pnls[l]) / std::abs(exact_pnls[l]));
+		std::cout << std::left << std::setw(32) << (std::string("16 lanes, derivative") + (stride == 1 ? ", stride 1" : ""))
+			<< std::right << std::fixed << std::setprecision(0) << std::setw(14) << exact_ns << std::setw(14) << fast_ns << std::setprecision(2)
+			<< std::setw(10) << exact_ns / fast_ns << std::scientific << std::setw(14) << max_diff << std::endl;
+	}
+
+	// accuracy report: surfaces of the two data sets in both modes
+	struct Data {
+		std::string name;
+		bev::BEV bev_obj;
+	};
+	std::vector<Data> data;
+	data.push_back({"GOOG", bev::BEV(goog_path, 0.015, strikes, maturities, -1, true, "Close")});
+	data.push_back({"sample data", bev::BEV(sample_path, 0.065, strikes, maturities, 0)});
+	for (Data& set : data) {
+		std::cout << "\n" << set.name << " surface (" << maturities.size() << " maturities x " << strikes.size() << " strikes), fast gamma against exact" << std::endl;
+		std::cout << std::left << std::setw(14) << "root finder" << std::setw(14) << "aggregation" << std::right << std::setw(12) << "max |diff|"
+			<< std::setw(13) << "mean |diff|" << std::setw(11) << "exact ms" << std::setw(10) << "fast ms" << std::setw(10) << "speedup" << std::endl;
+		for (bev::RootFinder root_finder : {bev::RootFinder::Secant, bev::RootFinder::NewtonBrent}) {
+			set.bev_obj.SetRootFinder(root_finder);
+			for (bool average_pnls : {true, false}) {
+				Eigen::ArrayXXd exact, fast;
+				double exact_seconds = TimeSolve(set.bev_obj, false, average_pnls, exact);
+				double fast_seconds = TimeSolve(set.bev_obj, true, average_pnls, fast);
+				// cells without a root are NaN in both modes
+				Eigen::ArrayXXd difference = (exact.isNaN() && fast.isNaN()).select(0.0, (fast - exact).abs());
+				std::cout << std::left << std::setw(14) << (root_finder == bev::RootFinder::Secant ? "secant" : "newton-brent")
+					<< std::setw(14) << (average_pnls ? "PnLs" : "BEVs") << std::right << std::scientific << std::setprecision(2)
+					<< std::setw(12) << difference.maxCoeff() << std::setw(13) << difference.mean() << std::fixed << std::setprecision(1)
+					<< std::setw(11) << exact_seconds * 1e3 << std::setw(10) << fast_seconds * 1e3 << std::setprecision(2) << std::setw(10)
+					<< exact_seconds / fast_seconds << std::endl;
+			}
+		}
+	}
+
+	std::cout << "\n" << (passed ? "The fast density is within its error bound." : "The fast density exceeds its error bound.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+/*
+	Compares generating many GBM paths one at a time with data_utils::GenerateGBMData (a std::mt19937 stepped once per 
+	day) against data_utils::GenerateGBMPaths (counter-based Philox draws, vectorised Box-Muller and cumulative 
+	log-returns), serially and across threads. Also checks that GenerateGBMPaths is reproducible: the same paths
+	result from any thread count, and from generating them in two pieces with first_path.
+
+	Usage:	benchmark_gbm [number of paths, default 1000] [years per path, default 10] [threads, default 4]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev/utils -o benchmark_gbm benchmark_gbm.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <Eigen/Dense>
+#include "utils.h"
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	int n_paths = argc > 1 ? std::stoi(argv[1]) : 1000;
+	int T = argc > 2 ? std::stoi(argv[2]) : 10;
+	int n_threads = argc > 3 ? std::stoi(argv[3]) : 4;
+	const double S_0 = 100, mu = 0.07, sigma = 0.2;
+	const uint64_t seed = 12345;
+
+	auto start = std::chrono::steady_clock::now();
+	Eigen::ArrayXXd S;
+	double checksum = 0;
+	for (int m = 0; m < n_paths; m++) {
+		data_utils::GenerateGBMData(S, S_0, mu, sigma, T, m);
+		checksum += S(S.rows() - 1, 0);
+	}
+	double mt_seconds = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	Eigen::ArrayXXd paths;
+	data_utils::GenerateGBMPaths(paths, S_0, mu, sigma, T, n_paths, seed);
+	double serial_seconds = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	Eigen::ArrayXXd threaded;
+	data_utils::GenerateGBMPaths(threaded, S_0, mu, sigma, T, n_paths, seed, 0, n_threads);
+	double threaded_seconds = SecondsSince(start);
+
+	Eigen::ArrayXXd first, second;
+	data_utils::GenerateGBMPaths(first, S_0, mu, sigma, T, n_paths / 2, seed);
+	data_utils::GenerateGBMPaths(second, S_0, mu, sigma, T, n_paths - n_paths / 2, seed, n_paths / 2);
+	bool reproducible = (threaded == paths).all() && (first == paths.leftCols(n_paths / 2)).all() && (second == paths.rightCols(n_paths - n_paths / 2)).all();
+
+	// sanity check of the distribution: log(S_T/S_0) ~ N((mu - sigma^2/2) T, sigma^2 T)
+	Eigen::ArrayXd log_returns = (paths.row(paths.rows() - 1) / S_0).log().transpose();
+	double mean = log_returns.mean();
+	double sd = std::sqrt((log_returns - mean).square().sum() / (n_paths - 1));
+
+	std::cout << n_paths << " paths of " << T << " years (" << paths.rows() << " prices each)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  GenerateGBMData, one path at a time: " << mt_seconds * 1e3 << " ms (checksum " << checksum / n_paths << ")" << std::endl;
+	std::cout << "  GenerateGBMPaths, 1 thread:          " << serial_seconds * 1e3 << " ms (" << mt_seconds / serial_seconds << "x)" << std::endl;
+	std::cout << "  GenerateGBMPaths, " << n_threads << " threads:         " << threaded_seconds * 1e3 << " ms (" << mt_seconds / threaded_seconds << "x)" << std::endl;
+	std::cout << "  reproducible across threads and pieces: " << (reproducible ? "yes" : "NO") << std::endl;
+	std::cout << std::setprecision(4) << "  log-return over " << T << " years: mean " << mean << " (expected " << (mu - 0.5 * sigma * sigma) * T 
+		<< "), sd " << sd << " (expected " << sigma * std::sqrt((double) T) << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,91 @@
+/*
+	Validates the fused PnL kernel (PnLContext, see pnl_kernel.h) against the reference Eigen implementation
+	(BEV::ContinuousDHPnL and BEV::ContinuousDHPnLDerivative) over the GOOG strike/maturity grid and a range of sigmas,
+	and times one PnL (and derivative) evaluation of each. Does the same for the daily delta-hedged PnL engine 
+	(kernels::DailyDHPnL against BEV::DailyDHPnL, with its derivative checked by central differences).
+
+	Usage:	benchmark_pnl_kernel [path to CSV, default ../GOOG.csv] [column name, default Close]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_pnl_kernel benchmark_pnl_kernel.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "pnl_context.h"
+#include "utils.h"
+
+// Average wall time in nanoseconds of f() over n_reps calls. The results are summed into sink so the calls can't be optimised away.
+template <typename F>
+double TimeNs(F f, int n_reps, double& sink) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < n_reps; i++)
+		sink += f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n_reps;
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string col_name = argc > 2 ? argv[2] : "Close";
+	double r = 0.015, dt = 1.0 / 252.0;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	std::vector<double> sigmas = {0.05, 0.1, 0.2, 0.3, 0.5, 0.99};
+	bev::BEV bev_obj(csv_path, r, strikes, maturities, -1, true, col_name);
+
+	double max_pnl_error = 0, max_dpnl_error = 0; // relative to the sum of absolute terms' scale, i.e. |reference| + 1e-12
+	double max_daily_error = 0, max_daily_dpnl_error = 0;
+	double reference_ns = 0, kernel_ns = 0, daily_reference_ns = 0, daily_kernel_ns = 0, sink = 0;
+	int n_timings = 0;
+
+	for (int term_in_months : maturities) {
+		Eigen::ArrayXXd paths = bev_obj.GetSubPaths(term_in_months);
+		int days_to_maturity = term_in_months*21;
+		Eigen::Array<double, 1, Eigen::Dynamic> times_to_maturity = Eigen::ArrayXd::LinSpaced(days_to_maturity, (double) days_to_maturity-1, 0.0) * dt;
+
+		for (double strike : strikes) {
+			bev::PnLContext context(paths, strike, times_to_maturity, r, dt);
+			for (double sigma : sigmas) {
+				std::pair<double, double> reference = bev_obj.ContinuousDHPnLAndDerivative(sigma, paths, strike, times_to_maturity);
+				std::pair<double, double> kernel = context.PnLAndDerivative(sigma);
+				max_pnl_error = std::max(max_pnl_error, std::abs(kernel.first - reference.first) / (std::abs(reference.first) + 1e-12));
+				max_dpnl_error = std::max(max_dpnl_error, std::abs(kernel.second - reference.second) / (std::abs(reference.second) + 1e-12));
+			}
+			bev::PnLContext daily_context = context;
+			daily_context.SetEngine(bev::PnLEngine::Daily);
+			for (double sigma : sigmas) {
+				double reference = bev_obj.DailyDHPnL(sigma, paths, strike, times_to_maturity);
+				std::pair<double, double> kernel = daily_context.PnLAndDerivative(sigma);
+				double central_difference = (daily_context.PnL(sigma + 1e-6) - daily_context.PnL(sigma - 1e-6)) / 2e-6;
+				max_daily_error = std::max(max_daily_error, std::abs(kernel.first - reference) / (std::abs(reference) + 1e-12));
+				max_daily_dpnl_error = std::max(max_daily_dpnl_error, std::abs(kernel.second - central_difference) / (std::abs(central_difference) + 1e-12));
+			}
+			reference_ns += TimeNs([&] { return bev_obj.ContinuousDHPnL(0.3, paths, strike, times_to_maturity); }, 20, sink);
+			kernel_ns += TimeNs([&] { return context.PnL(0.3); }, 20, sink);
+			daily_reference_ns += TimeNs([&] { return bev_obj.DailyDHPnL(0.3, paths, strike, times_to_maturity); }, 20, sink);
+			daily_kernel_ns += TimeNs([&] { return daily_context.PnL(0.3); }, 20, sink);
+			n_timings++;
+		}
+	}
+
+	std::cout << "\nFused kernel vs reference Eigen implementation over " << maturities.size() << " maturities x " << strikes.size() << " strikes x " << sigmas.size() << " sigmas" << std::endl;
+	std::cout << "max relative error, PnL:          " << max_pnl_error << std::endl;
+	std::cout << "max relative error, dPnL/dsigma:  " << max_dpnl_error << std::endl;
+	std::cout << "mean time per PnL evaluation (ns): reference " << reference_ns / n_timings << ", kernel " << kernel_ns / n_timings 
+				<< " (speedup " << reference_ns / kernel_ns << ")" << std::endl;
+	std::cout << "\nDaily delta-hedged PnL kernel vs reference Eigen implementation" << std::endl;
+	std::cout << "max relative error, PnL:          " << max_daily_error << std::endl;
+	std::cout << "max relative error, dPnL/dsigma:  " << max_daily_dpnl_error << " (against central differences)" << std::endl;
+	std::cout << "mean time per PnL evaluation (ns): reference " << daily_reference_ns / n_timings << ", kernel " << daily_kernel_ns / n_timings 
+				<< " (speedup " << daily_reference_ns / daily_kernel_ns << ", " << daily_kernel_ns / kernel_ns << "x the continuous kernel)" << std::endl;
+	std::cout << "(checksum " << sink << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*
+	Accuracy and speed of the float and mixed precision modes (see BEV::SetPrecision) against double precision. Solves
+	the GOOG surface in each precision, for both root finders and aggregation methods, and reports the largest and mean
+	absolute differences from the double surface, and the solve times. Then times the three precisions on overlapping
+	(stride 1) subpaths of a long GBM history, where the PnL evaluations are memory-bound.
+
+	Usage:	benchmark_precision [path to CSV, default ../GOOG.csv] [column name, default Close] [years of GBM data, default 20]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_precision benchmark_precision.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "utils.h"
+
+const char* Name(bev::Precision precision) {
+	switch (precision) {
+		case bev::Precision::Double: return "double";
+		case bev::Precision::Float: return "float";
+		case bev::Precision::Mixed: return "mixed";
+	}
+	return "";
+}
+
+// Wall time in seconds of a surface solve in the given precision, starting from an empty cache
+double TimeSolve(bev::BEV& bev_obj, bev::Precision precision, bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev_obj.SetPrecision(precision); // also clears the results of the previous solve
+	auto start = std::chrono::steady_clock::now();
+	surface = bev_obj.SolveForBEV(average_pnls);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string col_name = argc > 2 ? argv[2] : "Close";
+	int years = argc > 3 ? std::atoi(argv[3]) : 20;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	const std::vector<bev::Precision> precisions = {bev::Precision::Double, bev::Precision::Float, bev::Precision::Mixed};
+
+	bev::BEV goog(csv_path, 0.015, strikes, maturities, -1, true, col_name);
+	std::cout << "\nGOOG surface (" << maturities.size() << " maturities x " << strikes.size() << " strikes), differences from double" << std::endl;
+	std::cout << std::left << std::setw(14) << "root finder" << std::setw(15) << "average_pnls" << std::setw(11) << "precision"
+		<< std::setw(14) << "max |diff|" << std::setw(14) << "mean |diff|" << "time (ms)" << std::endl;
+	for (bev::RootFinder root_finder : {bev::RootFinder::Secant, bev::RootFinder::NewtonBrent}) {
+		goog.SetRootFinder(root_finder);
+		for (bool average_pnls : {true, false}) {
+			Eigen::ArrayXXd exact;
+			for (bev::Precision precision : precisions) {
+				Eigen::ArrayXXd surface;
+				double seconds = TimeSolve(goog, precision, average_pnls, surface);
+				if (precision == bev::Precision::Double)
+					exact = surface;
+				Eigen::ArrayXXd difference = (surface - exact).abs();
+				std::cout << std::left << std::setw(14) << (root_finder == bev::RootFinder::Secant ? "secant" : "newton-brent")
+					<< std::setw(15) << std::boolalpha << average_pnls << std::setw(11) << Name(precision) << std::scientific << std::setprecision(2)
+					<< std::setw(14) << difference.maxCoeff() << std::setw(14) << difference.mean() << std::fixed << std::setprecision(1) << seconds * 1e3 << std::endl;
+			}
+		}
+	}
+
+	// memory-bound case: every window of a long history
+	Eigen::ArrayXXd S;
+	data_utils::GenerateGBMData(S, 100, 0.07, 0.2, years, 12345);
+	bev::BEV gbm(S, 0.015, {0.9, 1.0, 1.1}, {1, 3, 6});
+	gbm.SetSubPathStride(1);
+	gbm.SetRootFinder(bev::RootFinder::NewtonBrent);
+	std::cout << "\n" << years << " years of GBM data, overlapping subpaths (stride 1), average PnLs, Newton-Brent" << std::endl;
+	std::cout << std::left << std::setw(11) << "precision" << std::setw(14) << "time (ms)" << std::setw(10) << "speedup" << "max |diff|" << std::endl;
+	Eigen::ArrayXXd exact;
+	double double_seconds = 0;
+	for (bev::Precision precision : precisions) {
+		Eigen::ArrayXXd surface;
+		double seconds = TimeSolve(gbm, precision, true, surface);
+		if (precision == bev::Precision::Double) {
+			exact = surface;
+			double_seconds = seconds;
+		}
+		std::cout << std::left << std::setw(11) << Name(precision) << std::fixed << std::setprecision(1) << std::setw(14) << seconds * 1e3
+			<< std::setprecision(2) << std::setw(10) << double_seconds / seconds << std::scientific << (surface - exact).abs().maxCoeff() << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+	Times the start-up load of a universe of tickers from CSV files (data_utils::LoadCSVColumns) against binary price 
+	caches (data_utils::PriceCache, see price_cache.h). The universe is made of n_tickers copies of the given CSV, 
+	written to the working directory and removed afterwards. Also checks that a BEV surface solved from a cache, with
+	BEV::SetData, is identical to the one solved from the CSV.
+
+	Usage:	benchmark_price_cache [path to CSV, default ../GOOG.csv] [number of tickers, default 2000]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_price_cache benchmark_price_cache.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/mapped_file.cpp ../bev/utils/csv_loader.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "csv_loader.h"
+#include "price_cache.h"
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	int n_tickers = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+	// build the universe
+	data_utils::CSVColumns columns;
+	data_utils::CSVStatus status = data_utils::LoadCSVColumns(csv_path, {"Open", "High", "Low", "Close", "Adj Close", "Volume"}, columns, 1, "Date");
+	if (status != data_utils::CSVStatus::Ok) {
+		std::cout << "Could not load " << csv_path << ": " << data_utils::CSVStatusMessage(status) << std::endl;
+		return 1;
+	}
+	std::ifstream csv(csv_path);
+	std::stringstream text;
+	text << csv.rdbuf();
+	std::vector<std::string> csv_paths, cache_paths;
+	for (int i = 0; i < n_tickers; i++) {
+		csv_paths.push_back("benchmark_ticker_" + std::to_string(i) + ".csv");
+		cache_paths.push_back("benchmark_ticker_" + std::to_string(i) + ".bevc");
+		std::ofstream(csv_paths.back()) << text.str();
+		data_utils::WritePriceCache(cache_paths.back(), columns);
+	}
+
+	// load every ticker's Close and Adj Close, and sum them so the loads can't be skipped
+	double csv_sum = 0, cache_sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const std::string& path : csv_paths) {
+		data_utils::LoadCSVColumns(path, {"Close", "Adj Close"}, columns);
+		csv_sum += columns.values.sum();
+	}
+	double csv_seconds = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (const std::string& path : cache_paths) {
+		data_utils::PriceCache cache;
+		cache.Open(path);
+		cache_sum += Eigen::Map<const Eigen::ArrayXd>(cache.Column("Close"), cache.Rows()).sum() + Eigen::Map<const Eigen::ArrayXd>(cache.Column("Adj Close"), cache.Rows()).sum();
+	}
+	double cache_seconds = SecondsSince(start);
+
+	std::cout << n_tickers << " tickers of " << columns.values.rows() << " rows, Close and Adj Close (files in the page cache):" << std::endl;
+	std::cout << "  CSV (LoadCSVColumns):   " << csv_seconds * 1000 << " ms" << std::endl;
+	std::cout << "  Binary (PriceCache):    " << cache_seconds * 1000 << " ms (" << csv_seconds / cache_seconds << "x)" << std::endl;
+
+	data_utils::PriceCache first;
+	first.Open(cache_paths[0]);
+	data_utils::LoadCSVColumns(csv_paths[0], {"Close", "Adj Close"}, columns);
+	bool identical = (Eigen::Map<const Eigen::ArrayXd>(first.Column("Close"), first.Rows()) == columns.values.col(0)).all()
+					&& (Eigen::Map<const Eigen::ArrayXd>(first.Column("Adj Close"), first.Rows()) == columns.values.col(1)).all();
+	std::cout << "Cached values identical to CSV: " << (identical ? "yes" : "NO") << " (checksums " << csv_sum << ", " << cache_sum << ")" << std::endl;
+
+	// a surface solved straight from the mapped cache matches the CSV one
+	std::vector<double> strikes = {0.90, 1.00, 1.10};
+	std::vector<int> maturities = {1, 3, 6};
+	bev::BEV from_csv(csv_path, 0.015, strikes, maturities, -1, true, "Close");
+	std::shared_ptr<data_utils::PriceCache> cache = std::make_shared<data_utils::PriceCache>();
+	cache->Open(cache_paths[0]);
+	bev::BEV from_cache;
+	from_cache.SetInterestRate(0.015);
+	from_cache.SetStrikes(strikes);
+	from_cache.SetMaturities(maturities);
+	from_cache.SetData(cache, "Close");
+	std::cout << "BEV surface from cache identical to CSV: " << ((from_csv.SolveForBEV() == from_cache.SolveForBEV()).all() ? "yes" : "NO") << std::endl;
+
+	for (int i = 0; i < n_tickers; i++) {
+		std::remove(csv_paths[i].c_str());
+		std::remove(cache_paths[i].c_str());
+	}
+	return 0;
+}
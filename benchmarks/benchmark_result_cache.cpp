@@ -0,0 +1,175 @@
+/*
+	Surfaces served from the on-disk result cache (see BEV::SetResultCache and data_utils::ResultCache). For a few
+	configurations on GOOG.csv, solves the surface without a cache, then with an emptied cache (every cell missed,
+	solved and stored), then again with a new BEV object and a new cache object on the same directory, as a later job
+	would. Reports the times, the lookups and stores of each run, the PnL evaluations of the run served from the cache
+	(which must be none) and whether its surface is identical to the uncached one. Then checks that a change of setting
+	(the interest rate) misses every cell, and has n_processes processes solve the same surface at once on an emptied
+	cache (where fork is available), each checking its surface. Exits with status 1 if any check fails.
+	The PnL evaluations are counted when the library is built with BEV_ENABLE_DIAGNOSTICS defined
+	(cmake -DBEV_DIAGNOSTICS=ON); the cache directory is emptied before and after the runs.
+
+	Usage:	benchmark_result_cache [path to CSV, default ../GOOG.csv] [cache directory, default bev_result_cache] [processes, default 4]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_result_cache benchmark_result_cache.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "csv_loader.h"
+#include "result_cache.h"
+
+#ifndef _WIN32
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+struct Config {
+	std::string name;
+	bool average_pnls;
+	int stride; // see BEV::SetSubPathStride
+	bool sub_paths; // SolveForBEV(strike, maturity) of the first cell rather than the surface
+};
+
+struct Run {
+	Eigen::ArrayXXd surface;
+	double seconds = 0;
+	long evaluations = 0;
+	bool counted = false; // false when the library was built without diagnostics
+	data_utils::ResultCache::Stats stats;
+};
+
+// Solves config on prices with a new BEV object, using a new ResultCache object on directory unless it is empty
+Run Solve(const Eigen::ArrayXXd& prices, const Config& config, const std::vector<int>& maturities, const std::vector<double>& strikes,
+	const std::string& directory, double interest_rate = 0.015) {
+	Run run;
+	auto start = std::chrono::steady_clock::now();
+	bev::BEV bev_obj(prices, interest_rate, strikes, maturities);
+	bev_obj.SetBatchedSolve(true);
+	bev_obj.SetSubPathStride(config.stride);
+	std::shared_ptr<data_utils::ResultCache> cache;
+	if (!directory.empty()) {
+		cache = std::make_shared<data_utils::ResultCache>();
+		if (cache->Open(directory) != data_utils::CacheStatus::Ok)
+			return run;
+		bev_obj.SetResultCache(cache);
+	}
+	if (config.sub_paths) {
+		run.surface = bev_obj.SolveForBEV(strikes[0], maturities[0]);
+	} else {
+		bev::SolveDiagnostics diagnostics;
+		run.surface = bev_obj.SolveForBEV(config.average_pnls, &diagnostics);
+		run.counted = diagnostics.enabled;
+		for (const bev::CellDiagnostics& cell : diagnostics.cells)
+			run.evaluations += cell.evaluations;
+	}
+	run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (cache)
+		run.stats = cache->GetStats();
+	return run;
+}
+
+// Bitwise equality, NaNs included
+bool Identical(const Eigen::ArrayXXd& a, const Eigen::ArrayXXd& b) {
+	if (a.rows() != b.rows() || a.cols() != b.cols())
+		return false;
+	for (Eigen::Index k = 0; k < a.size(); k++) {
+		if (!(a(k) == b(k) || (std::isnan(a(k)) && std::isnan(b(k)))))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string directory = argc > 2 ? argv[2] : "bev_result_cache";
+	int n_processes = argc > 3 ? std::atoi(argv[3]) : 4;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	data_utils::CSVColumns columns;
+	if (data_utils::LoadCSVColumns(csv_path, {"Close"}, columns) != data_utils::CSVStatus::Ok) {
+		std::cout << "Could not load " << csv_path << std::endl;
+		return 1;
+	}
+	data_utils::ResultCache cache;
+	if (cache.Open(directory) != data_utils::CacheStatus::Ok) {
+		std::cout << "Could not open " << directory << " as a result cache" << std::endl;
+		return 1;
+	}
+	cache.Clear();
+
+	std::vector<Config> configs = {
+		{"average PnL", true, 0, false},
+		{"average BEV", false, 0, false},
+		{"average PnL, stride 5", true, 5, false},
+		{"subpaths (1m, 0.8)", false, 0, true}};
+	bool passed = true;
+	std::cout << "\n" << maturities.size() << "x" << strikes.size() << " surfaces on " << csv_path << ", ms (lookups hit/missed, cells stored)" << std::endl;
+	std::cout << std::left << std::setw(24) << "configuration" << std::right << std::setw(12) << "no cache" << std::setw(12) << "cold"
+		<< std::setw(16) << "" << std::setw(12) << "cached" << std::setw(14) << "" << std::setw(10) << "speedup" << std::setw(12) << "PnL evals"
+		<< std::setw(12) << "identical" << std::endl;
+	bool counted = false;
+	for (const Config& config : configs) {
+		Run uncached = Solve(columns.values, config, maturities, strikes, "");
+		cache.Clear(); // the subpath roots are shared by the average-BEV surface and SolveForBEV(strike, maturity)
+		Run cold = Solve(columns.values, config, maturities, strikes, directory);
+		Run cached = Solve(columns.values, config, maturities, strikes, directory);
+		bool identical = Identical(cached.surface, uncached.surface) && Identical(cold.surface, uncached.surface);
+		bool served = cached.stats.misses == 0 && cached.stats.hits > 0 && (!cached.counted || cached.evaluations == 0);
+		passed = passed && identical && served;
+		counted = counted || cached.counted;
+		auto Counts = [] (const Run& run) {
+			return "(" + std::to_string(run.stats.hits) + "/" + std::to_string(run.stats.misses) + ", " + std::to_string(run.stats.stores) + ")";
+		};
+		std::cout << std::left << std::setw(24) << config.name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << uncached.seconds * 1e3 << std::setw(12) << cold.seconds * 1e3 << std::setw(16) << Counts(cold)
+			<< std::setw(12) << cached.seconds * 1e3 << std::setw(14) << Counts(cached) << std::setprecision(1) << std::setw(10) << uncached.seconds / cached.seconds
+			<< std::setw(12) << (cached.counted ? std::to_string(cached.evaluations) : "-") << std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+	}
+	if (!counted)
+		std::cout << "Rebuild with BEV_ENABLE_DIAGNOSTICS defined (cmake -DBEV_DIAGNOSTICS=ON) to count the PnL evaluations." << std::endl;
+
+	// a change to any setting in the key misses every cell
+	Run changed = Solve(columns.values, configs[0], maturities, strikes, directory, 0.02);
+	bool all_missed = changed.stats.hits == 0 && changed.stats.misses == (long long) (maturities.size() * strikes.size());
+	passed = passed && all_missed;
+	std::cout << "\nInterest rate changed: " << changed.stats.hits << " hits, " << changed.stats.misses << " misses" << (all_missed ? "" : "  FAILED") << std::endl;
+
+#ifndef _WIN32
+	// processes racing to solve and store the same surface on an emptied cache
+	Run reference = Solve(columns.values, configs[1], maturities, strikes, "");
+	cache.Clear();
+	std::vector<pid_t> children;
+	for (int p = 0; p < n_processes; p++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			bool same = true;
+			for (int repeat = 0; repeat < 3; repeat++)
+				same = same && Identical(Solve(columns.values, configs[1], maturities, strikes, directory).surface, reference.surface);
+			std::_Exit(same ? 0 : 1);
+		}
+		children.push_back(pid);
+	}
+	int n_failed = 0;
+	for (pid_t pid : children) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+		n_failed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	passed = passed && n_failed == 0;
+	std::cout << n_processes << " processes solving the same surface at once, 3 times each: " << n_failed << " with a different surface" << std::endl;
+#endif
+
+	cache.Clear();
+	std::cout << "\n" << (passed ? "Cached surfaces match the uncached ones, without PnL evaluations." : "Some checks failed.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/*
+	Compares the number of full-path PnL evaluations needed per cell by the secant method (RootBySecantMethod, 
+	starting from 0.99) and the safeguarded Newton-Brent method (RootByNewtonBrent, starting from the realised
+	volatility and using the analytic dPnL/dsigma) over the whole GOOG surface, for both aggregation methods.
+	A Newton-Brent evaluation returns the PnL and its derivative from the same paths and counts as one evaluation.
+
+	Usage:	benchmark_root_finders [path to CSV, default ../GOOG.csv] [column name, default Close]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_root_finders benchmark_root_finders.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "utils.h"
+
+// Running totals of the evaluations for one root finder
+struct EvaluationStats {
+	long total = 0;
+	int max = 0;
+	int n = 0;
+	void Add(int evaluations) { total += evaluations; max = std::max(max, evaluations); n++; };
+	double Mean() const { return n > 0 ? (double) total / n : 0.0; };
+};
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string col_name = argc > 2 ? argv[2] : "Close";
+	double r = 0.015;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	bev::BEV bev_obj(csv_path, r, strikes, maturities, -1, true, col_name);
+
+	for (bool average_pnls : {true, false}) {
+		EvaluationStats secant, newton;
+		double max_difference = 0;
+
+		for (int term_in_months : maturities) {
+			Eigen::ArrayXXd sub_paths = bev_obj.GetSubPaths(term_in_months);
+			int days_to_maturity = term_in_months*21;
+			Eigen::Array<double, 1, Eigen::Dynamic> times_to_maturity = Eigen::ArrayXd::LinSpaced(days_to_maturity, (double) days_to_maturity-1, 0.0) * (1.0 / 252.0);
+
+			for (double strike : strikes) {
+				// when not averaging PnLs, every subpath is a separate root solve
+				int n_solves = average_pnls ? 1 : sub_paths.rows();
+				for (int n = 0; n < n_solves; n++) {
+					Eigen::ArrayXXd paths = average_pnls ? sub_paths : Eigen::ArrayXXd(sub_paths.row(n));
+					auto PnL = [&] (double sigma) { return bev_obj.ContinuousDHPnL(sigma, paths, strike, times_to_maturity); };
+					auto PnLAndDerivative = [&] (double sigma) { return bev_obj.ContinuousDHPnLAndDerivative(sigma, paths, strike, times_to_maturity); };
+
+					bev_utils::RootResult secant_result;
+					bev_utils::RootBySecantMethod(PnL, 0.99, 0.01, 1e-12, 1e-12, &secant_result);
+					bev_utils::RootResult newton_result = bev_utils::RootByNewtonBrent(PnLAndDerivative, bev_obj.RealisedVolatility(paths), 1e-4, 5.0);
+
+					secant.Add(secant_result.evaluations);
+					newton.Add(newton_result.evaluations);
+					if (std::isfinite(secant_result.root) && std::isfinite(newton_result.root))
+						max_difference = std::max(max_difference, std::abs(secant_result.root - newton_result.root));
+				}
+			}
+		}
+
+		std::cout << "\naverage_pnls = " << std::boolalpha << average_pnls << " (" << secant.n << " root solves)" << std::endl;
+		std::cout << std::left << std::setw(14) << "method" << std::setw(22) << "mean evaluations" << "max evaluations" << std::endl;
+		std::cout << std::setw(14) << "secant" << std::setw(22) << secant.Mean() << secant.max << std::endl;
+		std::cout << std::setw(14) << "newton-brent" << std::setw(22) << newton.Mean() << newton.max << std::endl;
+		std::cout << "max |difference| between roots: " << max_difference << std::endl;
+	}
+	return 0;
+}
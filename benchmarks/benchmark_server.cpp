@@ -0,0 +1,212 @@
+/*
+	Query latency of the resident query server (bev::QueryServer, see query_server.h) against answering each query as a
+	program started per query does: load the CSV, build the BEV object and solve (less the process startup). For a
+	cell, a skew and a surface query, times such one-shot answers, the server's first answer (solving) and its repeated
+	answers (from its results) through QueryServer::Handle, then a stream session (ServeStream) of repeated cell queries.
+	Then n_clients threads, released at once, query skews at a few maturities of a freshly loaded ticker, reporting how
+	many solves the server made for them (concurrent queries for the same ticker are batched), and a client runs a
+	session over a Unix domain socket (where supported). Every answer is checked against the one-shot one, and the
+	benchmark exits with status 1 if any differs.
+
+	Usage:	benchmark_server [path to CSV, default ../GOOG.csv] [concurrent clients, default 8] [repeated queries, default 100000]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_server benchmark_server.cpp ../bev/query_server.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "csv_loader.h"
+#include "query_server.h"
+
+#ifndef _WIN32
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The BEVs of a grid (maturity-major) as a one-shot program gets them, from the CSV
+std::vector<double> OneShotGrid(const std::string& csv_path, bool average_pnls, const std::vector<int>& maturities, const std::vector<double>& strikes) {
+	data_utils::CSVColumns columns;
+	data_utils::LoadCSVColumns(csv_path, {"Close"}, columns);
+	bev::BEV bev_obj(columns.values, 0.015, strikes, maturities);
+	bev_obj.SetBatchedSolve(true); // as the server's default settings
+	Eigen::ArrayXXd surface = bev_obj.SolveForBEV(average_pnls);
+	std::vector<double> bevs;
+	for (Eigen::Index row = 0; row < surface.rows(); row++) {
+		for (Eigen::Index col = 0; col < surface.cols(); col++)
+			bevs.push_back(surface(row, col));
+	}
+	return bevs;
+}
+
+// Microseconds per call of fn, averaged over n_reps calls
+template <typename F>
+double MicrosecondsPerCall(F fn, int n_reps) {
+	auto start = std::chrono::steady_clock::now();
+	for (int k = 0; k < n_reps; k++)
+		fn(k);
+	return SecondsSince(start) * 1e6 / n_reps;
+}
+
+// The BEVs answered by an "OK <bev> ..." response, none for anything else
+std::vector<double> ParseBEVs(const std::string& response) {
+	std::vector<double> bevs;
+	if (response.compare(0, 2, "OK") != 0)
+		return bevs;
+	std::istringstream fields(response.substr(2));
+	std::string field;
+	while (fields >> field)
+		bevs.push_back(std::strtod(field.c_str(), nullptr));
+	return bevs;
+}
+
+#ifndef _WIN32
+// Sends requests over one connection to the server at socket_path, returning the response lines
+std::vector<std::string> SocketSession(const std::string& socket_path, const std::vector<std::string>& requests) {
+	std::vector<std::string> responses;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_path.c_str());
+	for (int attempt = 0; connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0; attempt++) {
+		if (attempt == 100) { // the server didn't come up within a second
+			close(fd);
+			return responses;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	std::string text;
+	for (const std::string& request : requests)
+		text += request + "\n";
+	if (write(fd, text.data(), text.size()) != (ssize_t) text.size()) {
+		close(fd);
+		return responses;
+	}
+	std::string received;
+	char data[4096];
+	ssize_t n;
+	while (responses.size() < requests.size() && (n = read(fd, data, sizeof(data))) > 0) {
+		received.append(data, n);
+		size_t end;
+		while ((end = received.find('\n')) != std::string::npos) {
+			responses.push_back(received.substr(0, end));
+			received.erase(0, end + 1);
+		}
+	}
+	close(fd);
+	return responses;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	int n_clients = argc > 2 ? std::atoi(argv[2]) : 8;
+	int n_reps = argc > 3 ? std::atoi(argv[3]) : 100000;
+	bool passed = true;
+
+	bev::QueryServer server;
+	std::string loaded = server.Handle("LOAD GOOG " + csv_path);
+	if (loaded.compare(0, 2, "OK") != 0) {
+		std::cout << "Could not load " << csv_path << ": " << loaded << std::endl;
+		return 1;
+	}
+	std::vector<double> strikes = {0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.15, 1.2};
+	struct QueryKind { std::string name, request; std::vector<int> maturities; std::vector<double> strikes; };
+	std::vector<QueryKind> kinds = {
+		{"cell", "CELL GOOG PNL 3 1.05", {3}, {1.05}},
+		{"skew (9 strikes)", "SKEW GOOG PNL 6 0.8 0.85 0.9 0.95 1 1.05 1.1 1.15 1.2", {6}, strikes},
+		{"surface (10 x 9)", "SURFACE GOOG PNL 1,2,3,4,5,6,9,12,15,18 0.8,0.85,0.9,0.95,1,1.05,1.1,1.15,1.2",
+			{1, 2, 3, 4, 5, 6, 9, 12, 15, 18}, strikes}};
+
+	/*
+	one-shot: load the CSV, build the BEV object and solve, as a new process per query does (less the process startup);
+	first: the server's first answer, solving; repeated: the server's answer from its results */
+	std::cout << "\nQuery latency on " << csv_path << " (average PnL zeroed), microseconds per query" << std::endl;
+	std::cout << std::left << std::setw(20) << "query" << std::right << std::setw(14) << "one-shot" << std::setw(14) << "first"
+		<< std::setw(14) << "repeated" << std::setw(20) << "one-shot/repeated" << std::endl;
+	for (const QueryKind& kind : kinds) {
+		std::vector<double> one_shot_bevs, served_bevs;
+		double one_shot_us = MicrosecondsPerCall([&] (int) { one_shot_bevs = OneShotGrid(csv_path, true, kind.maturities, kind.strikes); }, 5);
+		double first_us = MicrosecondsPerCall([&] (int) { served_bevs = ParseBEVs(server.Handle(kind.request)); }, 1);
+		int reps = std::max(1, n_reps / (int) one_shot_bevs.size());
+		double repeated_us = MicrosecondsPerCall([&] (int) { server.Handle(kind.request); }, reps);
+		bool same = served_bevs == one_shot_bevs;
+		passed = passed && same;
+		std::cout << std::left << std::setw(20) << kind.name << std::right << std::fixed << std::setprecision(2) << std::setw(14) << one_shot_us
+			<< std::setw(14) << first_us << std::setw(14) << repeated_us << std::setw(20) << one_shot_us / repeated_us << (same ? "" : "  DIFFERS") << std::endl;
+	}
+	std::stringstream requests, responses;
+	for (int k = 0; k < n_reps; k++)
+		requests << kinds[0].request << "\n";
+	auto start = std::chrono::steady_clock::now();
+	server.ServeStream(requests, responses);
+	std::cout << "Stream session of " << n_reps << " cell queries: " << SecondsSince(start) * 1e6 / n_reps << " us per query" << std::endl;
+
+	// concurrent clients released at once, querying skews at different maturities of a ticker no query has solved yet
+	std::vector<int> maturities = {6, 12, 18, 24, 36, 48};
+	bev::QueryServer concurrent;
+	concurrent.Handle("LOAD GOOG " + csv_path);
+	std::vector<std::vector<double>> answers(n_clients);
+	std::vector<std::thread> clients;
+	std::atomic<int> ready(0);
+	for (int c = 0; c < n_clients; c++) {
+		clients.emplace_back([&, c] {
+			std::ostringstream request;
+			request << "SKEW GOOG BEV " << maturities[c % maturities.size()];
+			for (double strike : strikes)
+				request << " " << strike;
+			ready++;
+			while (ready < n_clients + 1)
+				std::this_thread::yield();
+			answers[c] = ParseBEVs(concurrent.Handle(request.str()));
+		});
+	}
+	while (ready < n_clients)
+		std::this_thread::yield();
+	start = std::chrono::steady_clock::now();
+	ready++;
+	for (std::thread& client : clients)
+		client.join();
+	double concurrent_seconds = SecondsSince(start);
+	for (int c = 0; c < n_clients; c++)
+		passed = passed && answers[c] == OneShotGrid(csv_path, false, {maturities[c % maturities.size()]}, strikes);
+	bev::ServerStats stats = concurrent.Stats();
+	std::cout << "\n" << n_clients << " concurrent skew queries (average BEVs) on a new ticker: " << stats.solves << " solves, "
+		<< stats.batched_queries << " queries batched into another's solve, "
+		<< stats.cached_cells / (long long) strikes.size() << " answered from cells solved before, " << std::setprecision(1) << concurrent_seconds * 1e3 << " ms" << std::endl;
+
+#ifndef _WIN32
+	// a session over a Unix domain socket
+	const std::string socket_path = "benchmark_server.sock";
+	std::thread serving([&] { server.ServeUnixSocket(socket_path); });
+	std::vector<std::string> socket_requests(1000, kinds[0].request);
+	socket_requests.push_back("SHUTDOWN");
+	start = std::chrono::steady_clock::now();
+	std::vector<std::string> socket_responses = SocketSession(socket_path, socket_requests);
+	double socket_us = SecondsSince(start) * 1e6 / socket_requests.size();
+	serving.join();
+	bool socket_passed = socket_responses.size() == socket_requests.size() && ParseBEVs(socket_responses[0]) == OneShotGrid(csv_path, true, {3}, {1.05});
+	passed = passed && socket_passed;
+	std::cout << "Unix socket session: " << socket_responses.size() << " responses to " << socket_requests.size() << " requests, "
+		<< std::setprecision(2) << socket_us << " us per query (connecting included)" << (socket_passed ? "" : "  FAILED") << std::endl;
+#endif
+
+	std::cout << "\n" << (passed ? "The server's answers match the one-shot solves." : "Some answers of the server differ from the one-shot solves.") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+	Regression benchmark suite for the hot paths: CSVToEigenArray, GetSubPaths, BlackScholesGamma, ContinuousDHPnL (the
+	reference Eigen implementation and the fused kernel of PnLContext), RootBySecantMethod and full SolveForBEV runs in
+	both aggregation modes, over GBM histories (GenerateGBMData) of several lengths and strike/maturity grids of several
+	sizes. Each case is repeated until it has run for at least min_seconds and reports ns/op, PnL evaluations per second
+	(where the operation evaluates PnLs) and the bytes and number of heap allocations per op, both to the console and as
+	JSON, so results can be compared between builds.
+
+	Allocations are counted with bev_utils::HeapAllocations (see allocation_counter.h), which interposes malloc/calloc/realloc
+	on glibc, catching Eigen's allocations as well as operator new. Elsewhere only operator new is counted, and Eigen's 
+	allocations are missed.
+
+	Usage:	benchmark_suite [JSON output path, default benchmark_results.json] [history lengths in years, comma separated,
+			default 5,100,1000] [min_seconds per case, default 0.2]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_suite benchmark_suite.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo), where the run_benchmark_suite target builds and runs it.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "pnl_context.h"
+#include "utils.h"
+#define BEV_COUNT_ALLOCATIONS
+#include "allocation_counter.h"
+
+// Measurements of one benchmark case
+struct Result {
+	std::string name;
+	int years; // length of the GBM history
+	std::string grid; // strikes x maturities, or the subpath length for the PnL cases
+	long long ops;
+	double ns_per_op;
+	double pnl_evals_per_op; // 0 when the operation doesn't evaluate PnLs
+	double bytes_per_op;
+	double allocations_per_op;
+};
+
+double min_seconds = 0.2;
+double sink = 0; // results are summed here so the operations can't be optimised away
+std::vector<Result> results;
+
+/*
+Runs op (returning a double for sink) until min_seconds have passed (at least once) and records the averages.
+pnl_evals_per_op is the number of PnL evaluations one op makes. */
+template <typename F>
+void Run(const std::string& name, int years, const std::string& grid, double pnl_evals_per_op, F op) {
+	sink += op(); // warm up, e.g. page in the data
+	bev_utils::AllocationCounts before = bev_utils::HeapAllocations();
+	long long ops = 0;
+	auto start = std::chrono::steady_clock::now();
+	double elapsed = 0;
+	do {
+		sink += op();
+		ops++;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < min_seconds);
+
+	bev_utils::AllocationCounts allocated = bev_utils::HeapAllocations() - before;
+	Result result = {name, years, grid, ops, elapsed * 1e9 / ops, pnl_evals_per_op, (double) allocated.bytes / ops, (double) allocated.allocations / ops};
+	results.push_back(result);
+	std::cout << std::left << std::setw(34) << name << std::setw(7) << years << std::setw(8) << grid << std::right << std::fixed
+		<< std::setprecision(0) << std::setw(16) << result.ns_per_op << std::setw(16);
+	if (pnl_evals_per_op > 0)
+		std::cout << pnl_evals_per_op / (result.ns_per_op * 1e-9);
+	else
+		std::cout << "-";
+	std::cout << std::setw(16) << result.bytes_per_op << std::setw(12) << std::setprecision(1) << result.allocations_per_op << std::endl;
+}
+
+void WriteJSON(const std::string& json_path) {
+	std::ofstream json(json_path);
+	json << std::setprecision(10) << "{\n  \"min_seconds\": " << min_seconds << ",\n  \"results\": [\n";
+	for (size_t k = 0; k < results.size(); k++) {
+		const Result& r = results[k];
+		json << "    {\"name\": \"" << r.name << "\", \"years\": " << r.years << ", \"grid\": \"" << r.grid << "\", \"ops\": " << r.ops
+			<< ", \"ns_per_op\": " << r.ns_per_op << ", \"pnl_evals_per_sec\": " << (r.pnl_evals_per_op > 0 ? r.pnl_evals_per_op / (r.ns_per_op * 1e-9) : 0.0)
+			<< ", \"bytes_allocated_per_op\": " << r.bytes_per_op << ", \"allocations_per_op\": " << r.allocations_per_op << "}"
+			<< (k + 1 < results.size() ? ",\n" : "\n");
+	}
+	json << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+	std::string json_path = argc > 1 ? argv[1] : "benchmark_results.json";
+	std::vector<int> history_years = {5, 100, 1000};
+	if (argc > 2) {
+		history_years.clear();
+		std::stringstream list(argv[2]);
+		std::string item;
+		while (std::getline(list, item, ','))
+			history_years.push_back(std::stoi(item));
+	}
+	min_seconds = argc > 3 ? std::stod(argv[3]) : 0.2;
+
+	const double r = 0.015, dt = 1.0 / 252.0;
+	struct Grid { std::string name; std::vector<double> strikes; std::vector<int> maturities; };
+	std::vector<Grid> grids = {
+		{"1x1", {1.0}, {1}},
+		{"5x3", {0.9, 0.95, 1.0, 1.05, 1.1}, {1, 3, 6}},
+		{"9x6", {0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.15, 1.2}, {1, 2, 3, 6, 9, 12}}
+	};
+
+	std::cout << std::left << std::setw(34) << "benchmark" << std::setw(7) << "years" << std::setw(8) << "grid" << std::right
+		<< std::setw(16) << "ns/op" << std::setw(16) << "PnL evals/s" << std::setw(16) << "bytes/op" << std::setw(12) << "allocs/op" << std::endl;
+
+	for (int years : history_years) {
+		Eigen::ArrayXXd S;
+		data_utils::GenerateGBMData(S, 100, 0.07, 0.2, years, 12345);
+
+		// loading: the history written as a CSV with a header, with 6 decimals as in Yahoo Finance downloads
+		std::string csv_path = "benchmark_suite_gbm.csv";
+		{
+			std::ofstream csv(csv_path);
+			csv << "Day,Close\n" << std::fixed << std::setprecision(6);
+			for (int i = 0; i < S.rows(); i++)
+				csv << i << ',' << S(i, 0) << '\n';
+		}
+		Run("CSVToEigenArray", years, "-", 0, [&] { return data_utils::CSVToEigenArray(csv_path, -1, true, "Close")(0, 0); });
+		std::remove(csv_path.c_str());
+
+		bev::BEV bev_obj(S, r, {1.0}, {1});
+		for (int term_in_months : {1, 12})
+			Run("GetSubPaths", years, std::to_string(term_in_months) + "m", 0, [&] { return bev_obj.GetSubPaths(term_in_months)(0, 1); });
+
+		// PnL function of the one-month subpaths, at the money
+		Eigen::ArrayXXd paths = bev_obj.GetSubPaths(1);
+		Eigen::Array<double, 1, Eigen::Dynamic> times_to_maturity = Eigen::ArrayXd::LinSpaced(21, 20.0, 0.0) * dt;
+		bev::PnLContext context(paths, 1.0, times_to_maturity, r, dt);
+		Run("BlackScholesGamma", years, "1m", 0, [&] { return bev_obj.BlackScholesGamma(0.3, paths, 1.0, times_to_maturity)(0, 0); });
+		Run("ContinuousDHPnL", years, "1m", 1, [&] { return bev_obj.ContinuousDHPnL(0.3, paths, 1.0, times_to_maturity); });
+		Run("PnLContext::PnL", years, "1m", 1, [&] { return context.PnL(0.3); });
+
+		bev_utils::RootResult root;
+		bev_utils::RootBySecantMethod([&] (double sigma) { return context.PnL(sigma); }, 0.99, 0.01, 1e-12, 1e-12, &root);
+		Run("RootBySecantMethod", years, "1m", root.evaluations, [&] {
+			return bev_utils::RootBySecantMethod([&] (double sigma) { return context.PnL(sigma); }, 0.99); });
+
+		for (const Grid& grid : grids) {
+			bev::BEV surface(S, r, grid.strikes, grid.maturities);
+			for (bool average_pnls : {true, false}) {
+				// SetInterestRate clears the results kept between solves, so every op solves the whole surface
+				Run(average_pnls ? "SolveForBEV(average PnLs)" : "SolveForBEV(average BEVs)", years, grid.name, 0, [&] {
+					surface.SetInterestRate(r);
+					return surface.SolveForBEV(average_pnls)(0, 0); });
+			}
+		}
+	}
+
+	WriteJSON(json_path);
+	std::cout << "Results written to " << json_path << " (checksum " << sink << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+	Benchmark of the parallel surface solver: times SolveForBEV (both aggregation methods) on simulated GBM data
+	for an increasing number of threads and reports the speedup relative to the serial solve. Every parallel surface
+	is also checked against the serial surface for bit-for-bit equality. Then solves a surface repeating some of its
+	strikes and maturities on max threads (at least 2), with and without the batched solve and warm starts, and checks
+	every cell against the same cell solved on its own (against the surface without the repeats, with warm starts, which
+	seed each strike from its neighbours). Exits with status 1 if any check fails.
+
+	Usage:	benchmark_threads [years of data, default 50] [max threads, default hardware concurrency]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_threads benchmark_threads.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "utils.h"
+
+using data_utils::GenerateGBMData;
+
+/*
+Wall time in seconds of a surface solve on n_threads threads. A new BEV object is built for every solve, as the
+results kept on an object would answer any solve after the first without running the solver. */
+double TimeSolve(const Eigen::ArrayXXd& S, const std::vector<double>& strikes, const std::vector<int>& maturities, int n_threads,
+	bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev::BEV bev_obj(S, 0.065, strikes, maturities);
+	bev_obj.SetThreadCount(n_threads);
+	auto start = std::chrono::steady_clock::now();
+	surface = bev_obj.SolveForBEV(average_pnls);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	int T = argc > 1 ? std::atoi(argv[1]) : 50;
+	int max_threads = argc > 2 ? std::atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+	if (max_threads < 1)
+		max_threads = 1;
+
+	Eigen::ArrayXXd S;
+	GenerateGBMData(S, 100, 0.07, 0.2, T, 12345);
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+
+	// Thread counts: powers of two up to max_threads, plus max_threads itself
+	std::vector<int> thread_counts;
+	for (int n = 1; n < max_threads; n *= 2)
+		thread_counts.push_back(n);
+	thread_counts.push_back(max_threads);
+
+	bool passed = true;
+	std::cout << "\nSurface solve on " << T << " years of GBM data (" << maturities.size() << " maturities x " << strikes.size() << " strikes)" << std::endl;
+	for (bool average_pnls : {true, false}) {
+		std::cout << "\naverage_pnls = " << std::boolalpha << average_pnls << std::endl;
+		std::cout << std::left << std::setw(10) << "threads" << std::setw(12) << "time (s)" << std::setw(10) << "speedup" << "identical" << std::endl;
+
+		Eigen::ArrayXXd serial_surface;
+		double serial_time = TimeSolve(S, strikes, maturities, 1, average_pnls, serial_surface);
+
+		for (int n : thread_counts) {
+			Eigen::ArrayXXd surface;
+			double time = n == 1 ? serial_time : TimeSolve(S, strikes, maturities, n, average_pnls, surface);
+			bool identical = n == 1 || std::memcmp(surface.data(), serial_surface.data(), sizeof(double) * surface.size()) == 0;
+			passed = passed && identical;
+			std::cout << std::setw(10) << n << std::setw(12) << std::setprecision(4) << time << std::setw(10) << serial_time / time << identical << std::endl;
+		}
+	}
+
+	// repeated strikes and maturities share their results, so each is solved once however the cells are spread over threads
+	std::vector<double> repeated_strikes = {1.00, 0.90, 1.00, 1.10, 0.90, 1.00};
+	std::vector<int> repeated_maturities = {3, 1, 3, 6};
+	std::vector<double> unique_strikes = {1.00, 0.90, 1.10};
+	std::vector<int> unique_maturities = {3, 1, 6};
+	std::cout << "\nRepeated strikes and maturities on " << std::max(max_threads, 2) << " threads:" << std::endl;
+	for (bool average_pnls : {true, false}) {
+		for (bool batched : {false, true}) {
+			for (bool warm_start : {false, true}) {
+				bev::BEV repeated(S, 0.065, repeated_strikes, repeated_maturities);
+				repeated.SetThreadCount(std::max(max_threads, 2));
+				repeated.SetBatchedSolve(batched);
+				repeated.SetWarmStart(warm_start);
+				Eigen::ArrayXXd surface = repeated.SolveForBEV(average_pnls);
+				bev::BEV unique(S, 0.065, unique_strikes, unique_maturities);
+				unique.SetBatchedSolve(batched);
+				unique.SetWarmStart(warm_start);
+				Eigen::ArrayXXd unique_surface = unique.SolveForBEV(average_pnls);
+				bool identical = true;
+				for (size_t row = 0; row < repeated_maturities.size(); row++) {
+					for (size_t col = 0; col < repeated_strikes.size(); col++) {
+						double expected;
+						if (warm_start) {
+							int unique_row = std::find(unique_maturities.begin(), unique_maturities.end(), repeated_maturities[row]) - unique_maturities.begin();
+							int unique_col = std::find(unique_strikes.begin(), unique_strikes.end(), repeated_strikes[col]) - unique_strikes.begin();
+							expected = unique_surface(unique_row, unique_col);
+						} else {
+							bev::BEV cell(S, 0.065, {repeated_strikes[col]}, {repeated_maturities[row]});
+							cell.SetBatchedSolve(batched);
+							expected = cell.SolveForBEV(average_pnls)(0, 0);
+						}
+						identical = identical && std::memcmp(&expected, &surface(row, col), sizeof(double)) == 0;
+					}
+				}
+				passed = passed && identical;
+				std::cout << "average_pnls = " << average_pnls << ", batched = " << batched << ", warm start = " << warm_start << ": "
+					<< (identical ? "identical" : "DIFFERENT") << std::endl;
+			}
+		}
+	}
+	return passed ? 0 : 1;
+}
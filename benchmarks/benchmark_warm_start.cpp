@@ -0,0 +1,103 @@
+/*
+	Root-finding work saved by warm starts (see BEV::SetWarmStart) on the GOOG and sample data surfaces. For each root
+	finder and aggregation method, solves the surface from the default starting points (cold) and with warm starts from
+	the money outwards (warm), then changes the interest rate and solves again, cold and from the previous surface.
+	Reports the PnL evaluations and iterations summed over the cells, the solve times and the largest difference from
+	the cold surface. The counts need the library built with BEV_ENABLE_DIAGNOSTICS defined (cmake -DBEV_DIAGNOSTICS=ON),
+	otherwise only the times are reported.
+
+	Usage:	benchmark_warm_start [path to GOOG CSV, default ../GOOG.csv] [path to sample data CSV, default ../examples/sampledata.csv]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -DBEV_ENABLE_DIAGNOSTICS -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_warm_start benchmark_warm_start.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+
+struct Totals {
+	long evaluations = 0, iterations = 0;
+	double seconds = 0;
+	bool counted = false; // false when the library was built without diagnostics
+};
+
+// Solves the surface of bev_obj, summing the counts of its cells
+Totals Solve(bev::BEV& bev_obj, bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev::SolveDiagnostics diagnostics;
+	surface = bev_obj.SolveForBEV(average_pnls, &diagnostics);
+	Totals totals;
+	totals.seconds = diagnostics.seconds;
+	totals.counted = diagnostics.enabled;
+	for (const bev::CellDiagnostics& cell : diagnostics.cells) {
+		totals.evaluations += cell.evaluations;
+		totals.iterations += cell.iterations;
+	}
+	return totals;
+}
+
+void Print(const std::string& label, const Totals& totals, const Totals& cold, double max_diff) {
+	std::cout << std::left << std::setw(26) << label << std::right;
+	if (totals.counted) {
+		std::cout << std::setw(10) << totals.evaluations << std::setw(10) << totals.iterations << std::fixed << std::setprecision(2)
+			<< std::setw(9) << (double) cold.evaluations / totals.evaluations;
+	} else {
+		std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(9) << "-";
+	}
+	std::cout << std::fixed << std::setprecision(2) << std::setw(11) << totals.seconds * 1e3 << std::scientific << std::setprecision(1)
+		<< std::setw(12) << max_diff << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::string goog_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string sample_path = argc > 2 ? argv[2] : "../examples/sampledata.csv";
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+
+	struct Data {
+		std::string name;
+		bev::BEV bev_obj;
+		double interest_rate;
+	};
+	std::vector<Data> data;
+	data.push_back({"GOOG", bev::BEV(goog_path, 0.015, strikes, maturities, -1, true, "Close"), 0.015});
+	data.push_back({"sample data", bev::BEV(sample_path, 0.065, strikes, maturities, 0), 0.065});
+
+	bool counted = true;
+	for (Data& set : data) {
+		for (bev::RootFinder root_finder : {bev::RootFinder::Secant, bev::RootFinder::NewtonBrent}) {
+			for (bool average_pnls : {true, false}) {
+				std::cout << "\n" << set.name << ", " << (root_finder == bev::RootFinder::Secant ? "secant" : "Newton-Brent") << ", "
+					<< (average_pnls ? "average PnLs" : "average BEVs") << " (" << maturities.size() << " x " << strikes.size() << ")" << std::endl;
+				std::cout << std::left << std::setw(26) << "solve" << std::right << std::setw(10) << "evals" << std::setw(10) << "iters"
+					<< std::setw(9) << "saving" << std::setw(11) << "time (ms)" << std::setw(12) << "max |diff|" << std::endl;
+				bev::BEV cold_obj = set.bev_obj, warm_obj = set.bev_obj;
+				cold_obj.SetRootFinder(root_finder);
+				warm_obj.SetRootFinder(root_finder);
+				warm_obj.SetWarmStart(true);
+				Eigen::ArrayXXd cold_surface, warm_surface;
+
+				// first solve
+				Totals cold = Solve(cold_obj, average_pnls, cold_surface);
+				Totals warm = Solve(warm_obj, average_pnls, warm_surface);
+				counted = cold.counted;
+				Print("cold", cold, cold, 0.0);
+				Print("warm, from the money out", warm, cold, (warm_surface - cold_surface).abs().maxCoeff());
+
+				// repeated solve after a change of interest rate, cold and from the previous surface
+				cold_obj.SetInterestRate(set.interest_rate + 0.01);
+				warm_obj.SetInterestRate(set.interest_rate + 0.01); // keeps the results at the old rate as warm starts
+				cold = Solve(cold_obj, average_pnls, cold_surface);
+				warm = Solve(warm_obj, average_pnls, warm_surface);
+				Print("cold, rate + 1%", cold, cold, 0.0);
+				Print("warm, previous surface", warm, cold, (warm_surface - cold_surface).abs().maxCoeff());
+			}
+		}
+	}
+	if (!counted)
+		std::cout << "\nRebuild with BEV_ENABLE_DIAGNOSTICS defined (cmake -DBEV_DIAGNOSTICS=ON) for the evaluation and iteration counts." << std::endl;
+	return 0;
+}
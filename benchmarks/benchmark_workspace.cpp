@@ -0,0 +1,118 @@
+/*
+	Heap allocations of steady-state surface solves, i.e. repeated solves over the cached terms, whose scratch memory
+	comes from the BEV object's workspace (see BEV::SetWorkspace). For each root finder, aggregation method, solve mode
+	(cell by cell or batched, cold or warm started) and precision, solves the surface of a GBM history once, which
+	builds the cached terms and sizes the workspace's arenas, then re-solves it (SetRootFinder keeps the terms and marks
+	every cell unsolved) and counts the allocations of the last re-solve, which must be zero. Then solves the surfaces of
+	further histories with new BEV objects sharing one workspace, reporting the heap allocations made by the workspace
+	itself, which must also be zero after the first surface. Exits with status 1 if any check fails.
+	Allocations are counted with bev_utils::HeapAllocations, see allocation_counter.h.
+
+	Usage:	benchmark_workspace [years of GBM data, default 20]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o benchmark_workspace benchmark_workspace.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+#include "utils.h"
+#include "workspace.h"
+#define BEV_COUNT_ALLOCATIONS
+#include "allocation_counter.h"
+
+// Allocations and wall time of one surface solve into surface
+struct Solve {
+	bev_utils::AllocationCounts allocated;
+	double seconds;
+};
+
+Solve TimeSolve(bev::BEV& bev_obj, bool average_pnls, Eigen::ArrayXXd& surface) {
+	bev_utils::AllocationCounts before = bev_utils::HeapAllocations();
+	auto start = std::chrono::steady_clock::now();
+	bev_obj.SolveForBEV(average_pnls, surface);
+	Solve solve;
+	solve.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	solve.allocated = bev_utils::HeapAllocations() - before;
+	return solve;
+}
+
+int main(int argc, char* argv[]) {
+	int years = argc > 1 ? std::atoi(argv[1]) : 20;
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	if (!bev_utils::AllocationCountingEnabled()) {
+		std::cerr << "Allocation counting is not installed." << std::endl;
+		return 1;
+	}
+
+	Eigen::ArrayXXd S;
+	data_utils::GenerateGBMData(S, 100, 0.07, 0.2, years, 12345);
+	bool passed = true;
+
+	std::cout << "\n" << years << " years of GBM data (" << maturities.size() << " maturities x " << strikes.size() << " strikes)" << std::endl;
+	std::cout << std::left << std::setw(14) << "root finder" << std::setw(14) << "aggregation" << std::setw(20) << "mode" << std::setw(11) << "precision"
+		<< std::right << std::setw(12) << "1st allocs" << std::setw(12) << "1st ms" << std::setw(12) << "re allocs" << std::setw(10) << "re ms" << std::endl;
+	for (bev::RootFinder root_finder : {bev::RootFinder::Secant, bev::RootFinder::NewtonBrent}) {
+		for (bool average_pnls : {true, false}) {
+			for (int mode = 0; mode < 4; mode++) {
+				bool batched = mode >= 2, warm_start = mode % 2 == 1;
+				for (bev::Precision precision : {bev::Precision::Double, bev::Precision::Mixed}) {
+					bev::BEV bev_obj(S, 0.015, strikes, maturities);
+					bev_obj.SetRootFinder(root_finder);
+					bev_obj.SetBatchedSolve(batched);
+					bev_obj.SetWarmStart(warm_start);
+					bev_obj.SetPrecision(precision);
+					Eigen::ArrayXXd surface;
+					Solve first = TimeSolve(bev_obj, average_pnls, surface);
+					// the first re-solve also creates the entries keeping the previous results as warm starts
+					bev_obj.SetRootFinder(root_finder);
+					TimeSolve(bev_obj, average_pnls, surface);
+					bev_obj.SetRootFinder(root_finder);
+					Solve steady = TimeSolve(bev_obj, average_pnls, surface);
+					passed = passed && steady.allocated.allocations == 0;
+
+					std::string mode_name = std::string(batched ? "batched" : "cell by cell") + (warm_start ? ", warm" : "");
+					std::cout << std::left << std::setw(14) << (root_finder == bev::RootFinder::Secant ? "secant" : "newton-brent")
+						<< std::setw(14) << (average_pnls ? "PnLs" : "BEVs") << std::setw(20) << mode_name << std::setw(11)
+						<< (precision == bev::Precision::Double ? "double" : "mixed") << std::right << std::setw(12) << first.allocated.allocations
+						<< std::fixed << std::setprecision(2) << std::setw(12) << first.seconds * 1e3 << std::setw(12) << steady.allocated.allocations
+						<< std::setw(10) << steady.seconds * 1e3 << (steady.allocated.allocations == 0 ? "" : "  FAILED") << std::endl;
+				}
+			}
+		}
+	}
+
+	// surfaces of several tickers solved through one workspace, as by SolveBatch
+	std::cout << "\nTickers sharing one workspace (batched, average BEVs, Newton-Brent)" << std::endl;
+	std::cout << std::left << std::setw(10) << "ticker" << std::right << std::setw(14) << "allocs" << std::setw(18) << "workspace allocs"
+		<< std::setw(12) << "arenas" << std::setw(14) << "bytes" << std::endl;
+	std::shared_ptr<bev_utils::Workspace> workspace = std::make_shared<bev_utils::Workspace>();
+	for (int ticker = 0; ticker < 5; ticker++) {
+		Eigen::ArrayXXd prices;
+		data_utils::GenerateGBMData(prices, 100, 0.07, 0.2 + 0.05 * ticker, years, 1000 + ticker);
+		bev::BEV bev_obj(prices, 0.015, strikes, maturities);
+		bev_obj.SetWorkspace(workspace);
+		bev_obj.SetRootFinder(bev::RootFinder::NewtonBrent);
+		bev_obj.SetBatchedSolve(true);
+		long workspace_before = workspace->HeapAllocations();
+		Eigen::ArrayXXd surface;
+		Solve solve = TimeSolve(bev_obj, false, surface);
+		long workspace_allocations = workspace->HeapAllocations() - workspace_before;
+		if (ticker > 0)
+			passed = passed && workspace_allocations == 0;
+		std::cout << std::left << std::setw(10) << ticker << std::right << std::setw(14) << solve.allocated.allocations << std::setw(18)
+			<< workspace_allocations << std::setw(12) << workspace->NumArenas() << std::setw(14) << workspace->Capacity()
+			<< (ticker > 0 && workspace_allocations > 0 ? "  FAILED" : "") << std::endl;
+	}
+
+	std::cout << "\n" << (passed ? "All steady-state solves made no heap allocations." : "Some steady-state solves allocated.") << std::endl;
+	return passed ? 0 : 1;
+}
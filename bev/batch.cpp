@@ -0,0 +1,201 @@
+#include "batch.h"
+#include "csv_loader.h"
+#include "price_cache.h"
+#include "bounded_queue.h"
+#include "workspace.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+namespace bev {
+	namespace {
+		// A series between the loading and solving stages: either a mapped price cache or the prices read from a CSV
+		struct LoadedSeries {
+			int index = -1;
+			std::string path;
+			std::shared_ptr<const data_utils::PriceCache> cache;
+			Eigen::ArrayXXd prices;
+			std::string error;
+		};
+
+		bool EndsWith(const std::string& s, const std::string& suffix) {
+			return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+		}
+
+		LoadedSeries LoadSeries(int index, const std::string& path, const std::string& col_name) {
+			LoadedSeries series;
+			series.index = index;
+			series.path = path;
+			if (EndsWith(path, ".bevc")) {
+				std::shared_ptr<data_utils::PriceCache> cache = std::make_shared<data_utils::PriceCache>();
+				data_utils::CacheStatus status = cache->Open(path);
+				if (status != data_utils::CacheStatus::Ok)
+					series.error = data_utils::CacheStatusMessage(status);
+				else if (!cache->Column(col_name))
+					series.error = "column " + col_name + " not found";
+				else
+					series.cache = cache;
+			}
+			else {
+				data_utils::CSVColumns columns;
+				data_utils::CSVStatus status = data_utils::LoadCSVColumns(path, {col_name}, columns);
+				if (status != data_utils::CSVStatus::Ok)
+					series.error = data_utils::CSVStatusMessage(status);
+				else
+					series.prices = std::move(columns.values);
+			}
+			return series;
+		}
+
+		// Message of the exception being handled, for the error of the series it was thrown for
+		std::string CurrentExceptionMessage() {
+			try {
+				throw;
+			}
+			catch (const std::exception& e) {
+				return std::string("exception thrown: ") + e.what();
+			}
+			catch (...) {
+				return "unknown exception thrown";
+			}
+		}
+
+		/*
+		LoadSeries, reporting an exception (e.g. memory exhausted reading a large file) in the series' error rather than
+		letting it escape the loader thread. */
+		LoadedSeries TryLoadSeries(int index, const std::string& path, const std::string& col_name) {
+			try {
+				return LoadSeries(index, path, col_name);
+			}
+			catch (...) {
+				LoadedSeries series;
+				series.index = index;
+				series.path = path;
+				series.error = CurrentExceptionMessage();
+				return series;
+			}
+		}
+
+		SeriesResult SolveSeries(LoadedSeries& series, const BatchSettings& settings, const std::shared_ptr<bev_utils::Workspace>& workspace) {
+			SeriesResult result;
+			result.index = series.index;
+			result.path = series.path;
+			result.error = series.error;
+			if (!result.error.empty())
+				return result;
+			const int n_prices = series.cache ? series.cache->Rows() : (int) series.prices.rows();
+			const int max_maturity = *std::max_element(settings.maturities.begin(), settings.maturities.end());
+			if (n_prices < max_maturity*21) { // checked here rather than asserted by BEV, so one short series doesn't stop the batch
+				result.error = "insufficient data for maturity of " + std::to_string(max_maturity) + " months";
+				return result;
+			}
+
+			// an exception thrown by the solve is reported like short data, so it fails its series rather than the batch
+			try {
+				BEV bev;
+				bev.SetInterestRate(settings.interest_rate);
+				bev.SetStrikes(settings.strikes);
+				bev.SetMaturities(settings.maturities);
+				bev.SetRootFinder(settings.root_finder);
+				bev.SetPrecision(settings.precision);
+				bev.SetWorkspace(workspace);
+				if (series.cache)
+					bev.SetData(series.cache, settings.col_name);
+				else
+					bev.SetData(std::move(series.prices));
+				result.surface = bev.SolveForBEV(settings.average_pnls);
+			}
+			catch (...) {
+				result.surface = Eigen::ArrayXXd();
+				result.error = CurrentExceptionMessage();
+			}
+			return result;
+		}
+	}
+
+	BatchStats SolveBatch(const std::vector<std::string>& paths, const BatchSettings& settings, std::function<void(const SeriesResult&)> on_result) {
+		assert(!settings.strikes.empty() && !settings.maturities.empty() && "Batch needs strikes and maturities.");
+		auto start = std::chrono::steady_clock::now();
+		const int n_series = (int) paths.size();
+		int n_solvers = settings.n_threads > 0 ? settings.n_threads : (int) std::thread::hardware_concurrency();
+		n_solvers = std::max(1, std::min(n_solvers, n_series));
+		// loading (mapping or one parse per file) is cheap next to solving a surface, so a few loaders keep the solvers fed
+		const int n_loaders = std::max(1, std::min(n_solvers / 8, n_series));
+		const int max_resident = settings.max_resident > 0 ? settings.max_resident : 2*n_solvers;
+
+		thread_utils::BoundedQueue<LoadedSeries> queue(max_resident);
+		std::atomic<int> next_series(0);
+		std::atomic<int> loaders_running(n_loaders);
+		std::mutex result_mutex;
+		// scratch memory of the solves, one arena per solver thread reused from series to series
+		std::shared_ptr<bev_utils::Workspace> workspace = std::make_shared<bev_utils::Workspace>(64 * 1024, n_solvers);
+		BatchStats stats;
+		stats.n_series = n_series;
+
+		// first exception thrown outside the load or solve of a series (e.g. by on_result), rethrown once the threads have stopped
+		std::exception_ptr pipeline_error;
+		std::mutex error_mutex;
+		auto stop_pipeline = [&] {
+			{
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!pipeline_error)
+					pipeline_error = std::current_exception();
+			}
+			next_series = n_series; // loaders take no more series
+			queue.Close();
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(n_loaders + n_solvers);
+		try {
+			for (int i = 0; i < n_loaders; i++) {
+				threads.emplace_back([&] {
+					try {
+						for (int k = next_series++; k < n_series; k = next_series++)
+							queue.Push(TryLoadSeries(k, paths[k], settings.col_name));
+						if (--loaders_running == 0)
+							queue.Close();
+					}
+					catch (...) {
+						stop_pipeline();
+					}
+				});
+			}
+			for (int i = 0; i < n_solvers; i++) {
+				threads.emplace_back([&] {
+					try {
+						LoadedSeries series;
+						while (queue.Pop(series)) {
+							SeriesResult result = SolveSeries(series, settings, workspace);
+							series = LoadedSeries(); // release the series' memory before waiting for the next
+							std::lock_guard<std::mutex> lock(result_mutex);
+							if (!result.error.empty())
+								stats.n_failed++;
+							if (on_result)
+								on_result(result);
+						}
+					}
+					catch (...) {
+						stop_pipeline();
+					}
+				});
+			}
+		}
+		catch (...) {
+			stop_pipeline(); // a thread could not be started
+		}
+		// joined whatever happened, as destroying a running std::thread would terminate
+		for (std::thread& thread : threads)
+			thread.join();
+		if (pipeline_error)
+			std::rethrow_exception(pipeline_error);
+
+		stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef BEV_BATCH_H
+#define BEV_BATCH_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include <string>
+#include <functional>
+#include "bev.h"
+
+namespace bev {
+	/*
+	Batch engine solving the BEV surfaces of a whole universe of price series (e.g. one CSV or price cache per ticker) 
+	on a shared strike/maturity grid.
+
+	Loading and solving run as a two-stage pipeline: loader threads read series (CSV files through 
+	data_utils::LoadCSVColumns, ".bevc" price caches by memory-mapping, see price_cache.h) into a bounded queue, and 
+	solver threads take them off the queue and solve each series' surface with its own (serial) BEV object. A series 
+	is therefore only resident from being loaded until its surface has been handed to the caller: at most max_resident
+	series wait in the queue, one more per loader thread waits to be pushed onto it (when it is full) and one per solver
+	thread is being solved, whatever the size of the universe.
+	USAGE:	BatchSettings settings;
+			settings.strikes = {0.9, 1.0, 1.1}; settings.maturities = {1, 3, 6};
+			SolveBatch(data_utils::ListFiles("prices", ".csv"), settings, [] (const SeriesResult& result) { ... });
+			The callback is called once per series, in order of completion (not of paths), one call at a time. */
+
+	struct BatchSettings {
+		double interest_rate = 0.015;
+		std::vector<double> strikes;
+		std::vector<int> maturities;
+		bool average_pnls = true; // see SolveForBEV
+		RootFinder root_finder = RootFinder::Secant;
+		Precision precision = Precision::Double; // see BEV::SetPrecision
+		std::string col_name = "Close"; // column of the CSVs/price caches holding the prices
+		int n_threads = 0; // number of solver threads, 0 => std::thread::hardware_concurrency()
+		int max_resident = 0; // most series loaded and waiting to be solved, 0 => twice the number of solver threads
+	};
+
+	// Outcome for one series
+	struct SeriesResult {
+		int index; // position of the series in the paths given to SolveBatch
+		std::string path;
+		Eigen::ArrayXXd surface; // as returned by SolveForBEV, empty on error
+		std::string error; // empty on success, otherwise why the series was skipped (unreadable file, too little data, exception thrown, ...)
+	};
+
+	struct BatchStats {
+		int n_series = 0;
+		int n_failed = 0;
+		double seconds = 0; // wall time of the whole batch, loading included
+		double SeriesPerSecond() const { return seconds > 0 ? n_series / seconds : 0; };
+	};
+
+	/*
+	Solves the surface of every series in paths as described above, passing each to on_result. An exception thrown
+	loading or solving a series is reported in its result; one thrown otherwise (e.g. by on_result) stops the batch and
+	is rethrown once its threads have finished. */
+	BatchStats SolveBatch(const std::vector<std::string>& paths, const BatchSettings& settings, std::function<void(const SeriesResult&)> on_result);
+}
+
+#endif
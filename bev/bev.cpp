@@ -1,19 +1,54 @@
 #include "bev.h"
 #include "utils.h"
+#include "thread_pool.h"
+#include "price_cache.h"
+#include "philox.h"
+#include "workspace.h"
+#include "result_cache.h"
 #include <Eigen/Dense>
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include <string>
 #include <cmath>
 #include <vector>
+#include <limits>
+#include <chrono>
 
 using namespace bev;
 
+#ifdef BEV_ENABLE_DIAGNOSTICS
+namespace {
+	double SecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Adds a root solve, with the PnL re-evaluated at its root, to the diagnostics of its cell
+	void RecordSolve(CellDiagnostics& cell, const bev_utils::RootResult& root, double pnl, double seconds) {
+		cell.solves++;
+		cell.iterations += root.iterations;
+		cell.evaluations += root.evaluations;
+		cell.seconds += seconds;
+		if (!(std::abs(pnl) <= cell.max_abs_pnl)) // also keeps a NaN
+			cell.max_abs_pnl = std::abs(pnl);
+		if (root.stop == bev_utils::RootStop::XTol)
+			cell.xtol_stops++;
+		else if (root.stop == bev_utils::RootStop::FTol)
+			cell.ftol_stops++;
+		if (!root.converged)
+			cell.not_converged++;
+		if (!std::isfinite(root.root))
+			cell.nan_roots++;
+	}
+}
+#endif
+
 // Function which tests whether data inputted is valid. The Eigen array must be a column vector with enough/adequate points
 // corresponding to the terms/maturities entered. 
 void BEV::DataValid() {
-	assert(path_.cols() == 1 && "Data must be an Eigen array with dimensions (N, 1) i.e. column vector.");
 	if (maturities_.size() > 0) { // check if maturities_ has been initialised
 		for (int m : maturities_)
-			assert(path_.size() >= m*21 && "Insufficient data size for maturity selected."); // otherwise not enough data for maturity which fails this test
+			assert(path_size_ >= m*21 && "Insufficient data size for maturity selected."); // otherwise not enough data for maturity which fails this test
 	}
 }
 
@@ -21,16 +56,14 @@ void BEV::DataValid() {
 /*
 Construct with filepath to CSV data.
 Passes other necessary parameters to CSV parser, i.e. header, column name, column number. */
-BEV::BEV(std::string csv_path, int col_no, bool header, std::string col_name) 
-	: path_(data_utils::CSVToEigenArray(csv_path, col_no, header, col_name)) 
-{
+BEV::BEV(std::string csv_path, int col_no, bool header, std::string col_name) {
+	SetPath(data_utils::CSVToEigenArray(csv_path, col_no, header, col_name));
 	DataValid();
 }
 /*
 Construct with Eigen array. */
-BEV::BEV(Eigen::ArrayXXd path)
-	: path_(path)
-{
+BEV::BEV(Eigen::ArrayXXd path) {
+	SetPath(std::move(path));
 	DataValid();
 }
 /*	
@@ -39,38 +72,162 @@ which will give a single BEV result when SolveForBEV is called, or multiple stri
 for a single skew, or multiple strikes and maturities for a surface. 
 As above, header, col_name and col_no relate to the CSV data and which column is desired. */
 BEV::BEV(std::string csv_path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities, int col_no, bool header, std::string col_name)
-	: path_(data_utils::CSVToEigenArray(csv_path, col_no, header, col_name))
-	, interest_rate_(interest_rate)
-	, strikes_(strikes)
-	, maturities_(maturities)
+	: interest_rate_(interest_rate)
+	, strikes_(std::move(strikes))
+	, maturities_(std::move(maturities))
 {
+	SetPath(data_utils::CSVToEigenArray(csv_path, col_no, header, col_name));
 	DataValid();
 }
 // Same constructor except with Eigen array instead of filepath to csv
 BEV::BEV(Eigen::ArrayXXd path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities)
-	: path_(path)
-	, interest_rate_(interest_rate)
-	, strikes_(strikes)
-	, maturities_(maturities)
+	: interest_rate_(interest_rate)
+	, strikes_(std::move(strikes))
+	, maturities_(std::move(maturities))
 {
+	SetPath(std::move(path));
 	DataValid();
 }
+// Same constructor with a view of caller-owned prices instead, see SetData(Eigen::Map<const Eigen::ArrayXd>, std::shared_ptr<const void>)
+BEV::BEV(Eigen::Map<const Eigen::ArrayXd> path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities, std::shared_ptr<const void> owner)
+	: interest_rate_(interest_rate)
+	, strikes_(std::move(strikes))
+	, maturities_(std::move(maturities))
+{
+	SetData(path, std::move(owner));
+}
 
 // SETTERS
+void BEV::SetPath(Eigen::ArrayXXd path) {
+	assert(path.cols() == 1 && "Data must be an Eigen array with dimensions (N, 1) i.e. column vector.");
+	std::shared_ptr<Eigen::ArrayXXd> owner = std::make_shared<Eigen::ArrayXXd>(std::move(path));
+	path_data_ = owner->data();
+	path_size_ = owner->size();
+	path_owner_ = owner;
+	appended_path_.reset();
+}
 void BEV::SetData(std::string csv_path, int col_no, bool header, std::string col_name) { 
-	path_ = data_utils::CSVToEigenArray(csv_path, col_no, header, col_name);
+	SetPath(data_utils::CSVToEigenArray(csv_path, col_no, header, col_name));
+	ClearResults();
 	DataValid();
 }
 void BEV::SetData(Eigen::ArrayXXd path) { 
-	path_ = path;
+	SetPath(std::move(path));
+	ClearResults();
+	DataValid();
+}
+void BEV::SetData(std::shared_ptr<const data_utils::PriceCache> cache, std::string col_name) {
+	const double* column = cache->Column(col_name);
+	assert(column && "Column not found in price cache.");
+	path_data_ = column;
+	path_size_ = cache->Rows();
+	path_owner_ = cache;
+	appended_path_.reset();
+	ClearResults();
+	DataValid();
+}
+/*
+The prices are read in place for as long as the BEV object uses them: they must outlive it (and its copies) unless
+owner, which is kept alive until the data is replaced, holds them. */
+void BEV::SetData(Eigen::Map<const Eigen::ArrayXd> path, std::shared_ptr<const void> owner) {
+	path_data_ = path.data();
+	path_size_ = path.size();
+	path_owner_ = std::move(owner);
+	appended_path_.reset();
+	ClearResults();
 	DataValid();
 }
 void BEV::SetMaturities(std::vector<int> maturities) {
-	maturities_ = maturities; 
-	if (path_.size() > 0) // check if path has been initialised
+	maturities_ = std::move(maturities); 
+	if (path_size_ > 0) // check if path has been initialised
 		DataValid(); 
 }
 
+void BEV::SetSubPathStride(int stride) {
+	assert(stride >= 0 && "Subpath stride must be non-negative.");
+	sub_path_stride_ = stride;
+	ClearResults();
+}
+
+void BEV::SetChunkedEvaluation(int chunk_prices) {
+	assert(chunk_prices >= 0 && "Chunk size must be non-negative.");
+	chunk_prices_ = chunk_prices;
+	ClearResults();
+}
+
+void BEV::ClearResults() {
+	ResetResults();
+	maturity_cache_.clear();
+}
+
+/*
+The solved roots of each cell replace its previous ones, while cells not solved since the last reset keep theirs. The 
+results are cleared in place, so their vectors keep their capacity for the next solve. */
+void BEV::ResetResults() {
+	for (auto& maturity : maturity_cache_) {
+		for (auto& entry : maturity.second.strikes) {
+			StrikeCache& results = entry.second;
+			StrikeCache& previous = previous_results_[maturity.first][entry.first];
+			if (results.average_paths > 0) {
+				previous.average_BEV = results.average_BEV;
+				previous.average_paths = results.average_paths;
+			}
+			if (!results.sub_path_BEVs.empty())
+				previous.sub_path_BEVs = results.sub_path_BEVs;
+			results.average_BEV = std::numeric_limits<double>::quiet_NaN();
+			results.average_paths = 0;
+			results.sub_path_BEVs.clear();
+			results.seeded_sub_paths = false;
+#ifdef BEV_ENABLE_DIAGNOSTICS
+			results.diagnostics = CellDiagnostics();
+#endif
+		}
+	}
+}
+
+bev_utils::Workspace& BEV::Scratch() {
+	if (!workspace_)
+		workspace_ = std::make_shared<bev_utils::Workspace>();
+	return *workspace_;
+}
+
+/*
+Extends the history shared by the cached contexts of the maturities solved so far, and adds the subpaths completed by 
+the new prices to each: the next non-overlapping blocks of the path, or the next windows along the path when a stride
+is set. */
+void BEV::AppendPrices(const Eigen::ArrayXd& prices) {
+	// the path is extended in place once it is the object's own buffer, unless a copy of the object reads it too
+	if (!(appended_path_ && path_owner_ == appended_path_ && appended_path_.use_count() == 2)) {
+		std::shared_ptr<std::vector<double>> path = std::make_shared<std::vector<double>>();
+		path->reserve(2 * (path_size_ + prices.size()));
+		path->assign(path_data_, path_data_ + path_size_);
+		appended_path_ = path;
+		path_owner_ = path;
+	}
+	appended_path_->insert(appended_path_->end(), prices.data(), prices.data() + prices.size()); // grows geometrically
+	path_data_ = appended_path_->data();
+	path_size_ = appended_path_->size();
+	std::vector<PnLContext*> contexts;
+	std::vector<int> strides;
+	for (auto& entry : maturity_cache_) {
+		contexts.push_back(&entry.second.context);
+		strides.push_back(sub_path_stride_ > 0 ? sub_path_stride_ : entry.first*days_per_month_);
+	}
+	// the new prices as they follow the old ones in the path, as chunked contexts read the path in place
+	PnLContext::AppendSharedHistory(contexts, strides, path_data_ + path_size_ - prices.size(), prices.size());
+}
+
+void BEV::SetThreadCount(int n_threads) {
+	assert(n_threads >= 0 && "Thread count must be non-negative (0 uses all hardware threads).");
+	if (n_threads == 0)
+		n_threads = std::max(1, (int) std::thread::hardware_concurrency());
+	n_threads_ = n_threads;
+	if (n_threads_ > 1)
+		thread_pool_ = std::make_shared<thread_utils::ThreadPool>(n_threads_);
+	else
+		thread_pool_.reset();
+}
+
 // SOLVING FOR BEV
 /*
 Call function to solve for break-even volatilities of the given path/data with the set strikes and maturities.
@@ -80,69 +237,1085 @@ The parameter average_pnls is used to set whether the break-even volatility shou
 the average of the subpath PnLs (when true), or rather (when false) averaging the break-even volatilities 
 of each subpath for a specific maturity, strike combination. 
 Returns an Eigen array where the rows correspond to the maturities and columns to the strikes used, i.e.
-each row represents and volatility skew. */
+each row represents and volatility skew. 
+When a thread pool is set (see SetThreadCount), the cells are solved in parallel, each cell by a single thread. */
 Eigen::ArrayXXd BEV::SolveForBEV(bool average_pnls) {
+	Eigen::ArrayXXd BEV_array;
+	SolveForBEV(average_pnls, BEV_array);
+	return BEV_array;
+}
 
-	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> BEV_array(maturities_.size(), strikes_.size());
-	int row = 0; 
-	int col = 0;
+/*
+Every solve task leases its own arena of the workspace, so the scratch buffers of the cells solved by one thread reuse
+the same memory. */
+void BEV::SolveForBEV(bool average_pnls, Eigen::ArrayXXd& BEV_array) {
 
-	for (int term_in_months : maturities_) {
+	BEV_array.resize(maturities_.size(), strikes_.size()); // no-op when already of this shape
+	int n_strikes = strikes_.size();
+	bev_utils::Workspace& workspace = Scratch();
+	bev_utils::Workspace::Lease scratch = workspace.Acquire();
 
-		Eigen::ArrayXXd paths = GetSubPaths(term_in_months);
-		int days_to_maturity = term_in_months*days_per_month_;
-		Eigen::Array<double, 1, Eigen::Dynamic> times_to_maturity = Eigen::ArrayXd::LinSpaced(days_to_maturity, (double) days_to_maturity-1, 0.0) * dt_;
+	// The subpaths, times to maturity and cached PnL terms only depend on the maturity, so fetch (or build) them, and the 
+	// results of each strike, before solving any cells
+	MaturityCache** caches = scratch->Allocate<MaturityCache*>(maturities_.size());
+	for (int row = 0; row < (int) maturities_.size(); row++) {
+		MaturityCache& cache = CachedMaturity(maturities_[row]);
+		for (double strike : strikes_)
+			cache.strikes[strike];
+		caches[row] = &cache;
+	}
 
-		for (double strike : strikes_) {
+	// a strike (or maturity) given more than once is solved once, in the column (row) holding it first, as its results are
+	// kept by strike and maturity and read into every cell holding them; solving it twice would race on them
+	int* rows = scratch->Allocate<int>(maturities_.size());
+	int n_rows = 0;
+	for (int row = 0; row < (int) maturities_.size(); row++) {
+		if (std::find(maturities_.begin(), maturities_.begin() + row, maturities_[row]) == maturities_.begin() + row)
+			rows[n_rows++] = row;
+	}
+	int* columns = scratch->Allocate<int>(n_strikes);
+	int n_columns = 0;
+	for (int col = 0; col < n_strikes; col++) {
+		if (std::find(strikes_.begin(), strikes_.begin() + col, strikes_[col]) == strikes_.begin() + col)
+			columns[n_columns++] = col;
+	}
+
+	// cells missing from the results are looked up in the result cache first (see SetResultCache), and those left to
+	// solve are stored once solved unless solved from warm starts. The path is only hashed when some cell is missing.
+	int n_cells = n_rows * n_columns;
+	char* to_store = result_cache_ ? scratch->Allocate<char>(n_cells, 0) : nullptr;
+	data_utils::Hasher key;
+	bool keyed = false;
+	for (int cell = 0; cell < n_cells; cell++) {
+		int row = rows[cell / n_columns];
+		int col = columns[cell % n_columns];
+		StrikeCache& results = caches[row]->strikes.at(strikes_[col]);
+		int n_paths = caches[row]->context.NumPaths();
+		if (average_pnls ? results.average_paths == n_paths : (int) results.sub_path_BEVs.size() == n_paths)
+			continue;
+		// the average PnL root is re-solved from the previous one, if any
+		bool seeded = warm_start_ || (average_pnls ? !std::isnan(results.average_BEV) : results.seeded_sub_paths);
+		if (!average_pnls && warm_start_)
+			results.seeded_sub_paths = true;
+		if (!to_store || warm_start_)
+			continue;
+		if (!keyed) {
+			key = ResultKey();
+			keyed = true;
+		}
+		to_store[cell] = !LoadResults(key, maturities_[row], strikes_[col], average_pnls, n_paths, results) && !seeded;
+	}
+
+	if (batched_solve_) {
+		// one task per maturity, solving all strikes (and subpaths) of the skew in lockstep
+		auto SolveSkew = [&] (int k) {
+			bev_utils::Workspace::Lease skew_scratch = workspace.Acquire();
+			SolveSkewLockstep(maturities_[rows[k]], *caches[rows[k]], average_pnls, columns, n_columns, *skew_scratch);
+		};
+		if (thread_pool_)
+			thread_pool_->ParallelFor(n_rows, SolveSkew);
+		else {
+			for (int k = 0; k < n_rows; k++)
+				SolveSkew(k);
+		}
+	} else {
+		auto SolveCell = [&] (int cell, bev_utils::ScratchArena& cell_scratch) {
+			bev_utils::ScratchArena::Frame frame(cell_scratch);
+			int row = rows[cell / n_columns];
+			int col = columns[cell % n_columns];
+			PnLContext context = caches[row]->context.WithStrike(strikes_[col]);
+			StrikeCache& results = caches[row]->strikes.at(strikes_[col]);
 
 			if (average_pnls) {
-				auto PnLToZero = [&paths, &strike, &times_to_maturity, this] (double sigma) -> double {
-					return this->ContinuousDHPnL(sigma, paths, strike, times_to_maturity);
-				};
-				BEV_array(row, col) = bev_utils::RootBySecantMethod(PnLToZero, 0.99);
+				UpdateAverageBEV(context, results, warm_start_ ? FindWarmStart(maturities_[row], *caches[row], strikes_[col], -1) : WarmStart{results.average_BEV});
 			} else {
-				Eigen::Array<double, Eigen::Dynamic, 1> path_BEVs(paths.rows(), 1);
-				int n = 0;
-				for (auto path : paths.rowwise()) {
-					auto PnLToZero = [&path, &strike, &times_to_maturity, this] (double sigma) -> double {
-						return this->ContinuousDHPnL(sigma, path, strike, times_to_maturity);
-					};
-					path_BEVs(n, 0) = bev_utils::RootBySecantMethod(PnLToZero, 0.99);
-					n++;
+				WarmStart* starts = nullptr;
+				if (warm_start_) {
+					int n_solved = results.sub_path_BEVs.size();
+					starts = cell_scratch.Allocate<WarmStart>(context.NumPaths() - n_solved);
+					for (int n = n_solved; n < context.NumPaths(); n++)
+						starts[n - n_solved] = FindWarmStart(maturities_[row], *caches[row], strikes_[col], n);
 				}
-				BEV_array(row, col) = path_BEVs.mean();
-			}	
-			col++;
+				UpdateSubPathBEVs(context, results, false, starts, cell_scratch);
+			}
+		};
+
+		if (warm_start_) {
+			// one task per maturity, continuing from the strike closest to the money outwards so that each strike is 
+			// seeded from the solved strikes next to it (strikes equally far from the money in their given order)
+			int* order = scratch->Allocate<int>(n_columns);
+			for (int k = 0; k < n_columns; k++)
+				order[k] = k;
+			std::sort(order, order + n_columns, [&] (int a, int b) { 
+				double distance_a = std::abs(std::log(strikes_[columns[a]])), distance_b = std::abs(std::log(strikes_[columns[b]]));
+				return distance_a < distance_b || (distance_a == distance_b && a < b); 
+			});
+			auto SolveSkew = [&] (int unique_row) {
+				bev_utils::Workspace::Lease skew_scratch = workspace.Acquire();
+				for (int k = 0; k < n_columns; k++)
+					SolveCell(unique_row*n_columns + order[k], *skew_scratch);
+			};
+			if (thread_pool_)
+				thread_pool_->ParallelFor(n_rows, SolveSkew);
+			else {
+				for (int unique_row = 0; unique_row < n_rows; unique_row++)
+					SolveSkew(unique_row);
+			}
+		} else {
+			if (thread_pool_) {
+				thread_pool_->ParallelFor(n_cells, [&] (int cell) {
+					bev_utils::Workspace::Lease cell_scratch = workspace.Acquire();
+					SolveCell(cell, *cell_scratch);
+				});
+			} else {
+				for (int cell = 0; cell < n_cells; cell++)
+					SolveCell(cell, *scratch);
+			}
+		}
+	}
+
+	if (to_store) {
+		for (int cell = 0; cell < n_cells; cell++) {
+			if (!to_store[cell])
+				continue;
+			int row = rows[cell / n_columns];
+			double strike = strikes_[columns[cell % n_columns]];
+			StoreResults(key, maturities_[row], strike, average_pnls, caches[row]->strikes.at(strike));
 		}
-		row++;
-		col = 0;
 	}
 
+	for (int row = 0; row < (int) maturities_.size(); row++) {
+		for (int col = 0; col < n_strikes; col++) {
+			const StrikeCache& results = caches[row]->strikes.at(strikes_[col]);
+			if (average_pnls) {
+				BEV_array(row, col) = results.average_BEV;
+			} else {
+				// averaged from an aligned copy, so the sum is vectorised exactly as over an Eigen array
+				bev_utils::ScratchArena::Frame frame(*scratch);
+				int n_paths = results.sub_path_BEVs.size();
+				double* path_BEVs = scratch->Allocate<double>(n_paths);
+				std::copy(results.sub_path_BEVs.begin(), results.sub_path_BEVs.end(), path_BEVs);
+				BEV_array(row, col) = Eigen::Map<const Eigen::ArrayXd, Eigen::Aligned64>(path_BEVs, n_paths).mean();
+			}
+		}
+	}
+}
+
+/*
+The diagnostics of the requested cells are reset before solving, so cells whose results were cached by an earlier solve
+report no solves. */
+Eigen::ArrayXXd BEV::SolveForBEV(bool average_pnls, SolveDiagnostics* diagnostics) {
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	for (int term_in_months : maturities_) {
+		MaturityCache& cache = CachedMaturity(term_in_months);
+		for (double strike : strikes_)
+			cache.strikes[strike].diagnostics = CellDiagnostics();
+	}
+	auto start = std::chrono::steady_clock::now();
+#endif
+	Eigen::ArrayXXd BEV_array = SolveForBEV(average_pnls);
+	if (diagnostics) {
+		*diagnostics = SolveDiagnostics();
+		diagnostics->rows = maturities_.size();
+		diagnostics->cols = strikes_.size();
+#ifdef BEV_ENABLE_DIAGNOSTICS
+		diagnostics->enabled = true;
+		diagnostics->seconds = SecondsSince(start);
+		for (int term_in_months : maturities_) {
+			for (double strike : strikes_)
+				diagnostics->cells.push_back(maturity_cache_.at(term_in_months).strikes.at(strike).diagnostics);
+		}
+#endif
+	}
 	return BEV_array;
 }
 
+namespace {
+	/*
+	Draws a bootstrap resample of n_paths subpaths, in runs of block_length consecutive subpaths, from the Philox stream
+	numbered stream. Writes how often each subpath was drawn to counts. */
+	void DrawResampleCounts(int n_paths, int block_length, const data_utils::Philox4x32& rng, uint64_t stream, int* counts) {
+		int length = std::min(block_length, n_paths);
+		uint64_t n_starts = n_paths - length + 1;
+		std::fill(counts, counts + n_paths, 0);
+		uint32_t words[4];
+		for (int drawn = 0, k = 0; drawn < n_paths; k++) {
+			if (k % 4 == 0)
+				rng.Generate(k / 4, stream, words);
+			int start = (int) (((uint64_t) words[k % 4] * n_starts) >> 32); // uniform on [0, n_starts)
+			for (int n = start; n < start + length && drawn < n_paths; n++, drawn++)
+				counts[n]++;
+		}
+	}
+
+	// Drops the resamples without a root (NaN or infinite BEVs), which the bands and standard errors leave out
+	void RemoveNonFinite(std::vector<double>& values) {
+		values.erase(std::remove_if(values.begin(), values.end(), [] (double x) { return !std::isfinite(x); }), values.end());
+	}
+
+	// Percentile at level (in [0, 1]) of the finite values, linearly interpolated between order statistics
+	double Percentile(std::vector<double> values, double level) {
+		RemoveNonFinite(values);
+		if (values.empty())
+			return std::numeric_limits<double>::quiet_NaN();
+		std::sort(values.begin(), values.end());
+		double position = level * (values.size() - 1);
+		int below = (int) std::floor(position);
+		int above = std::min(below + 1, (int) values.size() - 1);
+		return values[below] + (position - below) * (values[above] - values[below]);
+	}
+
+	// Sample standard deviation of the finite values, 0 for a single value and NaN for none
+	double StandardDeviation(std::vector<double> values) {
+		RemoveNonFinite(values);
+		if (values.size() < 2)
+			return values.empty() ? std::numeric_limits<double>::quiet_NaN() : 0.0;
+		Eigen::Map<const Eigen::ArrayXd> finite(values.data(), values.size());
+		return std::sqrt((finite - finite.mean()).square().sum() / (finite.size() - 1));
+	}
+}
+
+/*
+Every resample of a maturity is used for all of its strikes, so the resampled skews are consistent. Resample b of the
+maturity of term months uses the Philox stream (term, b), independent of the maturities and thread count chosen. */
+BootstrapBands BEV::Bootstrap(int n_resamples, std::vector<double> levels, bool average_pnls, int block_length, uint64_t seed) {
+	assert(n_resamples > 0 && block_length > 0 && "Bootstrap needs at least one resample and a positive block length.");
+	int n_strikes = strikes_.size();
+	int n_cells = maturities_.size() * n_strikes;
+	BootstrapBands bands;
+	bands.levels = levels;
+	bands.estimate = SolveForBEV(average_pnls); // also caches the full-sample roots, or subpath BEVs, the resamples start from
+	const data_utils::Philox4x32 rng(seed);
+	bev_utils::Workspace& workspace = Scratch();
+	std::vector<std::vector<double>> resampled_BEVs(n_cells, std::vector<double>(n_resamples));
+
+	for (int row = 0; row < (int) maturities_.size(); row++) {
+		const MaturityCache& cache = CachedMaturity(maturities_[row]);
+		int n_paths = cache.context.NumPaths();
+		std::vector<PnLContext> contexts;
+		std::vector<const StrikeCache*> results;
+		for (double strike : strikes_) {
+			contexts.push_back(cache.context.WithStrike(strike));
+			results.push_back(&cache.strikes.at(strike));
+		}
+
+		auto SolveResample = [&] (int b) {
+			bev_utils::Workspace::Lease scratch = workspace.Acquire();
+			int* counts = scratch->Allocate<int>(n_paths);
+			DrawResampleCounts(n_paths, block_length, rng, ((uint64_t) maturities_[row] << 32) | (uint64_t) b, counts);
+			int* paths = scratch->Allocate<int>(n_paths);
+			double* weights = scratch->Allocate<double>(n_paths);
+			Resample resample;
+			for (int n = 0; n < n_paths; n++) {
+				if (counts[n] > 0) {
+					paths[resample.n_paths] = n;
+					weights[resample.n_paths++] = counts[n];
+				}
+			}
+			resample.paths = paths;
+			resample.weights = weights;
+			for (int col = 0; col < n_strikes; col++) {
+				double BEV = 0;
+				if (average_pnls) {
+					BEV = SolveBEV(contexts[col], resample, results[col]->average_BEV);
+				} else {
+					for (int k = 0; k < resample.n_paths; k++)
+						BEV += resample.weights[k] * results[col]->sub_path_BEVs[resample.paths[k]];
+					BEV /= n_paths;
+				}
+				resampled_BEVs[row*n_strikes + col][b] = BEV;
+			}
+		};
+		if (thread_pool_)
+			thread_pool_->ParallelFor(n_resamples, SolveResample);
+		else {
+			for (int b = 0; b < n_resamples; b++)
+				SolveResample(b);
+		}
+	}
+
+	for (double level : levels) {
+		Eigen::ArrayXXd band(maturities_.size(), n_strikes);
+		for (int cell = 0; cell < n_cells; cell++)
+			band(cell / n_strikes, cell % n_strikes) = Percentile(resampled_BEVs[cell], level);
+		bands.bands.push_back(band);
+	}
+	bands.standard_errors.resize(maturities_.size(), n_strikes);
+	for (int cell = 0; cell < n_cells; cell++)
+		bands.standard_errors(cell / n_strikes, cell % n_strikes) = StandardDeviation(resampled_BEVs[cell]);
+	return bands;
+}
+
+namespace {
+	// Intervals between the first nodes of a dense skew, spread evenly in log strike
+	const int kDenseInitialIntervals = 8;
+
+	// Value at t of the polynomial through the n points (x[k], y[k]), in Lagrange form
+	double LagrangeInterpolate(const double* x, const double* y, int n, double t) {
+		double value = 0;
+		for (int k = 0; k < n; k++) {
+			double weight = 1;
+			for (int m = 0; m < n; m++) {
+				if (m != k)
+					weight *= (t - x[m]) / (x[k] - x[m]);
+			}
+			value += weight * y[k];
+		}
+		return value;
+	}
+}
+
+/*
+The nodes are strikes of the grid, and an interval between two nodes is split at the strike of the grid closest to its
+middle in log strike. Where the nodes around an interval give fewer than three finite points, there is no second 
+interpolant to compare with, and the interval is split as if its estimate were infinite. */
+DenseSkew BEV::SolveDenseSkew(int term_in_months, std::vector<double> strikes, bool average_pnls, double tolerance, int max_nodes) {
+	assert(!strikes.empty() && strikes.front() > 0 && std::adjacent_find(strikes.begin(), strikes.end(), std::greater_equal<double>()) == strikes.end()
+		&& "Strikes must be positive and increasing.");
+	assert(path_size_ >= term_in_months*days_per_month_ && "Insufficient data size for maturity selected.");
+	assert((max_nodes == 0 || max_nodes >= 2) && "At least two nodes are needed to interpolate.");
+	const double infinity = std::numeric_limits<double>::infinity();
+	int n = strikes.size();
+	DenseSkew skew;
+	skew.BEVs = Eigen::ArrayXd::Constant(n, std::numeric_limits<double>::quiet_NaN());
+	skew.error_estimates = Eigen::ArrayXd::Zero(n);
+	std::vector<double> x(n);
+	for (int k = 0; k < n; k++)
+		x[k] = std::log(strikes[k]);
+	std::vector<bool> is_node(n, false);
+	// round in which each node was solved, and the difference between its interpolated and solved BEVs (infinite for the
+	// first nodes, which were not interpolated)
+	std::vector<int> added(n, 0);
+	std::vector<double> split_error(n, infinity);
+	// index of the strike in [first, last] closest to the log strike target
+	auto Closest = [&] (int first, int last, double target) {
+		int k = std::min((int) (std::lower_bound(x.begin() + first, x.begin() + last + 1, target) - x.begin()), last);
+		return k > first && target - x[k - 1] < x[k] - target ? k - 1 : k;
+	};
+
+	std::vector<int> new_nodes;
+	int n_intervals = max_nodes > 0 ? std::min(kDenseInitialIntervals, max_nodes - 1) : kDenseInitialIntervals;
+	for (int k = 0; k <= n_intervals; k++) {
+		int node = Closest(0, n - 1, x[0] + (x[n - 1] - x[0]) * k / n_intervals);
+		if (!is_node[node]) {
+			is_node[node] = true;
+			new_nodes.push_back(node);
+		}
+	}
+
+	std::vector<int> nodes;
+	std::vector<double> node_x, node_y, slopes;
+	std::vector<std::pair<double, int>> splits; // (estimate, strike to add as a node) of the intervals over tolerance
+	Eigen::ArrayXXd solved;
+	while (!new_nodes.empty()) {
+		// the new nodes are solved as a skew of their own, with the object's settings, and kept with its other results
+		std::sort(new_nodes.begin(), new_nodes.end());
+		std::vector<double> node_strikes;
+		for (int node : new_nodes)
+			node_strikes.push_back(strikes[node]);
+		{
+			// the object's grid is swapped for the nodes while they are solved, and restored however the solve ends
+			struct GridRestore {
+				BEV& bev;
+				std::vector<double> strikes;
+				std::vector<int> maturities;
+				~GridRestore() {
+					bev.strikes_ = std::move(strikes);
+					bev.maturities_ = std::move(maturities);
+				}
+			} restore{*this, std::move(strikes_), std::move(maturities_)};
+			strikes_ = std::move(node_strikes);
+			maturities_ = {term_in_months};
+			SolveForBEV(average_pnls, solved);
+		}
+		skew.rounds++;
+
+		double refinement_error = 0;
+		for (int k = 0; k < (int) new_nodes.size(); k++) {
+			int node = new_nodes[k];
+			double interpolated = skew.BEVs(node);
+			added[node] = skew.rounds;
+			if (skew.rounds > 1) {
+				if (std::isfinite(interpolated) && std::isfinite(solved(0, k)))
+					split_error[node] = std::abs(interpolated - solved(0, k));
+				else
+					split_error[node] = std::isnan(interpolated) && std::isnan(solved(0, k)) ? 0.0 : infinity;
+				if (std::isfinite(split_error[node]))
+					refinement_error = std::max(refinement_error, split_error[node]);
+			}
+			skew.BEVs(node) = solved(0, k);
+			skew.error_estimates(node) = 0;
+		}
+		if (skew.rounds > 1)
+			skew.max_refinement_error = refinement_error;
+
+		nodes.clear();
+		node_x.clear();
+		node_y.clear();
+		for (int k = 0; k < n; k++) {
+			if (is_node[k]) {
+				nodes.push_back(k);
+				node_x.push_back(x[k]);
+				node_y.push_back(skew.BEVs(k));
+			}
+		}
+		// PCHIP slopes over each run of consecutive nodes with finite BEVs
+		int n_nodes = nodes.size();
+		slopes.assign(n_nodes, 0.0);
+		for (int first = 0, last; first < n_nodes; first = last + 1) {
+			last = first;
+			if (!std::isfinite(node_y[first]))
+				continue;
+			while (last + 1 < n_nodes && std::isfinite(node_y[last + 1]))
+				last++;
+			if (last > first)
+				bev_utils::PchipSlopes(&node_x[first], &node_y[first], last - first + 1, &slopes[first]);
+		}
+
+		splits.clear();
+		for (int i = 0; i + 1 < n_nodes; i++) {
+			int a = nodes[i], b = nodes[i + 1];
+			if (b - a < 2)
+				continue;
+			// the second interpolant is the polynomial through the (up to four) nearest nodes with finite BEVs
+			int lo = i, hi = i + 1;
+			bool finite = std::isfinite(node_y[i]) && std::isfinite(node_y[i + 1]);
+			if (finite && i > 0 && std::isfinite(node_y[i - 1]))
+				lo--;
+			if (finite && i + 2 < n_nodes && std::isfinite(node_y[i + 2]))
+				hi++;
+			// the error of the interpolation at the node whose solve made this interval, a check on the difference of the
+			// interpolants (which can both miss what lies between coarse nodes)
+			double observed = added[a] == added[b] ? infinity : split_error[added[a] > added[b] ? a : b];
+			double estimate = 0;
+			for (int k = a + 1; k < b; k++) {
+				if (!finite || hi - lo < 2) {
+					skew.BEVs(k) = finite ? bev_utils::HermiteInterpolate(node_x[i], node_x[i + 1], node_y[i], node_y[i + 1], slopes[i], slopes[i + 1], x[k])
+										  : std::numeric_limits<double>::quiet_NaN();
+					skew.error_estimates(k) = infinity;
+				} else {
+					skew.BEVs(k) = bev_utils::HermiteInterpolate(node_x[i], node_x[i + 1], node_y[i], node_y[i + 1], slopes[i], slopes[i + 1], x[k]);
+					skew.error_estimates(k) = std::max(std::abs(skew.BEVs(k) - LagrangeInterpolate(&node_x[lo], &node_y[lo], hi - lo + 1, x[k])), observed);
+				}
+				estimate = std::max(estimate, skew.error_estimates(k));
+			}
+			if (estimate > tolerance)
+				splits.push_back(std::make_pair(estimate, Closest(a + 1, b - 1, 0.5 * (x[a] + x[b]))));
+		}
+		std::sort(splits.begin(), splits.end(), [] (const std::pair<double, int>& p, const std::pair<double, int>& q) { return p.first > q.first; });
+		int n_splits = max_nodes > 0 ? std::min((int) splits.size(), std::max(max_nodes - n_nodes, 0)) : (int) splits.size();
+		new_nodes.clear();
+		for (int k = 0; k < n_splits; k++) {
+			new_nodes.push_back(splits[k].second);
+			is_node[splits[k].second] = true;
+		}
+	}
+	skew.strikes = std::move(strikes);
+	skew.nodes = nodes;
+	skew.max_error_estimate = skew.error_estimates.maxCoeff();
+	return skew;
+}
+
 /*
 This function performs the same procedure as above, except for a specific strike, maturity combination, and returns
 an array of break-even volatilities for each subpath. This corresponds to the case above when average_pnls==false, prior 
-to averaging the subpaths' BEV estimates for the final result (for that specific strike, maturity combination).*/
+to averaging the subpaths' BEV estimates for the final result (for that specific strike, maturity combination).
+When a thread pool is set, the subpaths are solved in parallel. */
 Eigen::ArrayXXd BEV::SolveForBEV(double strike, double maturity) {
 	// Check there'e enough data for this maturity
-	assert(path_.size() >= maturity*21 && "Insufficient data size for maturity selected.");
+	assert(path_size_ >= maturity*21 && "Insufficient data size for maturity selected.");
+
+	MaturityCache& cache = CachedMaturity(maturity);
+	PnLContext context = cache.context.WithStrike(strike);
+	StrikeCache& results = cache.strikes[strike];
+	// looked up in the result cache (see SetResultCache) unless all solved already, and stored once solved unless
+	// solved from warm starts
+	data_utils::Hasher key;
+	bool store = false;
+	if ((int) results.sub_path_BEVs.size() != context.NumPaths()) {
+		bool seeded = warm_start_ || results.seeded_sub_paths;
+		results.seeded_sub_paths = seeded;
+		if (result_cache_ && !warm_start_) {
+			key = ResultKey();
+			store = !LoadResults(key, (int) maturity, strike, false, context.NumPaths(), results) && !seeded;
+		}
+	}
+	bev_utils::Workspace& workspace = Scratch();
+	bev_utils::Workspace::Lease scratch = workspace.Acquire();
+	int n_solved = results.sub_path_BEVs.size();
+	int n_paths = context.NumPaths() - n_solved;
+	WarmStart* starts = nullptr;
+	if (warm_start_) {
+		starts = scratch->Allocate<WarmStart>(n_paths);
+		for (int n = 0; n < n_paths; n++)
+			starts[n] = FindWarmStart(maturity, cache, strike, n_solved + n);
+	}
+	if (batched_solve_) {
+		// lockstep over the subpaths not yet solved, split into one block of lanes per thread when a thread pool is set
+		results.sub_path_BEVs.resize(context.NumPaths(), std::numeric_limits<double>::quiet_NaN()); // NaN until solved
+		double* lane_strikes = scratch->Allocate(n_paths, strike);
+		double* lane_x0s = scratch->Allocate(n_paths, std::numeric_limits<double>::quiet_NaN());
+		int* lane_paths = scratch->Allocate<int>(n_paths);
+		for (int n = 0; n < n_paths; n++) {
+			lane_paths[n] = n_solved + n;
+			if (warm_start_)
+				lane_x0s[n] = starts[n].x0;
+		}
+		int n_blocks = thread_pool_ ? std::min(n_paths, thread_pool_->Size()) : std::min(n_paths, 1);
+		auto SolveBlock = [&] (int block) {
+			int begin = n_paths * block / n_blocks;
+			int end = n_paths * (block + 1) / n_blocks;
+			bev_utils::Workspace::Lease block_scratch = workspace.Acquire();
+			SolveLanesLockstep(context, *block_scratch, end - begin, lane_strikes + begin, lane_paths + begin, results.sub_path_BEVs.data() + n_solved + begin, lane_x0s + begin);
+		};
+		if (thread_pool_)
+			thread_pool_->ParallelFor(n_blocks, SolveBlock);
+		else if (n_blocks > 0)
+			SolveBlock(0);
+	} else {
+		UpdateSubPathBEVs(context, results, true, starts, *scratch);
+	}
+	if (store)
+		StoreResults(key, (int) maturity, strike, false, results);
+	return Eigen::Map<const Eigen::ArrayXd>(results.sub_path_BEVs.data(), results.sub_path_BEVs.size());
+}
 
-	Eigen::ArrayXXd paths = GetSubPaths(maturity);
-	int days_to_maturity = maturity*days_per_month_;
+/*
+Builds the cached PnL terms for a maturity. The subpaths, overlapping or not, are windows into the path (see 
+GetSubPathView), rebased on the fly by the kernels, and the terms of the path itself are shared with the maturities 
+already cached. */
+PnLContext BEV::MaturityContext(int term_in_months) {
+	int days_to_maturity = term_in_months*days_per_month_;
+	int stride = sub_path_stride_ == 0 ? days_to_maturity : sub_path_stride_;
 	Eigen::Array<double, 1, Eigen::Dynamic> times_to_maturity = Eigen::ArrayXd::LinSpaced(days_to_maturity, (double) days_to_maturity-1, 0.0) * dt_;
+	if (!maturity_cache_.empty())
+		return maturity_cache_.begin()->second.context.WithWindows(stride, times_to_maturity);
+	PnLContext context = chunk_prices_ > 0 ? PnLContext::FromHistoryChunked(path_data_, path_size_, stride, times_to_maturity, interest_rate_, dt_, chunk_prices_)
+										   : PnLContext::FromHistory(path_data_, path_size_, stride, times_to_maturity, interest_rate_, dt_);
+	context.SetEngine(pnl_engine_);
+	context.SetPrecision(precision_);
+	context.SetFastGamma(fast_gamma_);
+	return context;
+}
+
+BEV::MaturityCache& BEV::CachedMaturity(int term_in_months) {
+	auto it = maturity_cache_.find(term_in_months);
+	if (it == maturity_cache_.end())
+		it = maturity_cache_.emplace(term_in_months, MaturityCache{MaturityContext(term_in_months), {}}).first;
+	return it->second;
+}
 
-	Eigen::Array<double, Eigen::Dynamic, 1> path_BEVs(paths.rows(), 1);
-	int n = 0;
-	for (auto path : paths.rowwise()) {
-		auto PnLToZero = [&path, &strike, &times_to_maturity, this] (double sigma) -> double {
-			return this->ContinuousDHPnL(sigma, path, strike, times_to_maturity);
+namespace {
+	// Tolerance of the root searches in double, on the sigma step and on |PnL| (see bev_utils::RootBySecantMethod)
+	const double kTol = 1e-12;
+	// The root search over float terms stops once sigma is resolved about as well as the float PnL allows
+	const double kFloatXTol = 1e-6;
+	// Largest Newton step accepted as the double polish of a float root, larger steps fall back to a double search
+	const double kMaxPolishStep = 1e-4;
+
+	// Distance from a bound taken from the neighbouring roots at which a root is taken to have been held back by it
+	const double kBoundTol = 1e-6;
+	// Factor by which the bounds taken from the neighbouring roots are widened below the smallest and above the largest
+	const double kBoundWidening = 2.0;
+	// Version of the solvers in the keys of the result cache, to be bumped by any change that moves their roots other
+	// than through the settings and constants hashed by BEV::ResultKey (e.g. the starting points or iteration limits).
+	// 2: only roots solved from the default starting points are stored, see SetResultCache
+	const uint32_t kResultVersion = 2;
+
+	// Newton step of the polish, none where the PnL already meets the double search's tolerance (as for flat PnLs)
+	double PolishStep(double pnl, double dpnl) {
+		return std::abs(pnl) <= kTol ? 0.0 : pnl / dpnl;
+	}
+
+	/*
+	Root of pnl(context, sigma) (or, for Newton-Brent, of pnl_and_derivative(context, sigma)) from x0 in the precision
+	of the context: in double, in float to kFloatXTol, or, for Mixed, in float and then polished by a single Newton step
+	in double (one evaluation with the analytic derivative, for either root finder), which takes a root within 
+	kFloatXTol to double accuracy. If the float search failed or the step is too large (e.g. where the PnL is flat), the
+	root is searched for in double instead, from the float root if there is one. The counts of all steps are added together. */
+	template <typename F, typename FDF>
+	bev_utils::RootResult FindRoot(const PnLContext& context, RootFinder root_finder, F pnl, FDF pnl_and_derivative, double x0, double lower, double upper) {
+		auto Search = [&] (const PnLContext& search_context, double x0, double xtol, double step) {
+			if (root_finder == RootFinder::NewtonBrent)
+				return bev_utils::RootByNewtonBrent([&] (double sigma) { return pnl_and_derivative(search_context, sigma); }, x0, lower, upper, xtol);
+			bev_utils::RootResult root;
+			bev_utils::RootBySecantMethod([&] (double sigma) { return pnl(search_context, sigma); }, x0, step, xtol, kTol, &root);
+			return root;
 		};
-		path_BEVs(n, 0) = bev_utils::RootBySecantMethod(PnLToZero, 0.99);
-		n++;
+		Precision precision = context.EvaluationPrecision();
+		if (precision == Precision::Double)
+			return Search(context, x0, kTol, 0.01);
+		bev_utils::RootResult root = Search(context, x0, kFloatXTol, 0.01);
+		if (precision == Precision::Float)
+			return root;
+		PnLContext exact = context;
+		exact.SetPrecision(Precision::Double);
+		bool found = std::isfinite(root.root);
+		if (found) {
+			std::pair<double, double> fdf = pnl_and_derivative(exact, root.root);
+			double step = PolishStep(fdf.first, fdf.second);
+			root.iterations++;
+			root.evaluations++;
+			if (std::abs(step) <= kMaxPolishStep) { // also false for a NaN step
+				root.root -= step;
+				return root;
+			}
+		}
+		bev_utils::RootResult polished = Search(exact, found ? root.root : x0, kTol, 0.01);
+		polished.iterations += root.iterations;
+		polished.evaluations += root.evaluations;
+		return polished;
+	}
+}
+
+/*
+The path is hashed by value, so cells are found whether the prices come from a CSV, a price cache or a caller's buffer. */
+data_utils::Hasher BEV::ResultKey() const {
+	data_utils::Hasher key;
+	key.Add(kResultVersion).Add(path_size_).Add(path_data_, path_size_ * sizeof(double));
+	key.Add(interest_rate_).Add(dt_).Add(days_per_month_);
+	key.Add(root_finder_).Add(pnl_engine_).Add(precision_).Add(fast_gamma_).Add(min_sigma_).Add(max_sigma_);
+	key.Add(sub_path_stride_).Add(chunk_prices_);
+	key.Add(kTol).Add(kFloatXTol).Add(kMaxPolishStep);
+	return key;
+}
+
+namespace {
+	// Digest of the results of a cell, the root of the average PnL or the roots of the subpaths, see BEV::ResultKey
+	data_utils::Digest CellDigest(data_utils::Hasher key, int term_in_months, double strike, bool average_pnls) {
+		return key.Add(term_in_months).Add(strike).Add(average_pnls).Finish();
+	}
+}
+
+bool BEV::LoadResults(const data_utils::Hasher& key, int term_in_months, double strike, bool average_pnls, int n_paths, StrikeCache& results) {
+	data_utils::Digest digest = CellDigest(key, term_in_months, strike, average_pnls);
+	if (average_pnls) {
+		double root;
+		if (!result_cache_->Load(digest, &root, 1))
+			return false;
+		results.average_BEV = root;
+		results.average_paths = n_paths;
+		return true;
+	}
+	std::vector<double> roots;
+	if (!result_cache_->Load(digest, roots) || (int) roots.size() != n_paths)
+		return false;
+	results.sub_path_BEVs = std::move(roots);
+	results.seeded_sub_paths = false;
+	return true;
+}
+
+void BEV::StoreResults(const data_utils::Hasher& key, int term_in_months, double strike, bool average_pnls, const StrikeCache& results) {
+	data_utils::Digest digest = CellDigest(key, term_in_months, strike, average_pnls);
+	if (average_pnls)
+		result_cache_->Store(digest, &results.average_BEV, 1);
+	else
+		result_cache_->Store(digest, results.sub_path_BEVs.data(), results.sub_path_BEVs.size());
+}
+
+/*
+Solves for the break-even volatility which zeroes the average PnL of the subpaths in context (path = -1), or the PnL of
+a single subpath, using the selected root finder. Without a starting point, the secant method starts from 0.99 and
+the Newton-Brent method from the realised volatility. */
+double BEV::SolveBEV(const PnLContext& context, int path, const WarmStart& start, bev_utils::RootResult* result) {
+	auto PnLToZero = [path] (const PnLContext& c, double sigma) -> double {
+		return path < 0 ? c.PnL(sigma) : c.PnL(sigma, path);
+	};
+	auto PnLAndDerivative = [path] (const PnLContext& c, double sigma) -> std::pair<double, double> {
+		return path < 0 ? c.PnLAndDerivative(sigma) : c.PnLAndDerivative(sigma, path);
+	};
+	double x0 = start.x0;
+	if (std::isnan(x0)) {
+		if (root_finder_ == RootFinder::NewtonBrent)
+			x0 = path < 0 ? context.RealisedVolatility() : context.RealisedVolatility(path);
+		else
+			x0 = 0.99;
+	}
+	bool bounded = !std::isnan(start.lower);
+	double lower = bounded ? start.lower : min_sigma_, upper = bounded ? start.upper : max_sigma_;
+	bev_utils::RootResult root = FindRoot(context, root_finder_, PnLToZero, PnLAndDerivative, x0, lower, upper);
+	// Newton-Brent never leaves its bounds, so when bounds taken from the neighbouring roots held it back (it failed, or
+	// ended at a bound) the root is searched for again within the full bounds
+	if (bounded && root_finder_ == RootFinder::NewtonBrent && !(root.converged && root.root - lower > kBoundTol && upper - root.root > kBoundTol)) {
+		bev_utils::RootResult widened = FindRoot(context, root_finder_, PnLToZero, PnLAndDerivative, std::isfinite(root.root) ? root.root : x0, min_sigma_, max_sigma_);
+		widened.iterations += root.iterations;
+		widened.evaluations += root.evaluations;
+		root = widened;
+	}
+	if (result)
+		*result = root;
+	return root.root;
+}
+
+double BEV::SolveBEV(const PnLContext& context, const Resample& resample, double x0) {
+	int n_paths = resample.n_paths;
+	const int* paths = resample.paths;
+	const double* weights = resample.weights;
+	auto PnLToZero = [&] (const PnLContext& c, double sigma) -> double {
+		return c.PnL(sigma, n_paths, paths, weights);
+	};
+	auto PnLAndDerivative = [&] (const PnLContext& c, double sigma) -> std::pair<double, double> {
+		return c.PnLAndDerivative(sigma, n_paths, paths, weights);
+	};
+	if (std::isnan(x0))
+		x0 = root_finder_ == RootFinder::NewtonBrent ? context.RealisedVolatility() : 0.99;
+	return FindRoot(context, root_finder_, PnLToZero, PnLAndDerivative, x0, min_sigma_, max_sigma_).root;
+}
+
+/*
+The neighbouring results are the roots of the nearest strikes of the maturity solved on either side of strike. Between
+two of them the root is interpolated linearly in strike, and beyond them it is extrapolated from the nearest two on one
+side (keeping the nearest root when the extrapolation would move it by more than a factor of kBoundWidening). The 
+bounds span the neighbouring roots and the start, widened by kBoundWidening. */
+BEV::WarmStart BEV::FindWarmStart(int term_in_months, const MaturityCache& cache, double strike, int path) const {
+	// root held by results (for the path), if solved
+	auto Solved = [path] (const StrikeCache& results, double& BEV) {
+		if (path < 0)
+			BEV = results.average_paths > 0 ? results.average_BEV : std::numeric_limits<double>::quiet_NaN();
+		else
+			BEV = path < (int) results.sub_path_BEVs.size() ? results.sub_path_BEVs[path] : std::numeric_limits<double>::quiet_NaN();
+		return std::isfinite(BEV);
+	};
+	WarmStart start;
+	double BEV;
+
+	// the cell's own root (e.g. before AppendPrices), else its root before the last ClearResults
+	auto own = cache.strikes.find(strike);
+	if (own != cache.strikes.end() && Solved(own->second, BEV)) {
+		start.x0 = BEV;
+		return start;
+	}
+	auto previous_maturity = previous_results_.find(term_in_months);
+	if (previous_maturity != previous_results_.end()) {
+		auto previous = previous_maturity->second.find(strike);
+		if (previous != previous_maturity->second.end() && Solved(previous->second, BEV)) {
+			start.x0 = BEV;
+			return start;
+		}
+	}
+
+	// the nearest solved (strike, root) pairs on each side, nearest first
+	std::pair<double, double> below[2], above[2];
+	int n_below = 0, n_above = 0;
+	for (auto it = cache.strikes.lower_bound(strike); it != cache.strikes.begin() && n_below < 2; ) {
+		--it;
+		if (Solved(it->second, BEV))
+			below[n_below++] = std::make_pair(it->first, BEV);
+	}
+	for (auto it = cache.strikes.upper_bound(strike); it != cache.strikes.end() && n_above < 2; ++it) {
+		if (Solved(it->second, BEV))
+			above[n_above++] = std::make_pair(it->first, BEV);
+	}
+	double lowest, highest;
+	if (n_below > 0 && n_above > 0) {
+		double weight = (strike - below[0].first) / (above[0].first - below[0].first);
+		start.x0 = (1 - weight) * below[0].second + weight * above[0].second;
+		lowest = std::min(below[0].second, above[0].second);
+		highest = std::max(below[0].second, above[0].second);
+	} else if (n_below > 0 || n_above > 0) {
+		const std::pair<double, double>* side = n_below == 0 ? above : below;
+		double nearest = side[0].second;
+		start.x0 = nearest;
+		if (std::max(n_below, n_above) > 1) {
+			double extrapolated = nearest + (nearest - side[1].second) * (strike - side[0].first) / (side[0].first - side[1].first);
+			if (extrapolated >= nearest / kBoundWidening && extrapolated <= nearest * kBoundWidening)
+				start.x0 = extrapolated;
+		}
+		lowest = std::min(nearest, start.x0);
+		highest = std::max(nearest, start.x0);
+	}
+	if (!std::isnan(start.x0)) {
+		start.lower = std::max(min_sigma_, lowest / kBoundWidening);
+		start.upper = std::min(max_sigma_, highest * kBoundWidening);
+		return start;
 	}
-	return path_BEVs;
+
+	// nothing solved nearby, e.g. the first strike of a maturity
+	double volatility = path < 0 ? cache.context.RealisedVolatility() : cache.context.RealisedVolatility(path);
+	if (volatility > min_sigma_ && volatility < max_sigma_)
+		start.x0 = volatility;
+	return start;
+}
+
+/*
+The root of the average PnL only moves slightly when a few subpaths are added, so callers start from the previous root
+when there is one. */
+void BEV::UpdateAverageBEV(const PnLContext& context, StrikeCache& results, const WarmStart& start) {
+	if (results.average_paths == context.NumPaths())
+		return;
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	auto time = std::chrono::steady_clock::now();
+	bev_utils::RootResult root;
+	results.average_BEV = SolveBEV(context, -1, start, &root);
+	RecordSolve(results.diagnostics, root, context.PnL(root.root), SecondsSince(time));
+#else
+	results.average_BEV = SolveBEV(context, -1, start);
+#endif
+	results.average_paths = context.NumPaths();
+}
+
+/*
+Each subpath's solve is independent of the others, so only the subpaths added since the last solve are solved, and with
+parallel set and a thread pool available they are spread over the pool. */
+void BEV::UpdateSubPathBEVs(const PnLContext& context, StrikeCache& results, bool parallel, const WarmStart* starts, bev_utils::ScratchArena& scratch) {
+	int n_solved = results.sub_path_BEVs.size();
+	results.sub_path_BEVs.resize(context.NumPaths(), std::numeric_limits<double>::quiet_NaN()); // NaN until solved
+
+	int n_paths = context.NumPaths() - n_solved;
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	// kept per subpath and added to the cell's diagnostics afterwards, as the subpaths may be solved concurrently
+	bev_utils::ScratchArena::Frame frame(scratch);
+	bev_utils::RootResult* roots = scratch.Allocate(n_paths, bev_utils::RootResult());
+	double* pnls = scratch.Allocate<double>(n_paths);
+	double* seconds = scratch.Allocate<double>(n_paths);
+	auto SolvePath = [&] (int k) {
+		auto start = std::chrono::steady_clock::now();
+		results.sub_path_BEVs[n_solved + k] = SolveBEV(context, n_solved + k, starts ? starts[k] : WarmStart(), &roots[k]);
+		pnls[k] = context.PnL(roots[k].root, n_solved + k);
+		seconds[k] = SecondsSince(start);
+	};
+#else
+	(void) scratch; // only the diagnostics take scratch memory here
+	auto SolvePath = [&] (int k) {
+		results.sub_path_BEVs[n_solved + k] = SolveBEV(context, n_solved + k, starts ? starts[k] : WarmStart());
+	};
+#endif
+
+	if (parallel && thread_pool_)
+		thread_pool_->ParallelFor(n_paths, SolvePath);
+	else {
+		for (int k = 0; k < n_paths; k++)
+			SolvePath(k);
+	}
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	for (int k = 0; k < n_paths; k++)
+		RecordSolve(results.diagnostics, roots[k], pnls[k], seconds[k]);
+#endif
+}
+
+namespace {
+	// Feeds the PnL (and derivative) at the stepper's current point to the stepper, see bev_utils::SecantStepper
+	bool Feed(bev_utils::SecantStepper& stepper, double pnl, double) { return stepper.Update(pnl); }
+	bool Feed(bev_utils::NewtonBrentStepper& stepper, double pnl, double dpnl) { return stepper.Update(pnl, dpnl); }
+
+	/*
+	Advances every stepper (one per lane) until all have finished. Each round evaluates the lanes still active together
+	with PnLContext::PnLLanes, so the path data is streamed once per round for all of them. Lanes drop out of the active
+	set (the convergence mask) as soon as their stepper has finished. */
+	template <typename Stepper>
+	void RunLockstep(const PnLContext& context, bev_utils::ScratchArena& scratch, Stepper* steppers, int n_lanes, const double* strikes, const int* paths, bool with_derivative) {
+		bev_utils::ScratchArena::Frame frame(scratch);
+		int* active = scratch.Allocate<int>(n_lanes);
+		for (int l = 0; l < n_lanes; l++)
+			active[l] = l;
+		double* sigmas = scratch.Allocate<double>(n_lanes);
+		double* lane_strikes = scratch.Allocate<double>(n_lanes);
+		double* pnls = scratch.Allocate<double>(n_lanes);
+		double* dpnls = scratch.Allocate<double>(n_lanes, 0.0);
+		int* lane_paths = scratch.Allocate<int>(n_lanes);
+
+		int n_active = n_lanes;
+		while (n_active > 0) {
+			for (int k = 0; k < n_active; k++) {
+				sigmas[k] = steppers[active[k]].x;
+				lane_strikes[k] = strikes[active[k]];
+				lane_paths[k] = paths[active[k]];
+			}
+			context.PnLLanes(n_active, sigmas, lane_strikes, lane_paths, pnls, with_derivative ? dpnls : nullptr, scratch);
+			int still_active = 0;
+			for (int k = 0; k < n_active; k++) {
+				if (Feed(steppers[active[k]], pnls[k], dpnls[k]))
+					active[still_active++] = active[k];
+			}
+			n_active = still_active;
+		}
+	}
+
+	// Lockstep solves of n_lanes lanes (see BEV::SolveLanesLockstep) from x0s, with initial secant steps steps and tolerance xtol
+	void SolveLanes(const PnLContext& context, bev_utils::ScratchArena& scratch, RootFinder root_finder, int n_lanes, const double* strikes, const int* paths, const double* x0s, const double* steps,
+		double xtol, double lower, double upper, bev_utils::RootResult* results) {
+		bev_utils::ScratchArena::Frame frame(scratch);
+		if (root_finder == RootFinder::NewtonBrent) {
+			bev_utils::NewtonBrentStepper* steppers = scratch.Allocate<bev_utils::NewtonBrentStepper>(n_lanes);
+			for (int l = 0; l < n_lanes; l++)
+				new (steppers + l) bev_utils::NewtonBrentStepper(x0s[l], lower, upper, xtol);
+			RunLockstep(context, scratch, steppers, n_lanes, strikes, paths, true);
+			for (int l = 0; l < n_lanes; l++)
+				results[l] = steppers[l].result;
+		} else {
+			bev_utils::SecantStepper* steppers = scratch.Allocate<bev_utils::SecantStepper>(n_lanes);
+			for (int l = 0; l < n_lanes; l++)
+				new (steppers + l) bev_utils::SecantStepper(x0s[l], steps[l], xtol);
+			RunLockstep(context, scratch, steppers, n_lanes, strikes, paths, false);
+			for (int l = 0; l < n_lanes; l++)
+				results[l] = steppers[l].result;
+		}
+	}
+}
+
+/*
+Solves n_lanes root problems in lockstep with the selected root finder: lane l zeroes the PnL at strikes[l], averaged 
+over all subpaths when paths[l] is -1 or of the single subpath paths[l]. The lanes follow exactly the iterates of their 
+separate solves (see SolveBEV), so the roots written to BEVs are identical. */
+void BEV::SolveLanesLockstep(const PnLContext& context, bev_utils::ScratchArena& scratch, int n_lanes, const double* strikes, const int* paths, double* BEVs, const double* x0s, bev_utils::RootResult* results) {
+	bev_utils::ScratchArena::Frame frame(scratch);
+	double* starts = scratch.Allocate<double>(n_lanes);
+	double* steps = scratch.Allocate(n_lanes, 0.01);
+	for (int l = 0; l < n_lanes; l++) {
+		starts[l] = x0s ? x0s[l] : std::numeric_limits<double>::quiet_NaN();
+		if (std::isnan(starts[l])) {
+			if (root_finder_ == RootFinder::NewtonBrent)
+				starts[l] = paths[l] < 0 ? context.RealisedVolatility() : context.RealisedVolatility(paths[l]);
+			else
+				starts[l] = 0.99;
+		}
+	}
+	Precision precision = context.EvaluationPrecision();
+	bev_utils::RootResult* roots = scratch.Allocate(n_lanes, bev_utils::RootResult());
+	SolveLanes(context, scratch, root_finder_, n_lanes, strikes, paths, starts, steps, precision == Precision::Double ? kTol : kFloatXTol, min_sigma_, max_sigma_, roots);
+
+	if (precision == Precision::Mixed) {
+		// polish the float roots with one Newton step in double, all lanes in one pass, falling back as FindRoot does
+		PnLContext exact = context;
+		exact.SetPrecision(Precision::Double);
+		double* sigmas = scratch.Allocate<double>(n_lanes);
+		double* pnls = scratch.Allocate<double>(n_lanes);
+		double* dpnls = scratch.Allocate<double>(n_lanes);
+		for (int l = 0; l < n_lanes; l++)
+			sigmas[l] = std::isfinite(roots[l].root) ? roots[l].root : starts[l];
+		exact.PnLLanes(n_lanes, sigmas, strikes, paths, pnls, dpnls, scratch);
+		int* fallback = scratch.Allocate<int>(n_lanes);
+		int n_fallback = 0;
+		for (int l = 0; l < n_lanes; l++) {
+			double step = PolishStep(pnls[l], dpnls[l]);
+			if (std::isfinite(roots[l].root)) {
+				roots[l].iterations++;
+				roots[l].evaluations++;
+				if (std::abs(step) <= kMaxPolishStep) {
+					roots[l].root -= step;
+					continue;
+				}
+			}
+			fallback[n_fallback++] = l;
+		}
+		if (n_fallback > 0) {
+			double* fallback_strikes = scratch.Allocate<double>(n_fallback);
+			double* fallback_starts = scratch.Allocate<double>(n_fallback);
+			int* fallback_paths = scratch.Allocate<int>(n_fallback);
+			for (int k = 0; k < n_fallback; k++) {
+				fallback_strikes[k] = strikes[fallback[k]];
+				fallback_paths[k] = paths[fallback[k]];
+				fallback_starts[k] = sigmas[fallback[k]];
+			}
+			bev_utils::RootResult* searched = scratch.Allocate(n_fallback, bev_utils::RootResult());
+			SolveLanes(exact, scratch, root_finder_, n_fallback, fallback_strikes, fallback_paths, fallback_starts, steps, kTol, min_sigma_, max_sigma_, searched);
+			for (int k = 0; k < n_fallback; k++) {
+				searched[k].iterations += roots[fallback[k]].iterations;
+				searched[k].evaluations += roots[fallback[k]].evaluations;
+				roots[fallback[k]] = searched[k];
+			}
+		}
+	}
+	for (int l = 0; l < n_lanes; l++) {
+		BEVs[l] = roots[l].root;
+		if (results)
+			results[l] = roots[l];
+	}
+}
+
+/*
+Solves the missing results of the strikes in columns (each strike once) of the cached maturity in lockstep, as
+UpdateAverageBEV and UpdateSubPathBEVs would: one lane per strike whose average PnL root is out of date (warm started from its previous root), or one lane per
+(strike, subpath) pair not yet solved. */
+void BEV::SolveSkewLockstep(int term_in_months, MaturityCache& cache, bool average_pnls, const int* columns, int n_columns, bev_utils::ScratchArena& scratch) {
+	bev_utils::ScratchArena::Frame frame(scratch);
+	const PnLContext& context = cache.context;
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	auto start = std::chrono::steady_clock::now();
+#endif
+	int max_lanes = 0;
+	for (int k = 0; k < n_columns; k++) {
+		const StrikeCache& results = cache.strikes.at(strikes_[columns[k]]);
+		if (average_pnls)
+			max_lanes += results.average_paths != context.NumPaths();
+		else
+			max_lanes += context.NumPaths() - (int) results.sub_path_BEVs.size();
+	}
+	double* lane_strikes = scratch.Allocate<double>(max_lanes);
+	double* lane_x0s = scratch.Allocate<double>(max_lanes);
+	int* lane_paths = scratch.Allocate<int>(max_lanes);
+	double** lane_results = scratch.Allocate<double*>(max_lanes); // where each lane's root is stored
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	CellDiagnostics** lane_cells = scratch.Allocate<CellDiagnostics*>(max_lanes); // diagnostics of each lane's cell
+#endif
+	int n_lanes = 0;
+	if (average_pnls) {
+		for (int k = 0; k < n_columns; k++) {
+			double strike = strikes_[columns[k]];
+			StrikeCache& results = cache.strikes.at(strike);
+			if (results.average_paths == context.NumPaths())
+				continue;
+			lane_strikes[n_lanes] = strike;
+			lane_paths[n_lanes] = -1;
+			lane_x0s[n_lanes] = warm_start_ ? FindWarmStart(term_in_months, cache, strike, -1).x0 : results.average_BEV;
+			lane_results[n_lanes] = &results.average_BEV;
+#ifdef BEV_ENABLE_DIAGNOSTICS
+			lane_cells[n_lanes] = &results.diagnostics;
+#endif
+			n_lanes++;
+			results.average_paths = context.NumPaths();
+		}
+	} else {
+		// subpath by subpath, every strike of a subpath together, so that consecutive lanes read the same part of the path
+		StrikeCache** strike_results = scratch.Allocate<StrikeCache*>(n_columns);
+		int* n_solved = scratch.Allocate<int>(n_columns);
+		for (int k = 0; k < n_columns; k++) {
+			strike_results[k] = &cache.strikes.at(strikes_[columns[k]]);
+			n_solved[k] = strike_results[k]->sub_path_BEVs.size();
+			strike_results[k]->sub_path_BEVs.resize(context.NumPaths(), std::numeric_limits<double>::quiet_NaN()); // NaN until solved
+		}
+		for (int n = 0; n < context.NumPaths(); n++) {
+			for (int k = 0; k < n_columns; k++) {
+				if (n < n_solved[k])
+					continue;
+				StrikeCache& results = *strike_results[k];
+				lane_strikes[n_lanes] = strikes_[columns[k]];
+				lane_paths[n_lanes] = n;
+				lane_x0s[n_lanes] = warm_start_ ? FindWarmStart(term_in_months, cache, lane_strikes[n_lanes], n).x0 : std::numeric_limits<double>::quiet_NaN();
+				lane_results[n_lanes] = &results.sub_path_BEVs[n];
+#ifdef BEV_ENABLE_DIAGNOSTICS
+				lane_cells[n_lanes] = &results.diagnostics;
+#endif
+				n_lanes++;
+			}
+		}
+	}
+	double* lane_BEVs = scratch.Allocate<double>(n_lanes);
+	// with chunked evaluation, the lanes are solved in slices of at most a block's worth, so that the scratch memory of the
+	// steppers stays bounded like the terms (the lanes are independent, so the roots are the same)
+	int slice = chunk_prices_ > 0 ? chunk_prices_ : std::max(n_lanes, 1);
+#ifdef BEV_ENABLE_DIAGNOSTICS
+	bev_utils::RootResult* lane_roots = scratch.Allocate(n_lanes, bev_utils::RootResult());
+	for (int first = 0; first < n_lanes; first += slice)
+		SolveLanesLockstep(context, scratch, std::min(slice, n_lanes - first), lane_strikes + first, lane_paths + first, lane_BEVs + first, lane_x0s + first, lane_roots + first);
+	// the lanes are solved together, so each cell is given the time of the whole skew, and only once
+	double seconds = SecondsSince(start);
+	CellDiagnostics** timed = scratch.Allocate<CellDiagnostics*>(n_lanes);
+	int n_timed = 0;
+	for (int l = 0; l < n_lanes; l++) {
+		PnLContext strike_context = context.WithStrike(lane_strikes[l]);
+		double pnl = lane_paths[l] < 0 ? strike_context.PnL(lane_BEVs[l]) : strike_context.PnL(lane_BEVs[l], lane_paths[l]);
+		bool first = std::find(timed, timed + n_timed, lane_cells[l]) == timed + n_timed;
+		if (first)
+			timed[n_timed++] = lane_cells[l];
+		RecordSolve(*lane_cells[l], lane_roots[l], pnl, first ? seconds : 0.0);
+	}
+#else
+	for (int first = 0; first < n_lanes; first += slice)
+		SolveLanesLockstep(context, scratch, std::min(slice, n_lanes - first), lane_strikes + first, lane_paths + first, lane_BEVs + first, lane_x0s + first);
+#endif
+	for (int l = 0; l < n_lanes; l++)
+		*lane_results[l] = lane_BEVs[l];
 }
 
 /*
@@ -157,6 +1330,43 @@ double BEV::ContinuousDHPnL(double sigma, const Eigen::ArrayXXd& paths, double s
 			((interest_rate_ * times_to_maturity(Eigen::seq(0, T-1))).exp())).rowwise().sum().mean(); 																		// e^(r*(T-ti)) ... sum rows, average pnls from each path
 }
 
+/*
+The hedge held over day ti is N(d1_ti) shares, financed at the interest rate, and each day's gain is grown to expiry. */
+double BEV::DailyDHPnL(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity) {
+	int T = paths.cols()-1;
+	Eigen::Array<double, 1, Eigen::Dynamic> tau = times_to_maturity(Eigen::seq(0, T-1));
+	Eigen::ArrayXXd S = paths(Eigen::all, Eigen::seq(0, T-1));
+	auto NormCDF = [] (double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); };
+	Eigen::ArrayXXd d1 = ((S/strike).log().rowwise() + (interest_rate_ + 0.5*(sigma*sigma))*tau).rowwise() / (sigma*(tau.sqrt()));
+	Eigen::ArrayXXd deltas = d1.unaryExpr(NormCDF);
+	Eigen::ArrayXd hedge = ((deltas * (paths(Eigen::all, Eigen::seq(1, T)) - S*std::exp(interest_rate_*dt_))).rowwise() * 
+							(interest_rate_ * (tau - dt_)).exp()).rowwise().sum();																	// sum of N(d1_ti) * (S_ti+1 - S_ti * e^(r*dt)) * e^(r*(T-ti+1))
+	Eigen::ArrayXd d2_0 = d1.col(0) - sigma*std::sqrt(tau(0));
+	Eigen::ArrayXd premium = S.col(0) * d1.col(0).unaryExpr(NormCDF) - strike*std::exp(-interest_rate_*tau(0)) * d2_0.unaryExpr(NormCDF);	// Black Scholes call value at t0
+	Eigen::ArrayXd payoff = (paths.col(T) - strike).max(0.0);
+	return (2 * (premium*std::exp(interest_rate_*tau(0)) + hedge - payoff)).mean();
+}
+
+/*
+Analytic derivative of the PnL function above with respect to sigma. Differentiating each term of the sum gives
+	dGamma/dsigma * S^2 * (sigma^2 * dt - (dS/S)^2) + Gamma * S^2 * 2 * sigma * dt,
+with dGamma/dsigma = Gamma * (d1*d2 - 1) / sigma, where d2 = d1 - sigma * sqrt(tau). */
+double BEV::ContinuousDHPnLDerivative(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity) {
+	int T = paths.cols()-1;
+	Eigen::ArrayXXd S = paths(Eigen::all, Eigen::seq(0, T-1));
+	Eigen::Array<double, 1, Eigen::Dynamic> tau = times_to_maturity(Eigen::seq(0, T-1));
+	Eigen::ArrayXXd d1 = ((S/strike).log().rowwise() + (interest_rate_ + 0.5*(sigma*sigma))*tau).rowwise() / (sigma*(tau.sqrt()));
+	Eigen::ArrayXXd d2 = d1.rowwise() - sigma*tau.sqrt();
+	Eigen::ArrayXXd gamma = BlackScholesGamma(sigma, S, strike, tau);
+	Eigen::ArrayXXd hedging_error = sigma*sigma*dt_ - ((paths(Eigen::all, Eigen::seq(1, T)) - S) / S).pow(2);
+	return (((gamma * (d1*d2 - 1) / sigma * hedging_error + gamma * 2*sigma*dt_) * S.pow(2)).rowwise() *		// dGamma/dsigma * S^2 * (sigma^2 * dt - (dS/S)^2) + Gamma * S^2 * 2 * sigma * dt
+			((interest_rate_ * tau).exp())).rowwise().sum().mean();													// e^(r*(T-ti)) ... sum rows, average over paths
+}
+
+std::pair<double, double> BEV::ContinuousDHPnLAndDerivative(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity) {
+	return std::make_pair(ContinuousDHPnL(sigma, paths, strike, times_to_maturity), ContinuousDHPnLDerivative(sigma, paths, strike, times_to_maturity));
+}
+
 /*
 Computes the Black Scholes Gamma at each point in time along the path/row. */
 Eigen::ArrayXXd BEV::BlackScholesGamma(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity) {
@@ -168,11 +1378,27 @@ Eigen::ArrayXXd BEV::BlackScholesGamma(double sigma, const Eigen::ArrayXXd& path
 Creates an array of subpaths where each row is a sub-sample/path of length 21 (days) * term_in_months
 and the number of rows is dependent on the size of the sample data and the corresponding term 
 parameter entered. */
-Eigen::ArrayXXd BEV::GetSubPaths(int term_in_months) {
+Eigen::ArrayXXd BEV::GetSubPaths(int term_in_months) const {
 	int days_to_maturity = term_in_months*days_per_month_;
-	int n_sub_paths = path_.size() / (days_to_maturity); // integer division => removes remaining datapoints which are less than a full sub path
-	// reshape array where each row holds a subpath
-	Eigen::ArrayXXd sub_paths = path_(Eigen::seq(0, n_sub_paths*days_to_maturity - 1), Eigen::all).reshaped<Eigen::RowMajor>(n_sub_paths, days_to_maturity);
+	int n_sub_paths = path_size_ / (days_to_maturity); // integer division => removes remaining datapoints which are less than a full sub path
+	// view each subpath as a row of the path, without copying
+	SubPathView sub_paths(path_data_, n_sub_paths, days_to_maturity, Eigen::OuterStride<>(days_to_maturity));
 	// rebase subpaths by dividing each by starting value
-	return sub_paths.colwise() / sub_paths(Eigen::all, 0);
+	return sub_paths.colwise() / sub_paths.col(0);
+}
+
+SubPathView BEV::GetSubPathView(int term_in_months) const {
+	int days_to_maturity = term_in_months*days_per_month_;
+	int stride = sub_path_stride_ == 0 ? days_to_maturity : sub_path_stride_;
+	int n_sub_paths = path_size_ >= days_to_maturity ? (path_size_ - days_to_maturity) / stride + 1 : 0;
+	return SubPathView(path_data_, n_sub_paths, days_to_maturity, Eigen::OuterStride<>(stride));
+}
+
+
+/*
+Annualised realised volatility of the daily returns along the subpaths (rows). */
+double BEV::RealisedVolatility(const Eigen::ArrayXXd& paths) {
+	int T = paths.cols()-1;
+	double variance = ((paths(Eigen::all, Eigen::seq(1, T)) - paths(Eigen::all, Eigen::seq(0, T-1))) / paths(Eigen::all, Eigen::seq(0, T-1))).pow(2).mean() / dt_;
+	return std::sqrt(variance);
 }
@@ -4,22 +4,189 @@
 #include <Eigen/Dense>
 #include <vector>
 #include <string>
+#include <memory>
+#include <utility>
+#include <map>
+#include <limits>
+#include <cstdint>
+#include "pnl_context.h"
+
+namespace thread_utils {
+	class ThreadPool;
+}
+
+namespace data_utils {
+	class PriceCache;
+	class ResultCache;
+	class Hasher;
+}
+
+namespace bev_utils {
+	struct RootResult;
+	class Workspace;
+	class ScratchArena;
+}
 
 namespace bev {
+	// Root finder used by SolveForBEV to zero the PnL function
+	enum class RootFinder {
+		Secant,		// bev_utils::RootBySecantMethod from a starting point of 0.99, uses PnL values only
+		NewtonBrent	// bev_utils::RootByNewtonBrent from the realised volatility of the subpaths, uses the analytic dPnL/dsigma
+	};
+
+	// Percentile bands of a BEV surface, see BEV::Bootstrap. Surfaces are laid out as the result of SolveForBEV.
+	struct BootstrapBands {
+		std::vector<double> levels; // percentile levels of the bands, e.g. {0.05, 0.95}
+		std::vector<Eigen::ArrayXXd> bands; // bands[q] holds the levels[q] percentile of the resampled BEVs of each cell
+		Eigen::ArrayXXd estimate; // the surface of the full sample, as returned by SolveForBEV
+		Eigen::ArrayXXd standard_errors; // standard deviation of the resampled BEVs of each cell, over the resamples with a root as the bands
+	};
+
+	/*
+	Skew on a dense grid of strikes, see BEV::SolveDenseSkew: solved exactly at the nodes, and interpolated between them
+	elsewhere. */
+	struct DenseSkew {
+		std::vector<double> strikes; // the grid, in increasing order
+		Eigen::ArrayXd BEVs; // BEV at each strike of the grid
+		Eigen::ArrayXd error_estimates; // estimated interpolation error at each strike, 0 at the nodes
+		std::vector<int> nodes; // indices into strikes of the strikes solved exactly, in increasing order
+		double max_error_estimate = 0; // largest of error_estimates
+		double max_refinement_error = 0; // largest difference between the interpolated and solved BEVs at the last nodes added
+		int rounds = 0; // batches of nodes solved
+	};
+
+	// Root solves made for one cell of a surface, see BEV::SolveForBEV(bool, SolveDiagnostics*)
+	struct CellDiagnostics {
+		int solves = 0; // 1 for the root of the average PnL, else one per subpath solved (0 when the cell was already cached)
+		int iterations = 0; // summed over the solves, as are the counts below
+		int evaluations = 0; // PnL evaluations (with the derivative, for Newton-Brent)
+		double seconds = 0; // wall time of the solves, or with SetBatchedSolve of the whole skew solved with the cell
+		double max_abs_pnl = 0; // largest |PnL| at a root found, NaN if any PnL at a root is NaN
+		int xtol_stops = 0; // solves stopped by the sigma step (or bracket) tolerance
+		int ftol_stops = 0; // solves stopped by the PnL tolerance
+		int not_converged = 0; // solves stopped by the iteration limit or a non-finite PnL
+		int nan_roots = 0; // solves ending on a NaN or infinite root
+	};
+
+	/*
+	Per-cell diagnostics of a surface solve, laid out as the surface (cells in row-major order). Only recorded when the 
+	library is built with BEV_ENABLE_DIAGNOSTICS defined (the CMake option BEV_DIAGNOSTICS), and left empty with enabled 
+	false otherwise, in which case the solvers carry no instrumentation at all. */
+	struct SolveDiagnostics {
+		bool enabled = false;
+		int rows = 0, cols = 0;
+		std::vector<CellDiagnostics> cells;
+		double seconds = 0; // wall time of the whole SolveForBEV call
+		const CellDiagnostics& Cell(int row, int col) const { return cells[row * cols + col]; };
+	};
+
+	/*
+	Read-only view of the subpaths (rows) of a maturity in place on the path, see BEV::GetSubPathView. Consecutive rows 
+	start a stride apart and overlap when the stride is shorter than a subpath. The view is not rebased; rebase it lazily
+	with sub_paths.colwise() / sub_paths.col(0), which only evaluates the entries read. */
+	typedef Eigen::Map<const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>, 0, Eigen::OuterStride<>> SubPathView;
+
 	class BEV {
-		Eigen::ArrayXXd path_; // time series of daily data over which break-even volatility (henceforth BEV) computations will be performed
+		// time series of daily data over which break-even volatility (henceforth BEV) computations will be performed, see Path()
+		const double* path_data_ = nullptr;
+		int path_size_ = 0;
+		std::shared_ptr<const void> path_owner_; // keeps the memory of the path alive: an Eigen array, or a mapped PriceCache
+		std::shared_ptr<std::vector<double>> appended_path_; // the path as extended by AppendPrices, with room to grow (also held by path_owner_)
 		double interest_rate_; // constant interest rate over time period of path
 		std::vector<double> strikes_; // strike prices for which to find BEV outputs, inputted as percentage moneyness i.e. {0.95, 1.00, 1.05}
 		std::vector<int> maturities_; // vector of maturities (in months) for which to find BEV outputs, each month is assumed to hold 21 trading days
 		double dt_ = 1.0 / 252.0;
 		int days_per_month_ = 21;
+		int n_threads_ = 1; // number of threads used by SolveForBEV, 1 => serial
+		std::shared_ptr<thread_utils::ThreadPool> thread_pool_; // only created when n_threads_ > 1
+		std::shared_ptr<bev_utils::Workspace> workspace_; // scratch memory of the solves, created on first use unless set, see SetWorkspace
+		RootFinder root_finder_ = RootFinder::Secant;
+		PnLEngine pnl_engine_ = PnLEngine::Continuous;
+		Precision precision_ = Precision::Double;
+		bool fast_gamma_ = false; // evaluate the normal density of the gamma terms with a polynomial exp, see SetFastGamma
+		double min_sigma_ = 1e-4, max_sigma_ = 5.0; // bounds on the break-even volatility used by the bracketed root finder
+		bool batched_solve_ = false; // solve all strikes (and subpaths) of a maturity in lockstep
+		bool warm_start_ = false; // seed each solve from the previous surface and the solved neighbouring strikes, see SetWarmStart
+		int sub_path_stride_ = 0; // days between the starts of consecutive subpaths, 0 => non-overlapping subpaths (stride = days to maturity)
+		int chunk_prices_ = 0; // prices per block of chunked evaluation, 0 => the PnL terms of the whole path are cached, see SetChunkedEvaluation
+		std::shared_ptr<data_utils::ResultCache> result_cache_; // on-disk store of solved cells shared across runs, see SetResultCache
+
+		// Results kept between solves for one strike of a maturity, so that after AppendPrices only the new subpaths are solved
+		struct StrikeCache {
+			double average_BEV = std::numeric_limits<double>::quiet_NaN(); // root of the average PnL, warm start for the next solve
+			int average_paths = 0; // number of subpaths average_BEV was solved over
+			std::vector<double> sub_path_BEVs; // roots of the subpaths solved so far
+			bool seeded_sub_paths = false; // some of sub_path_BEVs were solved from warm starts, so aren't stored in the result cache
+#ifdef BEV_ENABLE_DIAGNOSTICS
+			CellDiagnostics diagnostics; // of the solves since the last reset by SolveForBEV(bool, SolveDiagnostics*)
+#endif
+		};
+		// PnL terms and results of one maturity, built on first use and extended by AppendPrices
+		struct MaturityCache {
+			PnLContext context;
+			std::map<double, StrikeCache> strikes;
+		};
+		std::map<int, MaturityCache> maturity_cache_; // keyed by term in months, cleared whenever the data or solve settings change
+		std::map<int, std::map<double, StrikeCache>> previous_results_; // results of the solves before the last ClearResults, by term and strike
+		// Clears the cached terms and results after a change to the data or solve settings, keeping the results as warm starts
+		void ClearResults();
+		// Same after a change to a setting the cached terms don't depend on (e.g. the root finder): the terms are kept, and the 
+		// results are marked unsolved in place, keeping their storage for the next solve
+		void ResetResults();
+		// The workspace the solves take their scratch memory from, see SetWorkspace
+		bev_utils::Workspace& Scratch();
+		// Hash of the path and of every setting the roots depend on, to which each cell adds its own key, see SetResultCache
+		data_utils::Hasher ResultKey() const;
+		// Reads the results of a cell missing from memory (the root of the average PnL, or the roots of the subpaths) from the
+		// result cache into results, returning false if the result cache has none. StoreResults stores them after a solve.
+		bool LoadResults(const data_utils::Hasher& key, int term_in_months, double strike, bool average_pnls, int n_paths, StrikeCache& results);
+		void StoreResults(const data_utils::Hasher& key, int term_in_months, double strike, bool average_pnls, const StrikeCache& results);
+		// Starting point of a root solve, with bounds on the root (min_sigma_ and max_sigma_ when NaN) taken from neighbouring results
+		struct WarmStart {
+			double x0 = std::numeric_limits<double>::quiet_NaN(); // the root finder's default starting point when NaN
+			double lower = std::numeric_limits<double>::quiet_NaN(), upper = std::numeric_limits<double>::quiet_NaN();
+		};
+		// Warm start of the root at strike over all subpaths (path = -1), or of subpath path, of the cached maturity of term months,
+		// see SetWarmStart
+		WarmStart FindWarmStart(int term_in_months, const MaturityCache& cache, double strike, int path) const;
+		// View of the path as a column vector, without copying
+		Eigen::Map<const Eigen::ArrayXXd> Path() const { return Eigen::Map<const Eigen::ArrayXXd>(path_data_, path_size_, 1); };
+		// Takes ownership of path (a column vector) as the path
+		void SetPath(Eigen::ArrayXXd path);
 		// Checks that data inputted is valid with assertions. The Eigen array must be a column vector with adequate points corresponding to the maturities entered.
 		void DataValid();
+		// Cached PnL terms of the subpaths of a maturity, taken every sub_path_stride_ days along the path (see SetSubPathStride).
+		PnLContext MaturityContext(int term_in_months);
+		// Cached terms and results of a maturity, building the context on first use.
+		MaturityCache& CachedMaturity(int term_in_months);
+		// Solves for the break-even volatilities missing from results: the root of the average PnL (from start) when subpaths 
+		// were added since it was solved, or the roots of the subpaths not yet solved (subpath n_solved + k from starts[k], 
+		// or from the default starting points when starts is null), with any scratch buffers taken from scratch.
+		void UpdateAverageBEV(const PnLContext& context, StrikeCache& results, const WarmStart& start);
+		void UpdateSubPathBEVs(const PnLContext& context, StrikeCache& results, bool parallel, const WarmStart* starts, bev_utils::ScratchArena& scratch);
+		// Solves for the break-even volatility zeroing the average PnL of all subpaths in context (path = -1), or the PnL of a single subpath, 
+		// with the selected root finder, from start. The root finder's summary is copied to result when given.
+		double SolveBEV(const PnLContext& context, int path, const WarmStart& start, bev_utils::RootResult* result = nullptr);
+		// Lockstep solves (see SetBatchedSolve): n_lanes roots at strikes[l], over all subpaths (paths[l] = -1) or subpath paths[l], 
+		// written to BEVs, optionally starting from x0s[l] (default starting point when NaN), with the summaries in results[l].
+		// The lane arrays are taken from scratch.
+		void SolveLanesLockstep(const PnLContext& context, bev_utils::ScratchArena& scratch, int n_lanes, const double* strikes, const int* paths, double* BEVs, const double* x0s = nullptr, bev_utils::RootResult* results = nullptr);
+		// Lockstep solve of the missing results (see UpdateAverageBEV and UpdateSubPathBEVs) of the strikes of the maturity of term months
+		// in the columns of strikes_ given, holding each strike once.
+		void SolveSkewLockstep(int term_in_months, MaturityCache& cache, bool average_pnls, const int* columns, int n_columns, bev_utils::ScratchArena& scratch);
+		// Subpaths drawn by a bootstrap resample and how often each was drawn, see Bootstrap
+		struct Resample {
+			int n_paths = 0; // number of distinct subpaths drawn
+			const int* paths = nullptr;
+			const double* weights = nullptr;
+		};
+		// Solves for the root of the weighted average PnL of a resample, starting from x0
+		double SolveBEV(const PnLContext& context, const Resample& resample, double x0);
 
 	public:
 		// Default constructor
 		BEV() {}; 
-		// Constructors with filepath as string that creates path_ from the CSV data or one which directly sets an eigen array (column vector) to path_.
+		// Constructors with filepath as string that creates the path from the CSV data or one which directly sets an eigen array (column vector) as the path.
 		// USAGE:	If CSV is chosen, one must either set header to true and then set the desired column name. Otherwise, leave the former two parameters as default
 		// 			and set the column number.
 		BEV(std::string csv_path, int col_no = -1, bool header = false, std::string col_name = "undefined"); 
@@ -32,19 +199,135 @@ namespace bev {
 		See USAGE above for setting parameters related to CSV data (header, col_name, col_no). */
 		BEV(std::string csv_path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities, int col_no = -1, bool header = false, std::string col_name = "undefined");
 		BEV(Eigen::ArrayXXd path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities);
+		// Same with a view of caller-owned prices as the path, see SetData(Eigen::Map<const Eigen::ArrayXd>, std::shared_ptr<const void>)
+		BEV(Eigen::Map<const Eigen::ArrayXd> path, double interest_rate, std::vector<double> strikes, std::vector<int> maturities, std::shared_ptr<const void> owner = nullptr);
 
 		// Setters, if not set with a constructor:
 		void SetData(std::string csv_path, int col_no = -1, bool header = false, std::string col_name = "undefined"); // see USAGE above for setting parameters
 		void SetData(Eigen::ArrayXXd path);
+		/*
+		Uses the column col_name of a binary price cache (see price_cache.h) as the path, without copying: the BEV object
+		reads the prices straight from the memory-mapped file, and keeps the cache open for as long as it uses it. */
+		void SetData(std::shared_ptr<const data_utils::PriceCache> cache, std::string col_name = "Close");
+		/*
+		Uses caller-owned prices (e.g. a memory-mapped file or a buffer of simulated paths shared between BEV objects) as
+		the path, without copying. The prices must stay alive and unchanged while the BEV object (or a copy of it) uses 
+		them, unless owner holds them, in which case the BEV object keeps owner alive instead. 
+		USAGE:	bev.SetData(Eigen::Map<const Eigen::ArrayXd>(prices.data(), prices.size())); */
+		void SetData(Eigen::Map<const Eigen::ArrayXd> path, std::shared_ptr<const void> owner = nullptr);
 		void SetMaturities(std::vector<int> maturities); 
-		void SetInterestRate(double interest_rate) { interest_rate_ = interest_rate; };
-		void SetStrikes(std::vector<double> strikes) { strikes_ = strikes; };
+		void SetInterestRate(double interest_rate) { interest_rate_ = interest_rate; ClearResults(); };
+		void SetStrikes(std::vector<double> strikes) { strikes_ = std::move(strikes); };
+		/*
+		Sets the number of threads used when solving. With more than one thread, SolveForBEV spreads the (maturity, strike) 
+		cells, and SolveForBEV(strike, maturity) the subpaths, over a work-stealing thread pool. Every cell is still solved 
+		by exactly the same sequence of operations, so results match the serial output bit for bit.
+		Usage: 1 (default) for serial execution, 0 to use all hardware threads. */
+		void SetThreadCount(int n_threads);
+		void SetRootFinder(RootFinder root_finder) { root_finder_ = root_finder; ResetResults(); };
+		/*
+		Sets the PnL function zeroed by SolveForBEV (and Bootstrap): the continuous-hedging approximation (the default), or
+		the discretely rebalanced daily delta-hedged PnL (see DailyDHPnL), both evaluated by fused kernels over the cached 
+		subpath terms. */
+		void SetPnLEngine(PnLEngine pnl_engine) { pnl_engine_ = pnl_engine; ClearResults(); };
+		/*
+		Sets the precision of the PnL evaluations made by SolveForBEV (and Bootstrap). With Precision::Float, the 
+		continuous engine streams float copies of the cached terms through the kernels, halving the memory traffic of
+		the memory-bound evaluations over long or overlapping histories, and each root is found to about 1e-6. 
+		Precision::Mixed searches in float and then polishes each root with a few double iterations, giving the double
+		results to within the root finder's tolerance. The daily engine is always evaluated in double. */
+		void SetPrecision(Precision precision) { precision_ = precision; ClearResults(); };
+		/*
+		Sets whether the continuous engine evaluates the normal density exp(-d1^2 / 2) of its gamma terms (the only 
+		transcendental left per point, log-moneyness and sqrt(T-ti) being cached) with a division-free polynomial exp 
+		instead of Eigen's, see kernels::GaussianExp. The density then has a relative error below kernels::kFastGammaTolerance
+		(1e-14) everywhere, so each PnL is within 1e-14 times the sum of the absolute values of its terms of the exact 
+		one. On the GOOG and sample data surfaces the roots agree with the exact ones to within 1e-10 (mostly 1e-15). Applies
+		to double precision evaluations (including the polish of Precision::Mixed); see benchmark_fast_gamma. */
+		void SetFastGamma(bool fast_gamma) { fast_gamma_ = fast_gamma; ClearResults(); };
+		/*
+		Sets whether SolveForBEV advances the root solves of all strikes of a maturity (and, when not averaging PnLs, of all
+		their subpaths) together, with a vector of sigmas. Each PnL evaluation then streams the path data once for every
+		strike instead of once per strike, and converged lanes are masked out of later evaluations. Results are identical
+		to the default cell-by-cell solve. With a thread pool, the maturities (or blocks of subpaths) are spread over the threads. */
+		void SetBatchedSolve(bool batched_solve) { batched_solve_ = batched_solve; };
+		/*
+		Sets whether root solves are seeded from nearby results instead of the root finder's default starting point (0.99 
+		for the secant method). SolveForBEV then solves each maturity's strikes from the one closest to the money outwards,
+		and starts each root from, in order of preference: the cell's result before the last change to the data or solve 
+		settings (so a repeated solve after e.g. SetInterestRate starts from the previous surface), linear interpolation or 
+		extrapolation in strike of the solved neighbouring strikes of the maturity (which also bound the Newton-Brent search, 
+		widened to the full bounds when the root lies outside), or the realised volatility of the subpaths. Subpath roots 
+		are seeded in the same way from the same subpath at the neighbouring strikes. The maturities are independent, so 
+		with a thread pool they are spread over the threads, and the results do not depend on the thread count. Roots may 
+		differ from the default solve within the root finder's tolerance. With SetBatchedSolve, the strikes of a maturity are 
+		solved together, so only results cached before the solve (and the realised volatilities) are used as seeds. */
+		void SetWarmStart(bool warm_start) { warm_start_ = warm_start; };
+		/*
+		Sets the number of days between the starts of consecutive subpaths. By default (0) the path is broken up into 
+		non-overlapping subpaths as in GetSubPaths, whereas a stride smaller than the subpath length gives overlapping 
+		(rolling-window) subpaths, e.g. 1 for a subpath starting on every day of the path. The windows are evaluated in place 
+		on the path (see PnLContext::FromHistory), so memory use does not grow as the stride shrinks, only the number of subpaths. */
+		void SetSubPathStride(int stride);
+		/*
+		Sets whether the PnL terms are evaluated in blocks of chunk_prices prices rather than cached for the whole path (0,
+		the default), for very long (e.g. simulated) histories. The path is then read in place, from memory or from a 
+		memory-mapped price cache on disk (see SetData), and each thread computes the terms of one block at a time as it
+		walks the subpaths (see PnLContext::FromHistoryChunked), so the memory held by the solves stays bounded by the
+		block size whatever the length of the path, apart from the results themselves (one root per subpath and strike
+		when averaging BEVs). Blocks of a few thousand prices (e.g. 4096) stay in cache while they are evaluated. 
+		The PnLs match the cached evaluation to within rounding. As the terms of a block (a log per price) are recomputed
+		on every pass over it, solves are slower than over cached terms, by about 1.5-2x for average-PnL roots and 1.1-1.6x
+		for subpath roots (see benchmark_chunked.cpp). */
+		void SetChunkedEvaluation(int chunk_prices);
+		/*
+		Appends new prices (e.g. the latest daily closes) to the end of the path. The PnL terms cached by previous solves are
+		extended with the subpaths completed by the new prices, rather than rebuilt, and the next SolveForBEV only solves
+		what the new subpaths affect: subpath BEVs already solved are reused and only the new subpaths are solved, while
+		the roots of the average PnL are re-solved starting from the previous surface, typically within a couple of 
+		iterations. A daily refresh then costs roughly the new data instead of the full history. The first append copies
+		the path into a buffer of the object's own that grows geometrically, and later appends extend it in place, so
+		appending k prices costs O(k) (amortised) however long the history. */
+		void AppendPrices(const Eigen::ArrayXd& prices);
+		/*
+		Sets the workspace the solves take their scratch memory from (see bev_utils::Workspace): the lane arrays of the 
+		lockstep solves, the starting points of the subpath solves, bootstrap resamples and so on. Its arenas are kept and 
+		reused from solve to solve, so once a surface has been solved, later solves of the same shape take their scratch 
+		memory without allocating, whether by the same object, its copies or other objects sharing the workspace (e.g. the
+		surfaces of other tickers). One workspace can be shared by BEV objects solving on different threads, such as the 
+		solver threads of SolveBatch. By default each object creates its own on first use, shared with its copies. */
+		void SetWorkspace(std::shared_ptr<bev_utils::Workspace> workspace) { workspace_ = std::move(workspace); };
+		/*
+		Sets an on-disk cache of solved cells (see data_utils::ResultCache), shared by every process and run using its
+		directory. SolveForBEV and SolveForBEV(strike, maturity) then look up each cell missing from the object's own
+		results before solving it, and store the cells they solve: the root of the average PnL, or the roots of the subpaths
+		(shared by SolveForBEV(false) and SolveForBEV(strike, maturity)). A cell is keyed by a hash of the path, its maturity
+		and strike, the interest rate, dt and days per month, and every setting its roots depend on (root finder, PnL engine,
+		precision, fast gamma, sigma bounds, subpath stride, chunked evaluation and the solvers' tolerances), so a surface
+		whose cells are all stored is read back without evaluating a single PnL. The batched solve and the thread count
+		leave the roots unchanged and are not part of the key. Only roots solved from the root finder's default starting
+		points are stored, so every result under a key is the one a new object would solve: roots solved from warm starts
+		depend on the object's earlier solves (and may settle on another root where the PnL is flat), so with SetWarmStart
+		the cache is not used, and the average PnL roots re-solved from the previous ones after AppendPrices are looked
+		up but not stored. nullptr (the default) turns the cache off. */
+		void SetResultCache(std::shared_ptr<data_utils::ResultCache> result_cache) { result_cache_ = std::move(result_cache); };
 
-		// Getters:
-		Eigen::ArrayXXd GetPath() { return path_; };
+		// Getters (the path, strikes and maturities are returned as views of the object's own data, not copies):
+		Eigen::Map<const Eigen::ArrayXXd> GetPath() const { return Path(); };
 		double GetInterestRate() { return interest_rate_; };
-		std::vector<double> GetStrikes() { return strikes_; };
-		std::vector<int> GetMaturities() { return maturities_; };
+		const std::vector<double>& GetStrikes() const { return strikes_; };
+		const std::vector<int>& GetMaturities() const { return maturities_; };
+		int GetThreadCount() { return n_threads_; };
+		RootFinder GetRootFinder() { return root_finder_; };
+		PnLEngine GetPnLEngine() { return pnl_engine_; };
+		Precision GetPrecision() { return precision_; };
+		bool GetFastGamma() { return fast_gamma_; };
+		bool GetBatchedSolve() { return batched_solve_; };
+		bool GetWarmStart() { return warm_start_; };
+		int GetSubPathStride() { return sub_path_stride_; };
+		int GetChunkedEvaluation() { return chunk_prices_; };
+		std::shared_ptr<bev_utils::Workspace> GetWorkspace() { return workspace_; };
+		std::shared_ptr<data_utils::ResultCache> GetResultCache() { return result_cache_; };
 
 		// Solving for BEV:
 		/*
@@ -55,22 +338,73 @@ namespace bev {
 		the average of the subpath PnLs (when true), or rather (when false) averaging the break-even volatilities 
 		of each subpath for a specific maturity, strike combination. 
 		Returns an Eigen array where the rows correspond to the maturities and columns to the strikes used, i.e.
-		each row represents and volatility skew. */
+		each row represents and volatility skew. 
+		Results are kept between calls, so calling again (e.g. after AppendPrices or with more strikes) only solves what is new. */
 		Eigen::ArrayXXd SolveForBEV(bool average_pnls = true); 
 		/*
+		Same, writing the surface to surface, which is only resized when its shape differs. Re-solving a grid whose terms and
+		results are cached by an earlier solve (e.g. after SetRootFinder, which keeps the terms) then makes no heap 
+		allocations at all in serial, the scratch memory coming from the workspace (see SetWorkspace). With a thread pool, 
+		only the pool's dispatch of the tasks allocates. */
+		void SolveForBEV(bool average_pnls, Eigen::ArrayXXd& surface);
+		/*
+		Same, also filling diagnostics with each cell's iteration and PnL evaluation counts, wall time, |PnL| at the root,
+		the stopping criteria that fired and any non-convergence. Cells already cached by an earlier solve report no solves.
+		Needs a build with BEV_ENABLE_DIAGNOSTICS, see SolveDiagnostics; otherwise this is SolveForBEV(average_pnls). */
+		Eigen::ArrayXXd SolveForBEV(bool average_pnls, SolveDiagnostics* diagnostics);
+		/*
 		This function performs the same procedure as above, except for a specific strike, maturity combination, and returns
 		an array of break-even volatilities for each subpath. This corresponds to the case above when average_pnls==false, prior 
 		to averaging the subpaths' BEV estimates for the final result (for that specific strike, maturity combination).*/
 		Eigen::ArrayXXd SolveForBEV(double strike, double maturity);
-		/* To add in future:
-		Daily delta-hedged profit and loss (PnL) function. Less stable/robust than formula derived from continuous delta-hedging. */
-		// double DailyDHPnL(double sigma, !!! other params); 
+		/*
+		Bootstrap percentile bands of the surface from SolveForBEV(average_pnls). Each of the n_resamples resamples of a 
+		maturity draws as many subpaths as it has, with replacement, and every cell is re-solved on the resample: the root 
+		of the resample's average PnL (warm started from the full-sample BEV), or the mean of the resampled subpath BEVs 
+		when average_pnls is false. With block_length > 1, runs of block_length consecutive subpaths are drawn instead of 
+		single subpaths (a moving block bootstrap), keeping the dependence between neighbouring (e.g. overlapping, see 
+		SetSubPathStride) subpaths. Resamples refer to the cached subpath terms by index and are never materialised.
+		The draws come from a counter-based generator keyed on seed, so the bands are the same for any thread count; the 
+		resamples are spread over the thread pool (see SetThreadCount).
+		USAGE:	BootstrapBands bands = bev.Bootstrap(10000, {0.05, 0.5, 0.95}); */
+		BootstrapBands Bootstrap(int n_resamples, std::vector<double> levels = {0.05, 0.95}, bool average_pnls = true, int block_length = 1, uint64_t seed = 0);
+		/*
+		Skew of the maturity of term_in_months months over a dense grid of strikes (e.g. hundreds, increasing), solving
+		only at a set of nodes chosen adaptively among them. Starts from nodes evenly spread in log strike (the ends
+		included), then in rounds: interpolates the BEVs between the nodes by monotone cubic Hermite interpolation (PCHIP)
+		in log strike, estimates the error of every strike in between, and adds the strike nearest the middle of every
+		interval whose estimate exceeds tolerance as a node. The estimate of a strike is the larger of its difference from
+		the cubic through the four nearest nodes (large where the skew curves faster than the nodes resolve) and the error
+		observed when the newer node of its interval was solved, against the interpolation before it was added (so
+		intervals whose nodes were solved in the same round are always split). Intervals next to a node without a root
+		(NaN) are always split, down to the edge of the NaN region. The nodes of a round are solved together, by
+		SolveForBEV(average_pnls) on those strikes, and kept with the object's results. Stops when no estimate exceeds
+		tolerance, or once max_nodes nodes have been solved (0 for no limit), splitting the intervals with the largest
+		estimates first. On GOOG.csv the average-PnL skews come within about tolerance of the full solve with 5-40% of
+		500 strikes as nodes (tolerances 1e-3 to 1e-5); average-BEV skews jump where subpath roots change branch, and a jump between two nodes
+		that agree with each other goes unseen, so their error can exceed tolerance. Takes the strikes in relative
+		terms, as SetStrikes.
+		USAGE:	DenseSkew skew = bev.SolveDenseSkew(3, strikes, true, 1e-4); // e.g. 500 strikes from 0.7 to 1.3 */
+		DenseSkew SolveDenseSkew(int term_in_months, std::vector<double> strikes, bool average_pnls = true, double tolerance = 1e-4, int max_nodes = 0);
+		/*
+		Daily delta-hedged profit and loss (PnL) function: a call sold at its Black Scholes value at sigma, delta hedged once per 
+		day with the hedge financed at the interest rate, and settled against its payoff at expiry (see kernels::DailyDHPnL,
+		whose scale, twice the hedged PnL, matches ContinuousDHPnL). Less smooth in sigma than the continuous formula, as 
+		the hedging error of each day is kept in full. Same usage as ContinuousDHPnL, the reference implementation of the 
+		daily PnL engine (see SetPnLEngine). */
+		double DailyDHPnL(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity);
 		/*
 		Continuously delta-hedged profit and loss (PnL) function discretised into daily timesteps. Usage: used in lambda function to create
 		a function of sigma only, and returns the associated PnL of a option with given strike, maturity over the corresponding paths.
 		Multiple subpaths can be entered (as rows in the Eigen array paths) in which case the average PnL will be returned, or alternatively
 		a row vector representing a single path can be entered for a single BEV estimate. */
 		double ContinuousDHPnL(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity);
+		/*
+		Analytic derivative of ContinuousDHPnL with respect to sigma, using the vega of the Black Scholes gamma:
+		dGamma/dsigma = Gamma * (d1*d2 - 1) / sigma. Same usage as ContinuousDHPnL. */
+		double ContinuousDHPnLDerivative(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity);
+		// Returns the PnL and its derivative with respect to sigma as a pair, for use with bev_utils::RootByNewtonBrent.
+		std::pair<double, double> ContinuousDHPnLAndDerivative(double sigma, const Eigen::ArrayXXd& paths, double strike, const Eigen::Array<double, 1, Eigen::Dynamic>& times_to_maturity);
 
 		/*
 		Computes the Black Scholes Gamma at each point in time along the path/row. */
@@ -79,7 +413,17 @@ namespace bev {
 		/*	
 		Creates an array of subpaths (rows) of length 21 (days) * term_in_months, with the number of rows 
 		depending on the size of the sample data and the corresponding term	parameter entered. */
-		Eigen::ArrayXXd GetSubPaths(int term_in_months);
+		Eigen::ArrayXXd GetSubPaths(int term_in_months) const;
+		/*
+		View of the subpaths of the maturity of term_in_months months as solved by SolveForBEV, i.e. taken every 
+		sub-path-stride days (see SetSubPathStride), in place on the path and not rebased (see SubPathView). Valid until 
+		the data is next changed. */
+		SubPathView GetSubPathView(int term_in_months) const;
+
+		/*
+		Annualised realised volatility of the daily returns of the given subpaths (rows). Used as the starting point of the 
+		Newton-Brent root finder, being the break-even volatility when gamma is constant along the paths. */
+		double RealisedVolatility(const Eigen::ArrayXXd& paths);
 	};
 }
 
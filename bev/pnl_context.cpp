@@ -0,0 +1,561 @@
+#include "pnl_context.h"
+#include "utils.h"
+#include "workspace.h"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cassert>
+#include <vector>
+
+using namespace bev;
+
+namespace {
+	// Terms of a block of a chunked history (see PnLContext::FromHistoryChunked), laid out and padded as the history's
+	struct Block {
+		uint64_t generation = 0; // of the history the block belongs to, 0 for none
+		int first = 0, end = 0; // prices [first, end) of the history, followed by kernels::kPadding + 1 padding prices
+		bool has_float_terms = false;
+		std::vector<double> log_prices, prices, squared_returns;
+		std::vector<float> float_log_prices, float_prices, float_squared_returns;
+	};
+
+	// The block held by the calling thread, kept between evaluations (its buffers only grow, so are reused without allocating)
+	Block& ThreadBlock() {
+		thread_local Block block;
+		return block;
+	}
+
+	// Makes room for n elements, growing the capacity geometrically: reserve alone allocates exactly n, which would copy
+	// the whole history on every append
+	template <typename T>
+	void ReserveGrowing(std::vector<T>& values, size_t n) {
+		if (n > values.capacity())
+			values.reserve(std::max(n, 2 * values.capacity()));
+	}
+
+	uint64_t NextGeneration() {
+		static std::atomic<uint64_t> generation(0);
+		return ++generation;
+	}
+
+	/*
+	Makes the calling thread's block hold the n_prices prices from start onwards of the chunked history of size prices 
+	read from source, unless it already does. A new block starts at the chunk holding start and covers chunk_prices 
+	prices plus the length of the window, so every window of that length starting in the chunk falls inside it. The
+	terms are computed with the same expressions as PnLContext::ExtendHistory. */
+	const Block& HoldBlock(const double* source, int size, int chunk_prices, uint64_t generation, int start, int n_prices, bool float_terms) {
+		Block& block = ThreadBlock();
+		if (block.generation != generation || start < block.first || start + n_prices > block.end) {
+			int first = start / chunk_prices * chunk_prices;
+			int end = std::min(size, first + chunk_prices + n_prices);
+			int n = end - first;
+			block.prices.assign(source + first, source + end);
+			block.prices.resize(n + kernels::kPadding + 1, block.prices.back());
+			block.log_prices.resize(n);
+			Eigen::Map<Eigen::ArrayXd>(block.log_prices.data(), n) = Eigen::Map<const Eigen::ArrayXd>(block.prices.data(), n).log();
+			block.log_prices.resize(n + kernels::kPadding + 1, block.log_prices.back());
+			Eigen::Map<const Eigen::ArrayXd> S(block.prices.data(), n);
+			block.squared_returns.resize(n - 1);
+			Eigen::Map<Eigen::ArrayXd>(block.squared_returns.data(), n - 1) = ((S.tail(n - 1) - S.head(n - 1)) / S.head(n - 1)).square();
+			block.squared_returns.resize(n + kernels::kPadding, 0.0);
+			block.generation = generation;
+			block.first = first;
+			block.end = end;
+			block.has_float_terms = false;
+		}
+		if (float_terms && !block.has_float_terms) {
+			block.float_log_prices.assign(block.log_prices.begin(), block.log_prices.end());
+			block.float_prices.assign(block.prices.begin(), block.prices.end());
+			block.float_squared_returns.assign(block.squared_returns.begin(), block.squared_returns.end());
+			block.has_float_terms = true;
+		}
+		return block;
+	}
+}
+
+/*
+Caches the sigma-independent terms of the first T-1 points of a window (the points at which the hedge is rebalanced), 
+padded as the kernels require (see kernels::PathTerms) with times to maturity of 1 and discount weights of 0. */
+void PnLContext::BuildTerms(std::shared_ptr<History> history, std::vector<int> starts, const RowVector& times_to_maturity) {
+	int T = times_to_maturity.size();
+	std::shared_ptr<Terms> terms = std::make_shared<Terms>();
+	terms->history = history;
+	terms->n_points = T - 1;
+	terms->tau.resize(T - 1 + kernels::kPadding);
+	terms->tau << times_to_maturity(Eigen::seq(0, T-2)), RowVector::Constant(kernels::kPadding, 1.0);
+	terms->sqrt_tau = terms->tau.sqrt();
+	terms->inv_sqrt_tau = 1.0 / terms->sqrt_tau;
+	terms->discount_weights = (interest_rate_ * terms->tau).exp() / (std::sqrt(2*math_constants::pi) * terms->sqrt_tau);
+	terms->discount_weights.tail(kernels::kPadding) = 0.0;
+	terms->starts = starts;
+	terms_ = terms;
+}
+
+/*
+The history is followed by kernels::kPadding copies of the last price (and log price) and squared returns of 0, so 
+that the kernels can read past the end of the last windows. The padding is removed before appending and put back after. */
+void PnLContext::ExtendHistory(History& history, const double* prices, int n) {
+	if (n <= 0)
+		return;
+	if (history.chunk_prices > 0) {
+		history.source = prices - history.size;
+		history.size += n;
+		history.generation = NextGeneration();
+		return;
+	}
+	int n_old = history.size;
+	int n_new = n_old + n;
+	history.prices.resize(n_old);
+	history.log_prices.resize(n_old);
+	history.squared_returns.resize(std::max(n_old - 1, 0));
+	ReserveGrowing(history.prices, n_new + kernels::kPadding);
+	ReserveGrowing(history.log_prices, n_new + kernels::kPadding);
+	ReserveGrowing(history.squared_returns, n_new - 1 + kernels::kPadding);
+	history.prices.insert(history.prices.end(), prices, prices + n);
+	history.log_prices.resize(n_new);
+	Eigen::Map<Eigen::ArrayXd>(history.log_prices.data() + n_old, n) = Eigen::Map<const Eigen::ArrayXd>(prices, n).log();
+
+	// returns from the last price already held (if any) onwards
+	int first = std::max(n_old, 1); // index of the first new price with a return into it
+	int n_returns = n_new - first;
+	history.squared_returns.resize(n_new - 1);
+	Eigen::Map<const Eigen::ArrayXd> S(history.prices.data() + first - 1, n_returns + 1);
+	Eigen::Map<Eigen::ArrayXd>(history.squared_returns.data() + first - 1, n_returns) = ((S.tail(n_returns) - S.head(n_returns)) / S.head(n_returns)).pow(2);
+	history.cumulative_squared_returns.resize(n_new); // starts at 0
+	for (int t = first; t < n_new; t++)
+		history.cumulative_squared_returns[t] = history.cumulative_squared_returns[t-1] + history.squared_returns[t-1];
+
+	history.size = n_new;
+	history.prices.resize(n_new + kernels::kPadding, history.prices.back());
+	history.log_prices.resize(n_new + kernels::kPadding, history.log_prices.back());
+	history.squared_returns.resize(n_new - 1 + kernels::kPadding, 0.0);
+	if (history.has_float_terms)
+		RoundFloatHistory(history, n_old);
+}
+
+void PnLContext::RoundFloatHistory(History& history, int first) {
+	auto Round = [] (const std::vector<double>& from, std::vector<float>& to, int first) {
+		to.resize(from.size());
+		for (int t = first; t < (int) from.size(); t++)
+			to[t] = (float) from[t];
+	};
+	Round(history.log_prices, history.float_log_prices, first);
+	Round(history.prices, history.float_prices, first);
+	Round(history.squared_returns, history.float_squared_returns, std::max(first - 1, 0)); // the return into the first new price is new too
+}
+
+void PnLContext::RoundFloatTerms(Terms& terms) {
+	FloatTerms& rounded = terms.float_terms;
+	rounded.tau = terms.tau.cast<float>();
+	rounded.sqrt_tau = terms.sqrt_tau.cast<float>();
+	rounded.inv_sqrt_tau = terms.inv_sqrt_tau.cast<float>();
+	rounded.discount_weights = terms.discount_weights.cast<float>();
+}
+
+void PnLContext::SetPrecision(Precision precision) {
+	precision_ = precision;
+	if (precision == Precision::Double)
+		return;
+	if (!terms_->history->has_float_terms) {
+		History& history = MutableHistory();
+		history.has_float_terms = true;
+		RoundFloatHistory(history, 0);
+	}
+	if (!terms_->has_float_terms) {
+		Terms& terms = MutableTerms();
+		terms.has_float_terms = true;
+		RoundFloatTerms(terms);
+	}
+}
+
+PnLContext::Terms& PnLContext::MutableTerms() {
+	if (terms_.use_count() > 1)
+		terms_ = std::make_shared<Terms>(*terms_);
+	return *terms_;
+}
+
+PnLContext::History& PnLContext::MutableHistory() {
+	Terms& terms = MutableTerms();
+	if (terms.history.use_count() > 1)
+		terms.history = std::make_shared<History>(*terms.history);
+	return *terms.history;
+}
+
+void PnLContext::AddWindows(Terms& terms, int stride) {
+	int T = terms.n_points + 1;
+	if (terms.history->chunk_prices > 0) {
+		assert((terms.stride == 0 || terms.stride == stride) && "The windows of a chunked context must keep their stride.");
+		terms.stride = stride;
+		terms.n_windows = terms.history->size >= T ? (terms.history->size - T) / stride + 1 : 0;
+		return;
+	}
+	int start = terms.starts.empty() ? 0 : terms.starts.back() + stride;
+	for (; start + T <= terms.history->size; start += stride)
+		terms.starts.push_back(start);
+}
+
+/*
+The subpaths (rows) are laid out one after the other as a single history with a window starting at each row. */
+PnLContext::PnLContext(const Eigen::ArrayXXd& paths, const RowVector& times_to_maturity, double interest_rate, double dt)
+	: interest_rate_(interest_rate)
+	, dt_(dt)
+{
+	int T = paths.cols();
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows = paths;
+	std::vector<int> starts(paths.rows());
+	for (int n = 0; n < (int) paths.rows(); n++)
+		starts[n] = n*T;
+	std::shared_ptr<History> history = std::make_shared<History>();
+	ExtendHistory(*history, rows.data(), rows.size());
+	BuildTerms(history, starts, times_to_maturity);
+}
+
+PnLContext::PnLContext(const Eigen::ArrayXXd& paths, double strike, const RowVector& times_to_maturity, double interest_rate, double dt)
+	: PnLContext(paths, times_to_maturity, interest_rate, dt)
+{
+	strike_ = strike;
+	log_strike_ = std::log(strike);
+}
+
+PnLContext PnLContext::FromHistory(const double* prices, int n_prices, int stride, const RowVector& times_to_maturity, double interest_rate, double dt) {
+	assert(stride > 0 && "Stride must be positive.");
+	std::shared_ptr<History> history = std::make_shared<History>();
+	ExtendHistory(*history, prices, n_prices);
+	PnLContext context(interest_rate, dt);
+	context.BuildTerms(history, {}, times_to_maturity);
+	AddWindows(*context.terms_, stride);
+	return context;
+}
+
+PnLContext PnLContext::FromHistoryChunked(const double* prices, int n_prices, int stride, const RowVector& times_to_maturity, double interest_rate, double dt, int chunk_prices) {
+	assert(stride > 0 && "Stride must be positive.");
+	assert(chunk_prices > 0 && "Chunks must hold at least one price.");
+	std::shared_ptr<History> history = std::make_shared<History>();
+	history->chunk_prices = chunk_prices;
+	ExtendHistory(*history, prices, n_prices);
+	PnLContext context(interest_rate, dt);
+	context.BuildTerms(history, {}, times_to_maturity);
+	AddWindows(*context.terms_, stride);
+	return context;
+}
+
+PnLContext PnLContext::WithWindows(int stride, const RowVector& times_to_maturity) const {
+	assert(stride > 0 && "Stride must be positive.");
+	PnLContext context(interest_rate_, dt_);
+	context.engine_ = engine_;
+	context.fast_gamma_ = fast_gamma_;
+	context.BuildTerms(terms_->history, {}, times_to_maturity);
+	AddWindows(*context.terms_, stride);
+	context.SetPrecision(precision_);
+	return context;
+}
+
+PnLContext PnLContext::WithStrike(double strike) const {
+	PnLContext context(*this);
+	context.strike_ = strike;
+	context.log_strike_ = std::log(strike);
+	return context;
+}
+
+void PnLContext::AppendHistory(const double* prices, int n_prices, int stride) {
+	assert(stride > 0 && "Stride must be positive.");
+	ExtendHistory(MutableHistory(), prices, n_prices);
+	AddWindows(*terms_, stride);
+}
+
+/*
+The contexts let go of the history first, so that it is only copied when something else still refers to it. */
+void PnLContext::AppendSharedHistory(const std::vector<PnLContext*>& contexts, const std::vector<int>& strides, const double* prices, int n_prices) {
+	if (contexts.empty())
+		return;
+	std::shared_ptr<History> history = contexts[0]->terms_->history;
+	for (PnLContext* context : contexts) {
+		assert(context->terms_->history == history && "The contexts must share their history.");
+		context->MutableTerms().history.reset();
+	}
+	if (history.use_count() > 1)
+		history = std::make_shared<History>(*history);
+	ExtendHistory(*history, prices, n_prices);
+	for (int k = 0; k < (int) contexts.size(); k++) {
+		assert(strides[k] > 0 && "Stride must be positive.");
+		contexts[k]->terms_->history = history;
+		AddWindows(*contexts[k]->terms_, strides[k]);
+	}
+}
+
+void PnLContext::AppendPaths(const Eigen::ArrayXXd& paths) {
+	assert(!Chunked() && "Subpaths can't be appended to a chunked context.");
+	int T = paths.cols();
+	History& history = MutableHistory();
+	int offset = history.size;
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows = paths;
+	ExtendHistory(history, rows.data(), rows.size());
+	for (int n = 0; n < (int) paths.rows(); n++)
+		terms_->starts.push_back(offset + n*T);
+}
+
+kernels::PathTerms PnLContext::SubPathTerms(int path) const {
+	if (Chunked())
+		return BlockTerms(Start(path), terms_->n_points);
+	int start = terms_->starts[path];
+	const History& history = *terms_->history;
+	kernels::PathTerms terms;
+	terms.log_prices = history.log_prices.data() + start;
+	terms.prices = history.prices.data() + start;
+	terms.squared_returns = history.squared_returns.data() + start;
+	terms.tau = terms_->tau.data();
+	terms.sqrt_tau = terms_->sqrt_tau.data();
+	terms.inv_sqrt_tau = terms_->inv_sqrt_tau.data();
+	terms.discount_weights = terms_->discount_weights.data();
+	terms.log_start = history.log_prices[start];
+	terms.inv_start = 1.0 / history.prices[start];
+	terms.n = terms_->n_points;
+	return terms;
+}
+
+kernels::BasicPathTerms<float> PnLContext::FloatSubPathTerms(int path) const {
+	if (Chunked())
+		return FloatBlockTerms(Start(path), terms_->n_points);
+	int start = terms_->starts[path];
+	const History& history = *terms_->history;
+	const FloatTerms& rounded = terms_->float_terms;
+	kernels::BasicPathTerms<float> terms;
+	terms.log_prices = history.float_log_prices.data() + start;
+	terms.prices = history.float_prices.data() + start;
+	terms.squared_returns = history.float_squared_returns.data() + start;
+	terms.tau = rounded.tau.data();
+	terms.sqrt_tau = rounded.sqrt_tau.data();
+	terms.inv_sqrt_tau = rounded.inv_sqrt_tau.data();
+	terms.discount_weights = rounded.discount_weights.data();
+	terms.log_start = history.log_prices[start];
+	terms.inv_start = 1.0 / history.prices[start];
+	terms.n = terms_->n_points;
+	return terms;
+}
+
+kernels::PathTerms PnLContext::BlockTerms(int start, int n_points) const {
+	const History& history = *terms_->history;
+	const Block& block = HoldBlock(history.source, history.size, history.chunk_prices, history.generation, start, n_points + 1, false);
+	int offset = start - block.first;
+	kernels::PathTerms terms;
+	terms.log_prices = block.log_prices.data() + offset;
+	terms.prices = block.prices.data() + offset;
+	terms.squared_returns = block.squared_returns.data() + offset;
+	terms.tau = terms_->tau.data();
+	terms.sqrt_tau = terms_->sqrt_tau.data();
+	terms.inv_sqrt_tau = terms_->inv_sqrt_tau.data();
+	terms.discount_weights = terms_->discount_weights.data();
+	terms.log_start = block.log_prices[offset];
+	terms.inv_start = 1.0 / block.prices[offset];
+	terms.n = n_points;
+	return terms;
+}
+
+kernels::BasicPathTerms<float> PnLContext::FloatBlockTerms(int start, int n_points) const {
+	const History& history = *terms_->history;
+	const Block& block = HoldBlock(history.source, history.size, history.chunk_prices, history.generation, start, n_points + 1, true);
+	int offset = start - block.first;
+	const FloatTerms& rounded = terms_->float_terms;
+	kernels::BasicPathTerms<float> terms;
+	terms.log_prices = block.float_log_prices.data() + offset;
+	terms.prices = block.float_prices.data() + offset;
+	terms.squared_returns = block.float_squared_returns.data() + offset;
+	terms.tau = rounded.tau.data();
+	terms.sqrt_tau = rounded.sqrt_tau.data();
+	terms.inv_sqrt_tau = rounded.inv_sqrt_tau.data();
+	terms.discount_weights = rounded.discount_weights.data();
+	terms.log_start = block.log_prices[offset];
+	terms.inv_start = 1.0 / block.prices[offset];
+	terms.n = n_points;
+	return terms;
+}
+
+template <bool WithDerivative>
+kernels::PnLTerms PnLContext::PathPnL(double sigma, int path) const {
+	if (engine_ == PnLEngine::Daily)
+		return kernels::DailyDHPnL<WithDerivative>(sigma, log_strike_, interest_rate_, dt_, SubPathTerms(path));
+	if (precision_ != Precision::Double)
+		return kernels::ContinuousDHPnL<WithDerivative>(sigma, log_strike_, interest_rate_, dt_, FloatSubPathTerms(path));
+	if (fast_gamma_)
+		return kernels::ContinuousDHPnL<WithDerivative, double, true>(sigma, log_strike_, interest_rate_, dt_, SubPathTerms(path));
+	return kernels::ContinuousDHPnL<WithDerivative>(sigma, log_strike_, interest_rate_, dt_, SubPathTerms(path));
+}
+
+double PnLContext::PnL(double sigma) const {
+	double pnl = 0;
+	for (int n = 0; n < NumPaths(); n++)
+		pnl += PathPnL<false>(sigma, n).pnl;
+	return pnl / NumPaths();
+}
+
+double PnLContext::PnL(double sigma, int path) const {
+	return PathPnL<false>(sigma, path).pnl;
+}
+
+std::pair<double, double> PnLContext::PnLAndDerivative(double sigma) const {
+	double pnl = 0, dpnl = 0;
+	for (int n = 0; n < NumPaths(); n++) {
+		kernels::PnLTerms path_pnl = PathPnL<true>(sigma, n);
+		pnl += path_pnl.pnl;
+		dpnl += path_pnl.dpnl;
+	}
+	return std::make_pair(pnl / NumPaths(), dpnl / NumPaths());
+}
+
+std::pair<double, double> PnLContext::PnLAndDerivative(double sigma, int path) const {
+	kernels::PnLTerms path_pnl = PathPnL<true>(sigma, path);
+	return std::make_pair(path_pnl.pnl, path_pnl.dpnl);
+}
+
+double PnLContext::PnL(double sigma, int n_paths, const int* paths, const double* weights) const {
+	double pnl = 0, total_weight = 0;
+	for (int k = 0; k < n_paths; k++) {
+		pnl += weights[k] * PathPnL<false>(sigma, paths[k]).pnl;
+		total_weight += weights[k];
+	}
+	return pnl / total_weight;
+}
+
+std::pair<double, double> PnLContext::PnLAndDerivative(double sigma, int n_paths, const int* paths, const double* weights) const {
+	double pnl = 0, dpnl = 0, total_weight = 0;
+	for (int k = 0; k < n_paths; k++) {
+		kernels::PnLTerms path_pnl = PathPnL<true>(sigma, paths[k]);
+		pnl += weights[k] * path_pnl.pnl;
+		dpnl += weights[k] * path_pnl.dpnl;
+		total_weight += weights[k];
+	}
+	return std::make_pair(pnl / total_weight, dpnl / total_weight);
+}
+
+/*
+Walks the subpaths in order and, for each, runs the lockstep kernel over every lane using that subpath: the lanes averaging 
+over all subpaths plus the lanes of that single subpath. Sums for the averaging lanes are accumulated in subpath order, as
+in PnL(sigma), so the results match the single-lane functions exactly. */
+void PnLContext::PnLLanes(int n_lanes, const double* sigmas, const double* strikes, const int* paths, double* pnls, double* dpnls) const {
+	bev_utils::ScratchArena scratch(n_lanes * (4 * sizeof(double) + 2 * sizeof(int) + 2 * sizeof(kernels::PnLTerms)) + 8 * bev_utils::ScratchArena::kAlignment);
+	PnLLanes(n_lanes, sigmas, strikes, paths, pnls, dpnls, scratch);
+}
+
+void PnLContext::PnLLanes(int n_lanes, const double* sigmas, const double* strikes, const int* paths, double* pnls, double* dpnls, bev_utils::ScratchArena& scratch) const {
+	bev_utils::ScratchArena::Frame frame(scratch);
+	// lane indices ordered by subpath, averaging lanes (-1) first, keeping the lanes of a subpath in order
+	int* order = scratch.Allocate<int>(n_lanes);
+	for (int l = 0; l < n_lanes; l++)
+		order[l] = l;
+	std::sort(order, order + n_lanes, [paths] (int a, int b) { return paths[a] < paths[b] || (paths[a] == paths[b] && a < b); });
+	int n_averaging = 0;
+	while (n_averaging < n_lanes && paths[order[n_averaging]] < 0)
+		n_averaging++;
+
+	double* log_strikes = scratch.Allocate<double>(n_lanes);
+	double* row_sigmas = scratch.Allocate<double>(n_lanes);
+	double* row_log_strikes = scratch.Allocate<double>(n_lanes);
+	for (int l = 0; l < n_lanes; l++)
+		log_strikes[l] = std::log(strikes[l]);
+	int* row_lanes = scratch.Allocate<int>(n_lanes);
+	kernels::PnLTerms* row_terms = scratch.Allocate<kernels::PnLTerms>(n_lanes);
+	kernels::PnLTerms* sums = scratch.Allocate(n_averaging, kernels::PnLTerms());
+	for (int l = 0; l < n_lanes; l++) {
+		pnls[l] = 0;
+		if (dpnls)
+			dpnls[l] = 0;
+	}
+
+	int next = n_averaging; // position in order of the first single-subpath lane not yet evaluated
+	for (int n = 0; n < NumPaths(); n++) {
+		int lanes = 0;
+		for (int k = 0; k < n_averaging; k++)
+			row_lanes[lanes++] = order[k];
+		while (next < n_lanes && paths[order[next]] == n)
+			row_lanes[lanes++] = order[next++];
+		if (lanes == 0)
+			continue;
+		for (int k = 0; k < lanes; k++) {
+			row_sigmas[k] = sigmas[row_lanes[k]];
+			row_log_strikes[k] = log_strikes[row_lanes[k]];
+		}
+
+		if (engine_ == PnLEngine::Daily) {
+			for (int k = 0; k < lanes; k++)
+				row_terms[k] = dpnls ? kernels::DailyDHPnL<true>(row_sigmas[k], row_log_strikes[k], interest_rate_, dt_, SubPathTerms(n))
+									 : kernels::DailyDHPnL<false>(row_sigmas[k], row_log_strikes[k], interest_rate_, dt_, SubPathTerms(n));
+		}
+		else if (precision_ != Precision::Double) {
+			if (dpnls)
+				kernels::ContinuousDHPnLLanes<true>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, FloatSubPathTerms(n), row_terms);
+			else
+				kernels::ContinuousDHPnLLanes<false>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, FloatSubPathTerms(n), row_terms);
+		}
+		else if (fast_gamma_) {
+			if (dpnls)
+				kernels::ContinuousDHPnLLanes<true, double, true>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, SubPathTerms(n), row_terms);
+			else
+				kernels::ContinuousDHPnLLanes<false, double, true>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, SubPathTerms(n), row_terms);
+		}
+		else if (dpnls)
+			kernels::ContinuousDHPnLLanes<true>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, SubPathTerms(n), row_terms);
+		else
+			kernels::ContinuousDHPnLLanes<false>(lanes, row_sigmas, row_log_strikes, interest_rate_, dt_, SubPathTerms(n), row_terms);
+
+		for (int k = 0; k < lanes; k++) {
+			if (k < n_averaging) {
+				sums[k].pnl += row_terms[k].pnl;
+				sums[k].dpnl += row_terms[k].dpnl;
+			} else {
+				pnls[row_lanes[k]] = row_terms[k].pnl;
+				if (dpnls)
+					dpnls[row_lanes[k]] = row_terms[k].dpnl;
+			}
+		}
+	}
+
+	for (int k = 0; k < n_averaging; k++) {
+		pnls[order[k]] = sums[k].pnl / NumPaths();
+		if (dpnls)
+			dpnls[order[k]] = sums[k].dpnl / NumPaths();
+	}
+}
+
+/*
+Realised volatilities come from the prefix sums of the squared returns, in O(1) per window. Chunked contexts hold no
+prefix sums, so walk the history block by block instead, weighting each squared return by the number of windows 
+containing it. */
+double PnLContext::RealisedVolatility() const {
+	if (Chunked()) {
+		const History& history = *terms_->history;
+		int n_points = terms_->n_points, stride = terms_->stride;
+		int end = NumPaths() > 0 ? Start(NumPaths() - 1) + n_points : 0; // one past the last return in a window
+		double sum = 0;
+		for (int first = 0; first < end; first += history.chunk_prices) {
+			int n = std::min(history.chunk_prices, end - first);
+			const Block& block = HoldBlock(history.source, history.size, history.chunk_prices, history.generation, first, n + 1, false);
+			for (int t = first; t < first + n; t++) {
+				int lowest = t < n_points ? 0 : (t - n_points + stride) / stride; // windows k*stride <= t < k*stride + n_points
+				int highest = std::min(t / stride, NumPaths() - 1);
+				if (highest >= lowest)
+					sum += (highest - lowest + 1) * block.squared_returns[t - block.first];
+			}
+		}
+		return std::sqrt(sum / (NumPaths() * n_points) / dt_);
+	}
+	const std::vector<double>& cumulative = terms_->history->cumulative_squared_returns;
+	double sum = 0;
+	for (int n = 0; n < NumPaths(); n++)
+		sum += cumulative[terms_->starts[n] + terms_->n_points] - cumulative[terms_->starts[n]];
+	return std::sqrt(sum / (NumPaths() * terms_->n_points) / dt_);
+}
+
+double PnLContext::RealisedVolatility(int path) const {
+	if (Chunked()) {
+		kernels::PathTerms terms = BlockTerms(Start(path), terms_->n_points);
+		double sum = 0;
+		for (int t = 0; t < terms_->n_points; t++)
+			sum += terms.squared_returns[t];
+		return std::sqrt(sum / terms_->n_points / dt_);
+	}
+	int start = terms_->starts[path];
+	const std::vector<double>& cumulative = terms_->history->cumulative_squared_returns;
+	double sum = cumulative[start + terms_->n_points] - cumulative[start];
+	return std::sqrt(sum / terms_->n_points / dt_);
+}
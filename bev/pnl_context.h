@@ -0,0 +1,219 @@
+#ifndef BEV_PNL_CONTEXT_H
+#define BEV_PNL_CONTEXT_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "pnl_kernel.h"
+
+namespace bev_utils {
+	class ScratchArena;
+}
+
+namespace bev {
+	// PnL function whose root is the break-even volatility, see BEV::SetPnLEngine
+	enum class PnLEngine {
+		Continuous,	// kernels::ContinuousDHPnL, the continuous-hedging approximation (gamma times the hedging error)
+		Daily		// kernels::DailyDHPnL, the PnL of a call sold and delta hedged once per day, settled at expiry
+	};
+
+	// Floating point precision of the PnL evaluations, see BEV::SetPrecision
+	enum class Precision {
+		Double,	// cached terms and kernels in double
+		Float,	// continuous engine evaluated over float copies of the cached terms, summed over each subpath in float and over subpaths in double
+		Mixed	// as Float while searching for the root, which is then polished by a few iterations in double
+	};
+
+	/*
+	Sigma-independent terms of the continuously delta-hedged PnL function for one maturity and strike.
+
+	Writing the Black Scholes gamma out in full, each term of the PnL sum becomes
+		Gamma_ti * S_ti^2 * e^(r*(T-ti)) * (sigma^2 * dt - (dS_ti / S_ti)^2)
+			= exp(-d1^2 / 2) * S_ti * [e^(r*(T-ti)) / sqrt(2*pi*(T-ti))] / sigma * (sigma^2 * dt - (dS_ti / S_ti)^2),
+		with d1 = (log(S_ti) - log(K) + (r + sigma^2 / 2)*(T-ti)) / (sigma * sqrt(T-ti)),
+	so log(S), S, the bracketed discount weight, the squared returns and the square roots of the times to maturity are 
+	cached on construction and each evaluation only needs the sigma-dependent exp and divide work, done in a single fused 
+	pass over each subpath by kernels::ContinuousDHPnL (see pnl_kernel.h).
+
+	The price terms are stored once for the whole price history and the subpaths are windows into it, given by their 
+	starting index. Each window is rebased on the fly by its starting price S_t0, using log(S_ti / S_t0) = log(S_ti) - log(S_t0)
+	(log prices being the prefix sums of the log returns), so overlapping windows (see BEV::SetSubPathStride) cost no 
+	more memory than the history itself, however small the stride.
+	None of the cached terms depend on the strike, so they are shared (not copied) between the contexts of all strikes
+	of a maturity, see WithStrike, and all strikes can be evaluated in one pass over the data, see PnLLanes. The history
+	terms don't depend on the maturity either, and are shared between the contexts of all maturities, see WithWindows.
+	USAGE:	Build once from the price history with FromHistory (or from a matrix of subpaths as returned by BEV::GetSubPaths),
+			derive the other maturities with WithWindows, and evaluate for as many sigmas as the root finder needs. Evaluations are const and safe to 
+			call concurrently. */
+	class PnLContext {
+	public:
+		typedef Eigen::Array<double, 1, Eigen::Dynamic> RowVector;
+
+	private:
+		typedef Eigen::Array<float, 1, Eigen::Dynamic> FloatRowVector;
+		// Terms of the price history, followed by kernels::kPadding padding values (see ExtendHistory)
+		struct History {
+			int size = 0; // number of prices, without the padding
+			std::vector<double> log_prices; // log(S_t) over the history
+			std::vector<double> prices; // S_t
+			std::vector<double> squared_returns; // (dS_t / S_t)^2
+			std::vector<double> cumulative_squared_returns; // prefix sums of the squared returns, starting at 0, for O(1) realised volatility per window
+			bool has_float_terms = false;
+			std::vector<float> float_log_prices, float_prices, float_squared_returns; // float copies, see SetPrecision, kept up to date once has_float_terms is set
+			// Chunked histories (see FromHistoryChunked) leave the vectors above empty and read the prices in place from
+			// source, computing the terms of one block of chunk_prices prices at a time, see BlockTerms
+			const double* source = nullptr;
+			int chunk_prices = 0; // 0 unless chunked
+			uint64_t generation = 0; // identifies the prices of a chunked history, for the blocks kept by each thread
+		};
+		// float copies of the window terms evaluated by the kernels, see SetPrecision
+		struct FloatTerms {
+			FloatRowVector tau, sqrt_tau, inv_sqrt_tau, discount_weights;
+		};
+		// Terms of the windows (subpaths) of one maturity, padded like the history, see BuildTerms
+		struct Terms {
+			std::shared_ptr<History> history; // shared between the contexts of all maturities built on the same history
+			int n_points = 0; // rebalancing points of a window (the window holds n_points + 1 prices), without the padding
+			RowVector tau; // times to maturity T-ti at the rebalancing points of a window
+			RowVector sqrt_tau; // sqrt(T-ti)
+			RowVector inv_sqrt_tau; // 1 / sqrt(T-ti)
+			RowVector discount_weights; // e^(r*(T-ti)) / sqrt(2*pi*(T-ti))
+			std::vector<int> starts; // index of the first price of each window (subpath) in the history
+			int stride = 0, n_windows = 0; // chunked histories: n_windows windows every stride prices from the start, with starts left empty
+			bool has_float_terms = false;
+			FloatTerms float_terms; // kept up to date with the terms above once has_float_terms is set
+		};
+		std::shared_ptr<Terms> terms_;
+		double strike_ = 1.0;
+		double log_strike_ = 0.0;
+		double interest_rate_;
+		double dt_;
+		PnLEngine engine_ = PnLEngine::Continuous;
+		Precision precision_ = Precision::Double;
+		bool fast_gamma_ = false;
+
+		PnLContext(double interest_rate, double dt) : interest_rate_(interest_rate), dt_(dt) {};
+		// Fills the terms with a window of times_to_maturity.size() prices of history starting at each of starts
+		void BuildTerms(std::shared_ptr<History> history, std::vector<int> starts, const RowVector& times_to_maturity);
+		// Appends n prices to history, with their log prices, squared returns and prefix sums
+		static void ExtendHistory(History& history, const double* prices, int n);
+		// The terms (or their history), copied first if they are shared with another context (e.g. one made by WithStrike or WithWindows)
+		Terms& MutableTerms();
+		History& MutableHistory();
+		// Rounds the history from index first onwards into its float copies, and the window terms into theirs
+		static void RoundFloatHistory(History& history, int first);
+		static void RoundFloatTerms(Terms& terms);
+		// Adds the windows every stride prices after the last window (from the start of the history, if none) that end within the history
+		static void AddWindows(Terms& terms, int stride);
+		kernels::BasicPathTerms<float> FloatSubPathTerms(int path) const;
+		bool Chunked() const { return terms_->history->chunk_prices > 0; };
+		int Start(int path) const { return Chunked() ? path * terms_->stride : terms_->starts[path]; };
+		// Pointers to the terms of the n_points + 1 prices from start onwards (and their padding) of a chunked history, in 
+		// the block of the history held by the calling thread, which is computed first if it doesn't hold them
+		kernels::PathTerms BlockTerms(int start, int n_points) const;
+		kernels::BasicPathTerms<float> FloatBlockTerms(int start, int n_points) const;
+		// PnL (and derivative) of a single subpath with the selected engine and precision
+		template <bool WithDerivative>
+		kernels::PnLTerms PathPnL(double sigma, int path) const;
+
+	public:
+		// Context for a single strike, or for the whole maturity (strike 1.0 until set with WithStrike), over the subpaths (rows) of paths.
+		PnLContext(const Eigen::ArrayXXd& paths, double strike, const RowVector& times_to_maturity, double interest_rate, double dt);
+		PnLContext(const Eigen::ArrayXXd& paths, const RowVector& times_to_maturity, double interest_rate, double dt);
+		/*
+		Context over windows of times_to_maturity.size() prices taken every stride prices along the history of n_prices 
+		prices (a column vector), without materialising the windows. stride = times_to_maturity.size() gives the 
+		non-overlapping subpaths of BEV::GetSubPaths, stride = 1 every possible window. */
+		static PnLContext FromHistory(const double* prices, int n_prices, int stride, const RowVector& times_to_maturity, double interest_rate, double dt);
+		/*
+		Context over windows of times_to_maturity.size() prices taken every stride prices along the history of this context,
+		e.g. another maturity of the same path. The history terms are shared, not copied, so a surface over many maturities 
+		holds one copy of them. The engine, precision, gamma mode and interest rate are those of this context, at strike 1.0. */
+		PnLContext WithWindows(int stride, const RowVector& times_to_maturity) const;
+		/*
+		Context over the same windows as FromHistory, for histories too long to hold the cached terms of (e.g. thousands of
+		years of simulated prices), evaluated in blocks of chunk_prices prices. The prices are read in place, from memory 
+		or a memory-mapped file (see data_utils::PriceCache), and must outlive the context. No per-price terms are held:
+		each thread evaluating the context computes the terms of one block of the history at a time (log prices, squared
+		returns and, for Float and Mixed precision, their float copies) and keeps them for its next evaluations. Walking
+		the subpaths in order, as the average PnLs and the lockstep lanes do, computes each block once per walk while it 
+		stays in cache, and the repeated evaluations of a single subpath's root solve reuse the block holding it. So the 
+		memory held is a block per thread (about 36 * chunk_prices bytes) plus the window terms of each maturity, however 
+		long the history, and the results match FromHistory's to within a few ulps (the log prices of a block may be 
+		computed in different SIMD lanes). AppendHistory expects the new prices to follow the existing ones in one buffer 
+		(which may have moved), taking prices - (number of prices held) as the new start of the history. Contexts made 
+		from a matrix of subpaths can't be chunked. */
+		static PnLContext FromHistoryChunked(const double* prices, int n_prices, int stride, const RowVector& times_to_maturity, double interest_rate, double dt, int chunk_prices);
+
+		// Cheap copy of this context for another strike, sharing the cached terms.
+		PnLContext WithStrike(double strike) const;
+
+		/*
+		Incremental updates as new data arrives, in time proportional to the data added (the terms already cached are left
+		as they are). AppendHistory extends the history of a context made by FromHistory with n_prices new prices and adds 
+		the windows completed by them, continuing every stride prices from the last window. AppendPaths adds the subpaths
+		(rows) of paths to a context made from a matrix of subpaths. Contexts copied from this one before the call keep
+		the terms they had. */
+		void AppendHistory(const double* prices, int n_prices, int stride);
+		void AppendPaths(const Eigen::ArrayXXd& paths);
+		/*
+		AppendHistory for contexts[k] with strides[k], for contexts built on the same history (e.g. the maturities of a
+		path, see WithWindows): the shared history is extended once, in place unless a context outside contexts also 
+		shares it, and stays shared. */
+		static void AppendSharedHistory(const std::vector<PnLContext*>& contexts, const std::vector<int>& strides, const double* prices, int n_prices);
+
+		// Selects the PnL function evaluated, for this context and the contexts copied from it (e.g. by WithStrike).
+		void SetEngine(PnLEngine engine) { engine_ = engine; };
+		PnLEngine Engine() const { return engine_; };
+		/*
+		Selects the precision of the evaluations, for this context and the contexts copied from it after the call. Float
+		and Mixed (which evaluate alike, Mixed only differing in BEV's root solve) build float copies of the cached terms 
+		on first use, shared like the double terms. The daily engine is always evaluated in double, as its hedge gains
+		are differences of consecutive prices which float can't resolve. */
+		void SetPrecision(Precision precision);
+		Precision EvaluationPrecision() const { return precision_; };
+		/*
+		Selects the exp of the normal density in the gamma terms of the continuous engine in double precision, for this 
+		context and the contexts copied from it: Eigen's exp (the default), or a division-free polynomial with a relative
+		error below kernels::kFastGammaTolerance, see kernels::GaussianExp. The float evaluations and the daily engine 
+		are unaffected. */
+		void SetFastGamma(bool fast_gamma) { fast_gamma_ = fast_gamma; };
+		bool FastGamma() const { return fast_gamma_; };
+
+		int NumPaths() const { return Chunked() ? terms_->n_windows : (int) terms_->starts.size(); };
+		double Strike() const { return strike_; };
+		// Pointers to the cached terms of a single subpath, as used by the fused kernels. For chunked contexts they point into
+		// the calling thread's block (see FromHistoryChunked), and stay valid until its next call for a subpath of another block.
+		kernels::PathTerms SubPathTerms(int path) const;
+
+		// Average PnL over all subpaths, as BEV::ContinuousDHPnL, or the PnL of a single subpath.
+		double PnL(double sigma) const;
+		double PnL(double sigma, int path) const;
+		// PnL and its derivative with respect to sigma (as BEV::ContinuousDHPnLAndDerivative), averaged over all subpaths or for a single subpath.
+		std::pair<double, double> PnLAndDerivative(double sigma) const;
+		std::pair<double, double> PnLAndDerivative(double sigma, int path) const;
+		/*
+		Weighted average PnL (and derivative) over the n_paths subpaths paths[k], weighted by weights[k], e.g. a bootstrap
+		resample given by the subpaths drawn and how often each was drawn (see BEV::Bootstrap). */
+		double PnL(double sigma, int n_paths, const int* paths, const double* weights) const;
+		std::pair<double, double> PnLAndDerivative(double sigma, int n_paths, const int* paths, const double* weights) const;
+
+		/*
+		Lockstep evaluation of n_lanes (sigma, strike) pairs: lane l evaluates sigmas[l] at strikes[l], averaged over all
+		subpaths when paths[l] is -1 or for the single subpath paths[l] otherwise. Each subpath is streamed once for all
+		lanes using it (with the continuous engine; the daily engine evaluates the lanes one after another). Writes the
+		PnLs to pnls and, if dpnls is not null, the derivatives to dpnls. The results are identical to the single-lane
+		functions above. */
+		void PnLLanes(int n_lanes, const double* sigmas, const double* strikes, const int* paths, double* pnls, double* dpnls = nullptr) const;
+		// Same, taking its scratch buffers from scratch (rewound on return) rather than the heap, see bev_utils::Workspace
+		void PnLLanes(int n_lanes, const double* sigmas, const double* strikes, const int* paths, double* pnls, double* dpnls, bev_utils::ScratchArena& scratch) const;
+
+		// Annualised realised volatility over all subpaths, or of a single subpath, see BEV::RealisedVolatility.
+		double RealisedVolatility() const;
+		double RealisedVolatility(int path) const;
+	};
+}
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef BEV_PNL_KERNEL_H
+#define BEV_PNL_KERNEL_H
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <algorithm>
+
+namespace bev {
+	namespace kernels {
+		/*
+		Fused single-pass kernels for the continuously (and, see DailyDHPnL, discretely) delta-hedged PnL function, operating
+		on the cached terms of a PnLContext.
+
+		Rather than building the PnL from a chain of Eigen array expressions (see BEV::ContinuousDHPnL, kept as the reference
+		implementation), the kernel makes one pass over a subpath, computing d1, gamma, the hedging error and the discounted
+		sum in registers. It is written against Eigen's packet math layer, so the same code uses the widest SIMD packet enabled
+		at compile time, i.e. AVX-512 (8 doubles), AVX2 (4) or SSE2 (2), with the vectorised exp of that packet type, and falls
+		back to plain scalar code (packet size 1 with std::exp) when Eigen vectorisation is disabled.
+		Build with BEV_NATIVE_ARCH=ON (CMake) or -march=native to enable the AVX2/AVX-512 packets.
+		The continuous kernels are templated on the scalar type of the cached terms: with float terms (see Precision in 
+		pnl_context.h) each packet holds twice as many values and half the bytes are streamed. The per-subpath sigma 
+		constants are still formed in double, the sum over a subpath is made in the scalar type, and the result, like the
+		sums over subpaths made by the callers, is in double.
+		They are also templated on FastGamma, which swaps the exp of the normal density for a division-free polynomial
+		with a bounded relative error, see GaussianExp. */
+
+		// PnL of one subpath and its derivative with respect to sigma
+		struct PnLTerms {
+			double pnl = 0;
+			double dpnl = 0;
+		};
+
+		/*
+		Cached terms of one subpath (window of the price history), each pointing at n contiguous values (see PnLContext):
+			log_prices = log(S_ti), prices = S_ti, squared_returns = (dS_ti / S_ti)^2, tau = T-ti, sqrt_tau = sqrt(T-ti),
+			inv_sqrt_tau = 1 / sqrt(T-ti), discount_weights = e^(r*(T-ti)) / sqrt(2*pi*(T-ti)).
+		The prices are not rebased: the subpath is rebased on the fly by its starting price S_t0, through log_start = log(S_t0)
+		and inv_start = 1 / S_t0, so that overlapping windows can all point into the same price history.
+		Every term must also be readable for kPadding points past n (prices for one more), holding finite values and zero
+		discount weights: the kernels evaluate the last, partial packet of a subpath as a whole packet, whose points past n
+		then add exactly zero, rather than finishing with scalar code (with up to packet size - 1 scalar exps, e.g. 4 of 
+		the 20 points of a one-month subpath with AVX-512). */
+		template <typename Scalar>
+		struct BasicPathTerms {
+			const Scalar* log_prices;
+			const Scalar* prices;
+			const Scalar* squared_returns;
+			const Scalar* tau;
+			const Scalar* sqrt_tau;
+			const Scalar* inv_sqrt_tau;
+			const Scalar* discount_weights;
+			double log_start;
+			double inv_start;
+			int n;
+		};
+		typedef BasicPathTerms<double> PathTerms;
+
+		// Points past the end of a subpath read by the kernels, at least the largest packet size (16 floats with AVX-512)
+		const int kPadding = 16;
+
+		/*
+		Relative error bound of the fast Gaussian exp (see GaussianExp), which carries over to every term of the PnL sum,
+		so that the PnL (and its derivative) of the fast gamma mode is within kFastGammaTolerance * sum(|term_ti * (...)|)
+		of the exact evaluation, see BEV::SetFastGamma. */
+		const double kFastGammaTolerance = 1e-14;
+
+		namespace detail {
+			/*
+			y * 2^n for the integer n held in the low bits of rounded = n + 1.5 * 2^52, built directly in the exponent
+			bits of a double (valid for -1022 <= n <= 1023) with a 64-bit integer shift where the instruction set has 
+			one, and through Eigen's pldexp otherwise. */
+			template <typename Packet>
+			inline Packet ScaleByPow2(const Packet& y, const Packet& /*rounded*/, const Packet& n) {
+				return Eigen::internal::pldexp(y, n);
+			}
+#if defined(EIGEN_VECTORIZE_SSE2)
+			inline Eigen::internal::Packet2d ScaleByPow2(const Eigen::internal::Packet2d& y, const Eigen::internal::Packet2d& rounded, const Eigen::internal::Packet2d&) {
+				return _mm_mul_pd(y, _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(_mm_castpd_si128(rounded), _mm_set1_epi64x(1023)), 52)));
+			}
+#endif
+#if defined(EIGEN_VECTORIZE_AVX2)
+			inline Eigen::internal::Packet4d ScaleByPow2(const Eigen::internal::Packet4d& y, const Eigen::internal::Packet4d& rounded, const Eigen::internal::Packet4d&) {
+				return _mm256_mul_pd(y, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_castpd_si256(rounded), _mm256_set1_epi64x(1023)), 52)));
+			}
+#endif
+#if defined(EIGEN_VECTORIZE_AVX512)
+			inline Eigen::internal::Packet8d ScaleByPow2(const Eigen::internal::Packet8d& y, const Eigen::internal::Packet8d& rounded, const Eigen::internal::Packet8d&) {
+				return _mm512_mul_pd(y, _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(_mm512_castpd_si512(rounded), _mm512_set1_epi64(1023)), 52)));
+			}
+#endif
+
+			/*
+			exp(x) for x <= 0 without a division: x = n*log(2) + r with n = round(x / log(2)) (by the 1.5 * 2^52 rounding
+			trick) and |r| <= log(2)/2 (subtracting n*log(2) in two parts, as in Eigen's pexp), exp(r) from its Taylor 
+			polynomial of degree 11, whose truncation error is below 0.3466^12 / 12! / exp(-0.3466) < 9.4e-15 relative, and
+			the result scaled by 2^n. x is clamped at -708 (so 2^n stays normal), where exp(x) < 3.4e-308 is below any 
+			contribution to a PnL, and NaNs propagate. */
+			template <typename Packet>
+			inline Packet FastNegativeExp(const Packet& x) {
+				using namespace Eigen::internal;
+				const Packet clamped = pmax<Eigen::PropagateNaN>(x, pset1<Packet>(-708.0));
+				const Packet magic = pset1<Packet>(6755399441055744.0); // 1.5 * 2^52
+				const Packet rounded = pmadd(clamped, pset1<Packet>(1.4426950408889634074), magic);
+				const Packet n = psub(rounded, magic);
+				Packet r = psub(clamped, pmul(n, pset1<Packet>(0.693145751953125)));
+				r = psub(r, pmul(n, pset1<Packet>(1.42860682030941723212e-6)));
+				Packet y = pset1<Packet>(1.0 / 39916800);
+				y = pmadd(y, r, pset1<Packet>(1.0 / 3628800));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 362880));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 40320));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 5040));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 720));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 120));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 24));
+				y = pmadd(y, r, pset1<Packet>(1.0 / 6));
+				y = pmadd(y, r, pset1<Packet>(0.5));
+				y = pmadd(y, r, pset1<Packet>(1.0));
+				y = pmadd(y, r, pset1<Packet>(1.0));
+				return ScaleByPow2(y, rounded, n);
+			}
+
+			// Selects the exp of the gamma term: Eigen's pexp, or FastNegativeExp for double terms in the fast gamma mode
+			template <bool FastGamma, typename Scalar>
+			struct GaussianExpImpl {
+				template <typename Packet>
+				static Packet Run(const Packet& x) { return Eigen::internal::pexp(x); }
+			};
+			template <>
+			struct GaussianExpImpl<true, double> {
+				template <typename Packet>
+				static Packet Run(const Packet& x) { return FastNegativeExp(x); }
+			};
+		}
+
+		/*
+		exp(-d1^2 / 2) of the normal density in the gamma term, computed by Eigen's pexp or, with FastGamma, by a 
+		division-free polynomial exp with a relative error below kFastGammaTolerance (over the whole range, not only near
+		the money). Float terms always use pexp, whose float form is already a polynomial. */
+		template <bool FastGamma, typename Scalar, typename Packet>
+		inline Packet GaussianExp(const Packet& minus_half_d1_squared) {
+			return detail::GaussianExpImpl<FastGamma, Scalar>::Run(minus_half_d1_squared);
+		}
+
+		/*
+		Single pass over one subpath. Returns the PnL and, when WithDerivative is true, dPnL/dsigma, using
+			d1 = (log(S_ti) - log(S_t0) - log(K) + (r + sigma^2 / 2)*(T-ti)) / (sigma * sqrt(T-ti)),
+			term_ti = exp(-d1^2 / 2) * (S_ti / S_t0) * discount_weights_ti / sigma,
+			PnL = sum(term_ti * (sigma^2 * dt - (dS_ti / S_ti)^2)),
+			dPnL/dsigma = sum(term_ti * ((d1*d2 - 1) / sigma * (sigma^2 * dt - (dS_ti / S_ti)^2) + 2 * sigma * dt)). */
+		template <bool WithDerivative, typename Scalar = double, bool FastGamma = false>
+		inline PnLTerms ContinuousDHPnL(double sigma, double log_strike, double interest_rate, double dt, const BasicPathTerms<Scalar>& path) {
+			using namespace Eigen::internal;
+			typedef typename packet_traits<Scalar>::type Packet;
+			const int packet_size = packet_traits<Scalar>::size;
+
+			const Scalar drift = interest_rate + 0.5*sigma*sigma; // d1 = (log(S/K) + drift * tau) / (sigma * sqrt(tau))
+			const double inv_sigma = 1.0 / sigma;
+			const Scalar sigma2_dt = sigma*sigma*dt;
+			const Scalar two_sigma_dt = 2*sigma*dt;
+
+			const Packet p_drift = pset1<Packet>(drift);
+			const Scalar log_shift = log_strike + path.log_start; // rebasing and moneyness in one shift
+			const Packet p_log_shift = pset1<Packet>(log_shift);
+			const Packet p_inv_sigma = pset1<Packet>(Scalar(inv_sigma));
+			const Packet p_sigma = pset1<Packet>(Scalar(sigma));
+			const Packet p_sigma2_dt = pset1<Packet>(sigma2_dt);
+			const Packet p_two_sigma_dt = pset1<Packet>(two_sigma_dt);
+			const Packet p_minus_half = pset1<Packet>(Scalar(-0.5));
+			const Packet p_one = pset1<Packet>(Scalar(1.0));
+			Packet p_pnl = pset1<Packet>(Scalar(0.0));
+			Packet p_dpnl = pset1<Packet>(Scalar(0.0));
+
+			static_assert(packet_size <= kPadding, "The padding of the cached terms must cover a packet.");
+
+			for (int i = 0; i < path.n; i += packet_size) {
+				Packet d1 = pmul(psub(pmadd(p_drift, ploadu<Packet>(path.tau + i), ploadu<Packet>(path.log_prices + i)), p_log_shift),
+								pmul(ploadu<Packet>(path.inv_sqrt_tau + i), p_inv_sigma));
+				Packet term = pmul(GaussianExp<FastGamma, Scalar>(pmul(p_minus_half, pmul(d1, d1))), pmul(ploadu<Packet>(path.prices + i), ploadu<Packet>(path.discount_weights + i)));
+				Packet hedging_error = psub(p_sigma2_dt, ploadu<Packet>(path.squared_returns + i));
+				p_pnl = pmadd(term, hedging_error, p_pnl);
+				if (WithDerivative) {
+					Packet d2 = psub(d1, pmul(p_sigma, ploadu<Packet>(path.sqrt_tau + i)));
+					Packet vega = pmul(psub(pmul(d1, d2), p_one), p_inv_sigma);
+					p_dpnl = pmadd(term, pmadd(vega, hedging_error, p_two_sigma_dt), p_dpnl);
+				}
+			}
+			Scalar pnl = predux(p_pnl);
+			Scalar dpnl = WithDerivative ? predux(p_dpnl) : Scalar(0.0);
+
+			PnLTerms result;
+			result.pnl = (double) pnl * (path.inv_start * inv_sigma);
+			result.dpnl = (double) dpnl * (path.inv_start * inv_sigma);
+			return result;
+		}
+
+		/*
+		Standard normal CDF from Hart's rational approximation (Hart 1968, as given by G. West, "Better approximations to
+		cumulative normal functions", 2005), with an absolute error below 1e-15. exp_half_x2 = exp(-x^2 / 2) is passed in, 
+		as callers also need it for the normal PDF. The packet form is branch-free, selecting the tail by sign. */
+		inline double NormalCDF(double x, double exp_half_x2) {
+			const double a = std::abs(x);
+			const double numerator = ((((((3.52624965998911e-02*a + 0.700383064443688)*a + 6.37396220353165)*a + 33.912866078383)*a
+										+ 112.079291497871)*a + 221.213596169931)*a + 220.206867912376);
+			const double denominator = (((((((8.83883476483184e-02*a + 1.75566716318264)*a + 16.064177579207)*a + 86.7807322029461)*a
+										+ 296.564248779674)*a + 637.333633378831)*a + 793.826512519948)*a + 440.413735824752);
+			const double tail = exp_half_x2 * numerator / denominator; // N(-|x|)
+			return x > 0 ? 1.0 - tail : tail;
+		}
+
+		template <typename Packet>
+		inline Packet PacketNormalCDF(const Packet& x, const Packet& exp_half_x2) {
+			using namespace Eigen::internal;
+			const Packet a = pabs(x);
+			Packet numerator = pset1<Packet>(3.52624965998911e-02);
+			numerator = pmadd(numerator, a, pset1<Packet>(0.700383064443688));
+			numerator = pmadd(numerator, a, pset1<Packet>(6.37396220353165));
+			numerator = pmadd(numerator, a, pset1<Packet>(33.912866078383));
+			numerator = pmadd(numerator, a, pset1<Packet>(112.079291497871));
+			numerator = pmadd(numerator, a, pset1<Packet>(221.213596169931));
+			numerator = pmadd(numerator, a, pset1<Packet>(220.206867912376));
+			Packet denominator = pset1<Packet>(8.83883476483184e-02);
+			denominator = pmadd(denominator, a, pset1<Packet>(1.75566716318264));
+			denominator = pmadd(denominator, a, pset1<Packet>(16.064177579207));
+			denominator = pmadd(denominator, a, pset1<Packet>(86.7807322029461));
+			denominator = pmadd(denominator, a, pset1<Packet>(296.564248779674));
+			denominator = pmadd(denominator, a, pset1<Packet>(637.333633378831));
+			denominator = pmadd(denominator, a, pset1<Packet>(793.826512519948));
+			denominator = pmadd(denominator, a, pset1<Packet>(440.413735824752));
+			const Packet tail = pdiv(pmul(exp_half_x2, numerator), denominator);
+			return pselect(pcmp_lt(pset1<Packet>(0.0), x), psub(pset1<Packet>(1.0), tail), tail);
+		}
+
+		/*
+		Discretely (daily) delta-hedged PnL of one subpath: a call of strike K and maturity T = tau_t0 is sold at its Black
+		Scholes value at sigma, delta hedged at every price of the subpath with the hedge financed at r, and settled against 
+		its payoff at expiry. Rebased by S_t0 (s_ti = S_ti / S_t0, k = K / S_t0) and valued at expiry,
+			PnL = 2 * (C(1, k, T, sigma) * e^(r*T) + sum(N(d1_ti) * (s_ti+1 - s_ti * e^(r*dt)) * e^(r*(T-ti+1))) - max(s_T - k, 0)),
+		where the sum runs over the rebalancing points. The factor 2 puts it on the scale of ContinuousDHPnL, which it 
+		approaches as dt goes to zero. When WithDerivative is true, also returns dPnL/dsigma, from the vega of the call 
+		and dN(d1)/dsigma = -phi(d1) * d2 / sigma.
+		The sum is a single pass over the subpath like ContinuousDHPnL, with the normal CDF from NormalCDF. Since 
+		(s_ti+1 - s_ti * e^(r*dt)) * e^(r*(T-ti+1)) = (s_ti+1 * e^(-r*dt) - s_ti) * e^(r*(T-ti)), the financing factors come
+		from the cached discount weights, e^(r*(T-ti)) = discount_weights_ti * sqrt(2*pi*(T-ti)). */
+		template <bool WithDerivative>
+		inline PnLTerms DailyDHPnL(double sigma, double log_strike, double interest_rate, double dt, const PathTerms& path) {
+			using namespace Eigen::internal;
+			typedef packet_traits<double>::type Packet;
+			const int packet_size = packet_traits<double>::size;
+
+			const double drift = interest_rate + 0.5*sigma*sigma;
+			const double inv_sigma = 1.0 / sigma;
+			const double log_shift = log_strike + path.log_start;
+			const double sqrt_2pi = std::sqrt(2*3.14159265358979323846);
+			const double one_day_discount = std::exp(-interest_rate*dt);
+
+			const Packet p_drift = pset1<Packet>(drift);
+			const Packet p_log_shift = pset1<Packet>(log_shift);
+			const Packet p_inv_sigma = pset1<Packet>(inv_sigma);
+			const Packet p_sigma = pset1<Packet>(sigma);
+			const Packet p_sqrt_2pi = pset1<Packet>(sqrt_2pi);
+			const Packet p_one_day_discount = pset1<Packet>(one_day_discount);
+			const Packet p_minus_half = pset1<Packet>(-0.5);
+			Packet p_hedge = pset1<Packet>(0.0);
+			Packet p_dhedge = pset1<Packet>(0.0);
+			static_assert(packet_size < kPadding, "The padding of the cached terms must cover a packet, and the next price.");
+
+			for (int i = 0; i < path.n; i += packet_size) {
+				const Packet p_sqrt_tau = ploadu<Packet>(path.sqrt_tau + i);
+				Packet d1 = pmul(psub(pmadd(p_drift, ploadu<Packet>(path.tau + i), ploadu<Packet>(path.log_prices + i)), p_log_shift),
+								pmul(ploadu<Packet>(path.inv_sqrt_tau + i), p_inv_sigma));
+				Packet exp_half_d1 = pexp(pmul(p_minus_half, pmul(d1, d1)));
+				Packet growth = pmul(pmul(ploadu<Packet>(path.discount_weights + i), p_sqrt_tau), p_sqrt_2pi);
+				Packet hedge_gain = pmul(psub(pmul(ploadu<Packet>(path.prices + i + 1), p_one_day_discount), ploadu<Packet>(path.prices + i)), growth);
+				p_hedge = pmadd(PacketNormalCDF(d1, exp_half_d1), hedge_gain, p_hedge);
+				if (WithDerivative) {
+					Packet d2 = psub(d1, pmul(p_sigma, p_sqrt_tau));
+					p_dhedge = psub(p_dhedge, pmul(pmul(exp_half_d1, pmul(d2, p_inv_sigma)), hedge_gain));
+				}
+			}
+			double hedge = predux(p_hedge);
+			double dhedge = WithDerivative ? predux(p_dhedge) : 0.0;
+
+			// sale of the call at inception (s_t0 = 1), grown to expiry, and its payoff
+			const double T = path.tau[0];
+			const double growth_T = std::exp(interest_rate*T);
+			const double d1 = (drift*T - log_strike) / (sigma*path.sqrt_tau[0]);
+			const double d2 = d1 - sigma*path.sqrt_tau[0];
+			const double strike = std::exp(log_strike);
+			const double exp_half_d1 = std::exp(-0.5*(d1*d1));
+			const double premium = growth_T * NormalCDF(d1, exp_half_d1) - strike * NormalCDF(d2, std::exp(-0.5*(d2*d2)));
+			const double payoff = std::max(path.prices[path.n] * path.inv_start - strike, 0.0);
+
+			PnLTerms result;
+			result.pnl = 2 * (premium + hedge * path.inv_start - payoff);
+			// the hedge derivative above still lacks the 1 / sqrt(2*pi) of the normal PDF
+			result.dpnl = WithDerivative ? 2 * (growth_T * exp_half_d1 / sqrt_2pi * path.sqrt_tau[0] + dhedge * path.inv_start / sqrt_2pi) : 0.0;
+			return result;
+		}
+
+		// Maximum number of lanes evaluated in one pass by ContinuousDHPnLLanes, larger batches are split into groups of this size
+		const int kMaxLanes = 16;
+
+		/*
+		Lockstep form of the kernel above: evaluates n_lanes (sigma, strike) pairs over the same subpath in one pass, so the 
+		cached terms are streamed from memory once for all lanes rather than once per lane. Writes the PnL (and derivative)
+		of lane l to out[l]. Each lane performs exactly the same operations, in the same order, as ContinuousDHPnL, so the
+		results are identical to n_lanes separate calls. */
+		template <bool WithDerivative, typename Scalar = double, bool FastGamma = false>
+		inline void ContinuousDHPnLLanes(int n_lanes, const double* sigmas, const double* log_strikes, double interest_rate, double dt, const BasicPathTerms<Scalar>& path, PnLTerms* out) {
+			using namespace Eigen::internal;
+			typedef typename packet_traits<Scalar>::type Packet;
+			const int packet_size = packet_traits<Scalar>::size;
+
+			for (int first = 0; first < n_lanes; first += kMaxLanes) {
+				const int lanes = std::min(kMaxLanes, n_lanes - first);
+				Scalar drift[kMaxLanes], log_shift[kMaxLanes], inv_sigma[kMaxLanes], sigma_s[kMaxLanes], sigma2_dt[kMaxLanes], two_sigma_dt[kMaxLanes];
+				Packet p_pnl[kMaxLanes], p_dpnl[kMaxLanes];
+				for (int l = 0; l < lanes; l++) {
+					double sigma = sigmas[first + l];
+					drift[l] = interest_rate + 0.5*sigma*sigma;
+					log_shift[l] = log_strikes[first + l] + path.log_start;
+					inv_sigma[l] = 1.0 / sigma;
+					sigma_s[l] = sigma;
+					sigma2_dt[l] = sigma*sigma*dt;
+					two_sigma_dt[l] = 2*sigma*dt;
+					p_pnl[l] = pset1<Packet>(Scalar(0.0));
+					p_dpnl[l] = pset1<Packet>(Scalar(0.0));
+				}
+				const Packet p_minus_half = pset1<Packet>(Scalar(-0.5));
+				const Packet p_one = pset1<Packet>(Scalar(1.0));
+				static_assert(packet_size <= kPadding, "The padding of the cached terms must cover a packet.");
+
+				for (int i = 0; i < path.n; i += packet_size) {
+					const Packet p_tau = ploadu<Packet>(path.tau + i);
+					const Packet p_log_prices = ploadu<Packet>(path.log_prices + i);
+					const Packet p_inv_sqrt_tau = ploadu<Packet>(path.inv_sqrt_tau + i);
+					const Packet p_weights = pmul(ploadu<Packet>(path.prices + i), ploadu<Packet>(path.discount_weights + i));
+					const Packet p_squared_returns = ploadu<Packet>(path.squared_returns + i);
+					for (int l = 0; l < lanes; l++) {
+						const Packet p_inv_sigma = pset1<Packet>(inv_sigma[l]);
+						Packet d1 = pmul(psub(pmadd(pset1<Packet>(drift[l]), p_tau, p_log_prices), pset1<Packet>(log_shift[l])),
+										pmul(p_inv_sqrt_tau, p_inv_sigma));
+						Packet term = pmul(GaussianExp<FastGamma, Scalar>(pmul(p_minus_half, pmul(d1, d1))), p_weights);
+						Packet hedging_error = psub(pset1<Packet>(sigma2_dt[l]), p_squared_returns);
+						p_pnl[l] = pmadd(term, hedging_error, p_pnl[l]);
+						if (WithDerivative) {
+							Packet d2 = psub(d1, pmul(pset1<Packet>(sigma_s[l]), ploadu<Packet>(path.sqrt_tau + i)));
+							Packet vega = pmul(psub(pmul(d1, d2), p_one), p_inv_sigma);
+							p_dpnl[l] = pmadd(term, pmadd(vega, hedging_error, pset1<Packet>(two_sigma_dt[l])), p_dpnl[l]);
+						}
+					}
+				}
+
+				for (int l = 0; l < lanes; l++) {
+					Scalar pnl = predux(p_pnl[l]);
+					Scalar dpnl = WithDerivative ? predux(p_dpnl[l]) : Scalar(0.0);
+					// the final scaling is made in double, as in ContinuousDHPnL
+					double inv_sigma_l = 1.0 / sigmas[first + l];
+					out[first + l].pnl = (double) pnl * (path.inv_start * inv_sigma_l);
+					out[first + l].dpnl = (double) dpnl * (path.inv_start * inv_sigma_l);
+				}
+			}
+		}
+	}
+}
+
+#endif
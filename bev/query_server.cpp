@@ -0,0 +1,497 @@
+#include "query_server.h"
+#include "csv_loader.h"
+#include "price_cache.h"
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <ostream>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#ifndef _WIN32
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+namespace bev {
+	// A CELL, SKEW or SURFACE query waiting for a solve, see QueryServer::Solve
+	struct QueryServer::Query {
+		bool average_pnls;
+		const std::vector<int>* maturities;
+		const std::vector<double>* strikes;
+		std::vector<double>* bevs; // written by the solving query, maturity-major
+		std::string error; // set instead of bevs when the solve failed
+		bool done = false;
+	};
+
+	/*
+	A loaded series. The BEV object is only used by the query leading the solves (while solving is set) or, between
+	solves, by APPEND, and everything else is guarded by mutex. */
+	struct QueryServer::Ticker {
+		std::mutex mutex;
+		std::condition_variable solved; // signalled when queries are done and when solving is cleared
+		BEV bev;
+		int n_prices = 0;
+		std::map<std::tuple<bool, int, double>, double> results; // (average_pnls, maturity, strike) -> BEV
+		std::vector<Query*> pending;
+		bool solving = false;
+	};
+
+	namespace {
+		bool EndsWith(const std::string& s, const std::string& suffix) {
+			return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+		}
+
+		std::vector<std::string> SplitFields(const std::string& line, char separator = ' ') {
+			std::vector<std::string> fields;
+			size_t start = 0;
+			while (start <= line.size()) {
+				size_t end = separator == ' ' ? line.find_first_of(" \t\r", start) : line.find(separator, start);
+				if (end == std::string::npos)
+					end = line.size();
+				if (end > start)
+					fields.push_back(line.substr(start, end - start));
+				start = end + 1;
+			}
+			return fields;
+		}
+
+		// Parses the whole of field as a number, returning false if it isn't one
+		bool ParseDouble(const std::string& field, double& value) {
+			char* end;
+			errno = 0;
+			value = std::strtod(field.c_str(), &end);
+			return !field.empty() && *end == '\0' && errno == 0 && std::isfinite(value);
+		}
+		bool ParseInt(const std::string& field, int& value) {
+			char* end;
+			errno = 0;
+			long parsed = std::strtol(field.c_str(), &end, 10);
+			value = (int) parsed;
+			return !field.empty() && *end == '\0' && errno == 0 && parsed == value;
+		}
+
+		bool ParseAggregation(const std::string& field, bool& average_pnls) {
+			average_pnls = field == "PNL";
+			return field == "PNL" || field == "BEV";
+		}
+
+		std::string Error(const std::string& message) {
+			return "ERR " + message;
+		}
+
+		std::string Ok(const std::vector<double>& values) {
+			std::string response = "OK";
+			char number[32];
+			for (double value : values) {
+				std::snprintf(number, sizeof(number), " %.17g", value);
+				response += number;
+			}
+			return response;
+		}
+
+		// Whether a request line ends its session (after being answered)
+		bool EndsSession(const std::string& line) {
+			std::vector<std::string> fields = SplitFields(line);
+			return !fields.empty() && (fields[0] == "QUIT" || fields[0] == "SHUTDOWN");
+		}
+	}
+
+	QueryServer::QueryServer(ServerSettings settings) : settings_(std::move(settings)) {}
+
+	std::shared_ptr<QueryServer::Ticker> QueryServer::FindTicker(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = tickers_.find(name);
+		return it == tickers_.end() ? nullptr : it->second;
+	}
+
+	/*
+	A reload replaces the ticker with a new one, so queries already running on the old series finish on it undisturbed. */
+	std::string QueryServer::Load(const std::string& name, const std::string& path, const std::string& col_name) {
+		std::shared_ptr<Ticker> ticker = std::make_shared<Ticker>();
+		BEV& bev = ticker->bev;
+		if (EndsWith(path, ".bevc")) {
+			std::shared_ptr<data_utils::PriceCache> cache = std::make_shared<data_utils::PriceCache>();
+			data_utils::CacheStatus status = cache->Open(path);
+			if (status != data_utils::CacheStatus::Ok)
+				return Error(data_utils::CacheStatusMessage(status));
+			if (!cache->Column(col_name))
+				return Error("column " + col_name + " not found");
+			ticker->n_prices = cache->Rows();
+			bev.SetData(cache, col_name);
+		}
+		else {
+			data_utils::CSVColumns columns;
+			data_utils::CSVStatus status = data_utils::LoadCSVColumns(path, {col_name}, columns);
+			if (status != data_utils::CSVStatus::Ok)
+				return Error(data_utils::CSVStatusMessage(status));
+			ticker->n_prices = columns.values.rows();
+			bev.SetData(std::move(columns.values));
+		}
+		bev.SetInterestRate(settings_.interest_rate);
+		bev.SetRootFinder(settings_.root_finder);
+		bev.SetPrecision(settings_.precision);
+		bev.SetBatchedSolve(settings_.batched_solve);
+		bev.SetThreadCount(settings_.n_threads);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		tickers_[name] = ticker;
+		return "OK " + std::to_string(ticker->n_prices);
+	}
+
+	// Waits for the solves of the ticker to finish, as AppendPrices changes the BEV object they use
+	std::string QueryServer::Append(const std::string& name, const std::vector<double>& prices) {
+		std::shared_ptr<Ticker> ticker = FindTicker(name);
+		if (!ticker)
+			return Error("unknown ticker " + name);
+		std::unique_lock<std::mutex> lock(ticker->mutex);
+		ticker->solved.wait(lock, [&] { return !ticker->solving; });
+		ticker->bev.AppendPrices(Eigen::Map<const Eigen::ArrayXd>(prices.data(), prices.size()));
+		ticker->n_prices += prices.size();
+		ticker->results.clear();
+		return "OK " + std::to_string(ticker->n_prices);
+	}
+
+	/*
+	Cells cached by the server are answered at once. Otherwise the query joins the ticker's pending queries and, unless
+	another query is already solving, leads the solves itself. */
+	std::string QueryServer::Solve(Ticker& ticker, bool average_pnls, const std::vector<int>& maturities, const std::vector<double>& strikes, std::vector<double>& bevs) {
+		std::unique_lock<std::mutex> lock(ticker.mutex);
+		for (int maturity : maturities) {
+			if (maturity < 1 || ticker.n_prices < maturity*21) // checked here rather than asserted by BEV
+				return Error("insufficient data for maturity of " + std::to_string(maturity) + " months");
+		}
+		for (double strike : strikes) {
+			if (!(strike > 0))
+				return Error("strikes must be positive");
+		}
+
+		bevs.resize(maturities.size() * strikes.size());
+		bool cached = true;
+		for (size_t row = 0; row < maturities.size() && cached; row++) {
+			for (size_t col = 0; col < strikes.size() && cached; col++) {
+				auto it = ticker.results.find(std::make_tuple(average_pnls, maturities[row], strikes[col]));
+				cached = it != ticker.results.end();
+				if (cached)
+					bevs[row*strikes.size() + col] = it->second;
+			}
+		}
+		cells_ += bevs.size();
+		if (cached) {
+			cached_cells_ += bevs.size();
+			return "";
+		}
+
+		Query query{average_pnls, &maturities, &strikes, &bevs, {}, false};
+		ticker.pending.push_back(&query);
+		if (ticker.solving) {
+			batched_queries_++;
+			ticker.solved.wait(lock, [&] { return query.done; });
+		}
+		else
+			SolvePending(ticker, lock);
+		return query.error;
+	}
+
+	/*
+	Each round takes every pending query and solves the union of their maturities and strikes (see SolveBatch), without
+	holding the lock, so queries arriving meanwhile queue up for the next round. A round that throws (e.g. bad_alloc)
+	answers its queries with the error, and solving is cleared however the rounds end, so no query or APPEND is left
+	waiting on the ticker. */
+	void QueryServer::SolvePending(Ticker& ticker, std::unique_lock<std::mutex>& lock) {
+		ticker.solving = true;
+		while (!ticker.pending.empty()) {
+			std::vector<Query*> batch;
+			batch.swap(ticker.pending);
+			std::string error;
+			try {
+				SolveBatch(ticker, batch, lock);
+			}
+			catch (const std::exception& exception) {
+				error = Error(std::string("solve failed: ") + exception.what());
+			}
+			catch (...) {
+				error = Error("solve failed");
+			}
+			if (!lock.owns_lock()) // thrown while solving
+				lock.lock();
+			for (Query* query : batch) {
+				query->error = error;
+				query->done = true;
+			}
+			ticker.solved.notify_all();
+		}
+		ticker.solving = false;
+		ticker.solved.notify_all();
+	}
+
+	/*
+	Solves once for each aggregation method asked for. The BEV object only solves the cells it hasn't solved before, and
+	the whole grid is kept for later queries. */
+	void QueryServer::SolveBatch(Ticker& ticker, const std::vector<Query*>& batch, std::unique_lock<std::mutex>& lock) {
+		for (bool average_pnls : {true, false}) {
+			std::set<int> maturity_set;
+			std::set<double> strike_set;
+			for (const Query* query : batch) {
+				if (query->average_pnls != average_pnls)
+					continue;
+				maturity_set.insert(query->maturities->begin(), query->maturities->end());
+				strike_set.insert(query->strikes->begin(), query->strikes->end());
+			}
+			if (maturity_set.empty())
+				continue;
+			std::vector<int> maturities(maturity_set.begin(), maturity_set.end());
+			std::vector<double> strikes(strike_set.begin(), strike_set.end());
+
+			lock.unlock();
+			ticker.bev.SetMaturities(maturities);
+			ticker.bev.SetStrikes(strikes);
+			Eigen::ArrayXXd surface = ticker.bev.SolveForBEV(average_pnls);
+			solves_++;
+			lock.lock();
+			for (size_t row = 0; row < maturities.size(); row++) {
+				for (size_t col = 0; col < strikes.size(); col++)
+					ticker.results[std::make_tuple(average_pnls, maturities[row], strikes[col])] = surface(row, col);
+			}
+		}
+		for (Query* query : batch) {
+			for (size_t row = 0; row < query->maturities->size(); row++) {
+				for (size_t col = 0; col < query->strikes->size(); col++) {
+					auto key = std::make_tuple(query->average_pnls, (*query->maturities)[row], (*query->strikes)[col]);
+					(*query->bevs)[row*query->strikes->size() + col] = ticker.results.at(key);
+				}
+			}
+		}
+	}
+
+	std::string QueryServer::Handle(const std::string& request) {
+		requests_++;
+		std::vector<std::string> fields = SplitFields(request);
+		if (fields.empty())
+			return Error("empty request");
+		const std::string& command = fields[0];
+
+		if (command == "LOAD") {
+			if (fields.size() < 3 || fields.size() > 4)
+				return Error("usage: LOAD <ticker> <path> [column]");
+			return Load(fields[1], fields[2], fields.size() > 3 ? fields[3] : settings_.col_name);
+		}
+		if (command == "APPEND") {
+			if (fields.size() < 3)
+				return Error("usage: APPEND <ticker> <price> [<price> ...]");
+			std::vector<double> prices(fields.size() - 2);
+			for (size_t k = 2; k < fields.size(); k++) {
+				if (!ParseDouble(fields[k], prices[k - 2]) || !(prices[k - 2] > 0))
+					return Error("invalid price " + fields[k]);
+			}
+			return Append(fields[1], prices);
+		}
+		if (command == "CELL" || command == "SKEW" || command == "SURFACE") {
+			bool average_pnls;
+			std::vector<std::string> maturity_fields, strike_fields;
+			if (command == "CELL" && fields.size() == 5) {
+				maturity_fields = {fields[3]};
+				strike_fields = {fields[4]};
+			} else if (command == "SKEW" && fields.size() >= 5) {
+				maturity_fields = {fields[3]};
+				strike_fields.assign(fields.begin() + 4, fields.end());
+			} else if (command == "SURFACE" && fields.size() == 5) {
+				maturity_fields = SplitFields(fields[3], ',');
+				strike_fields = SplitFields(fields[4], ',');
+			} else
+				return Error("wrong number of fields for " + command);
+			if (!ParseAggregation(fields[2], average_pnls))
+				return Error("aggregation must be PNL or BEV");
+			std::vector<int> maturities(maturity_fields.size());
+			std::vector<double> strikes(strike_fields.size());
+			for (size_t k = 0; k < maturities.size(); k++) {
+				if (!ParseInt(maturity_fields[k], maturities[k]))
+					return Error("invalid maturity " + maturity_fields[k]);
+			}
+			for (size_t k = 0; k < strikes.size(); k++) {
+				if (!ParseDouble(strike_fields[k], strikes[k]))
+					return Error("invalid strike " + strike_fields[k]);
+			}
+			if (maturities.empty() || strikes.empty())
+				return Error("no maturities or strikes");
+
+			std::shared_ptr<Ticker> ticker = FindTicker(fields[1]);
+			if (!ticker)
+				return Error("unknown ticker " + fields[1]);
+			std::vector<double> bevs;
+			std::string error = Solve(*ticker, average_pnls, maturities, strikes, bevs);
+			return error.empty() ? Ok(bevs) : error;
+		}
+		if (command == "DROP") {
+			if (fields.size() != 2)
+				return Error("usage: DROP <ticker>");
+			std::lock_guard<std::mutex> lock(mutex_);
+			return tickers_.erase(fields[1]) ? "OK" : Error("unknown ticker " + fields[1]);
+		}
+		if (command == "STATS") {
+			ServerStats stats = Stats();
+			return "OK requests=" + std::to_string(stats.requests) + " cells=" + std::to_string(stats.cells) + " cached_cells="
+				+ std::to_string(stats.cached_cells) + " solves=" + std::to_string(stats.solves) + " batched_queries=" + std::to_string(stats.batched_queries);
+		}
+		if (command == "QUIT")
+			return "OK";
+		if (command == "SHUTDOWN") {
+			Stop();
+			return "OK";
+		}
+		return Error("unknown command " + command);
+	}
+
+	void QueryServer::ServeStream(std::istream& in, std::ostream& out) {
+		std::string line;
+		while (std::getline(in, line)) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos)
+				continue;
+			out << Handle(line) << '\n' << std::flush;
+			if (EndsSession(line))
+				break;
+		}
+	}
+
+#ifdef _WIN32
+	bool QueryServer::ServeUnixSocket(const std::string&, std::string* error) {
+		if (error)
+			*error = "Unix domain sockets are not supported on this platform";
+		return false;
+	}
+#else
+	namespace {
+		// Writes all of data to fd, returning false if the connection was closed
+		bool WriteAll(int fd, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+			const int flags = MSG_NOSIGNAL; // a client closing early mustn't kill the server with SIGPIPE
+#else
+			const int flags = 0;
+#endif
+			size_t written = 0;
+			while (written < data.size()) {
+				ssize_t n = send(fd, data.data() + written, data.size() - written, flags);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return false;
+				written += n;
+			}
+			return true;
+		}
+
+		// Answers the requests of one connection line by line until it ends its session or closes
+		void ServeConnection(QueryServer& server, int fd) {
+			std::string buffer;
+			char data[4096];
+			while (true) {
+				ssize_t n = read(fd, data, sizeof(data));
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return;
+				buffer.append(data, n);
+				size_t start = 0, end;
+				while ((end = buffer.find('\n', start)) != std::string::npos) {
+					std::string line = buffer.substr(start, end - start);
+					start = end + 1;
+					if (line.find_first_not_of(" \t\r") == std::string::npos)
+						continue;
+					if (!WriteAll(fd, server.Handle(line) + '\n') || EndsSession(line))
+						return;
+				}
+				buffer.erase(0, start);
+			}
+		}
+
+		// A connection served on a thread of its own
+		struct Connection {
+			int fd;
+			std::thread thread;
+			std::shared_ptr<std::atomic<bool>> finished;
+		};
+	}
+
+	/*
+	The listener is polled so that a SHUTDOWN or Stop is noticed within a tenth of a second. Once stopping, the open
+	connections are shut down (unblocking their reads) and their threads joined. */
+	bool QueryServer::ServeUnixSocket(const std::string& socket_path, std::string* error) {
+		auto Fail = [&] (const std::string& message) {
+			if (error)
+				*error = message;
+			return false;
+		};
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path))
+			return Fail("invalid socket path " + socket_path);
+		std::strcpy(address.sun_path, socket_path.c_str());
+
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0)
+			return Fail(std::string("socket: ") + std::strerror(errno));
+		unlink(socket_path.c_str());
+		if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0) {
+			std::string message = std::string("bind/listen: ") + std::strerror(errno);
+			close(listener);
+			return Fail(message);
+		}
+
+		std::mutex connections_mutex;
+		std::vector<Connection> connections;
+		auto JoinFinished = [&] (bool all) {
+			std::lock_guard<std::mutex> lock(connections_mutex);
+			for (auto it = connections.begin(); it != connections.end(); ) {
+				if (all)
+					shutdown(it->fd, SHUT_RDWR);
+				if (all || *it->finished) {
+					it->thread.join();
+					close(it->fd);
+					it = connections.erase(it);
+				}
+				else
+					++it;
+			}
+		};
+		while (!stopping_) {
+			pollfd listening = {listener, POLLIN, 0};
+			int ready = poll(&listening, 1, 100);
+			JoinFinished(false);
+			if (ready <= 0)
+				continue;
+			int fd = accept(listener, nullptr, nullptr);
+			if (fd < 0)
+				continue;
+			std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+			std::lock_guard<std::mutex> lock(connections_mutex);
+			connections.push_back(Connection{fd, std::thread([this, fd, finished] {
+				ServeConnection(*this, fd);
+				*finished = true;
+			}), finished});
+		}
+		close(listener);
+		unlink(socket_path.c_str());
+		JoinFinished(true);
+		return true;
+	}
+#endif
+
+	ServerStats QueryServer::Stats() const {
+		ServerStats stats;
+		stats.requests = requests_;
+		stats.cells = cells_;
+		stats.cached_cells = cached_cells_;
+		stats.solves = solves_;
+		stats.batched_queries = batched_queries_;
+		return stats;
+	}
+}
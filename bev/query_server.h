@@ -0,0 +1,101 @@
+#ifndef BEV_QUERY_SERVER_H
+#define BEV_QUERY_SERVER_H
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bev.h"
+
+namespace bev {
+	/*
+	Resident server answering BEV queries on loaded price series, for tools that would otherwise start a process, re-read
+	the CSV, rebuild the BEV object and re-solve for every query. Each series (ticker) is loaded once and kept with its
+	BEV object, whose cached PnL terms and results serve all later queries, and every cell solved is also kept by the
+	server, so a repeated query is a lookup. Concurrent queries for the same ticker are batched: the first query to find
+	cells missing solves the union of the cells missing from all queries waiting at that point with a single SolveForBEV
+	(and again for any queries arriving meanwhile), while the others wait for its results. Tickers are solved independently.
+
+	Protocol: one request per line, fields separated by spaces, one response line per request, starting with OK or ERR.
+		LOAD <ticker> <path> [column]					loads (or reloads) a CSV or ".bevc" price cache (see price_cache.h)
+														column, by default the settings' col_name		-> OK <number of prices>
+		APPEND <ticker> <price> [<price> ...]			appends prices, see BEV::AppendPrices			-> OK <number of prices>
+		CELL <ticker> <PNL|BEV> <maturity> <strike>		BEV of one cell									-> OK <bev>
+		SKEW <ticker> <PNL|BEV> <maturity> <strike> [<strike> ...]										-> OK <bev> ...
+		SURFACE <ticker> <PNL|BEV> <maturity>[,<maturity> ...] <strike>[,<strike> ...]					-> OK <bev> ...
+														BEVs row by row (maturity-major), as the rows of SolveForBEV
+		DROP <ticker>									unloads a ticker								-> OK
+		STATS											counters, see ServerStats						-> OK requests=<n> ...
+		QUIT											ends the session (the stream or socket connection)
+		SHUTDOWN										ends the session and stops ServeUnixSocket
+	PNL zeroes the average PnL of the subpaths and BEV averages the subpath BEVs (average_pnls true and false in
+	SolveForBEV). Maturities are in months and strikes in relative terms, as for BEV. BEVs are written with 17
+	significant digits (nan where no root was found), and errors as ERR followed by a message.
+	USAGE:	QueryServer server;
+			server.Handle("LOAD GOOG GOOG.csv");				// "OK 1258"
+			server.Handle("CELL GOOG PNL 3 1.05");				// "OK 0.2661..."
+			server.ServeStream(std::cin, std::cout);			// or server.ServeUnixSocket("/tmp/bev.sock")
+			Handle may be called from any number of threads. */
+
+	struct ServerSettings {
+		double interest_rate = 0.015;
+		RootFinder root_finder = RootFinder::Secant;
+		Precision precision = Precision::Double; // see BEV::SetPrecision
+		bool batched_solve = true; // see BEV::SetBatchedSolve, suits the union of cells a batch of queries solves
+		int n_threads = 1; // threads of each ticker's solves, see BEV::SetThreadCount
+		std::string col_name = "Close"; // column of the CSVs/price caches holding the prices, unless LOAD names another
+	};
+
+	struct ServerStats {
+		long long requests = 0; // request lines handled, including those failing
+		long long cells = 0; // cells returned by CELL, SKEW and SURFACE queries
+		long long cached_cells = 0; // of which were answered from the server's results without waiting for a solve
+		long long solves = 0; // SolveForBEV calls made
+		long long batched_queries = 0; // queries whose missing cells were solved by a solve led by another query
+	};
+
+	class QueryServer {
+		struct Query;
+		struct Ticker;
+
+		ServerSettings settings_;
+		std::mutex mutex_; // guards tickers_
+		std::map<std::string, std::shared_ptr<Ticker>> tickers_;
+		std::atomic<bool> stopping_{false};
+		std::atomic<long long> requests_{0}, cells_{0}, cached_cells_{0}, solves_{0}, batched_queries_{0};
+
+		std::shared_ptr<Ticker> FindTicker(const std::string& name);
+		std::string Load(const std::string& name, const std::string& path, const std::string& col_name);
+		std::string Append(const std::string& name, const std::vector<double>& prices);
+		// BEVs of the grid of maturities x strikes (maturity-major) into bevs, solving the cells not yet cached, or an error message
+		std::string Solve(Ticker& ticker, bool average_pnls, const std::vector<int>& maturities, const std::vector<double>& strikes, std::vector<double>& bevs);
+		// Solves the queries waiting on ticker, and those arriving meanwhile, until none are left. Called with lock held.
+		void SolvePending(Ticker& ticker, std::unique_lock<std::mutex>& lock);
+		// Solves the cells of a batch of queries and writes their BEVs, releasing lock while solving. Called with lock held.
+		void SolveBatch(Ticker& ticker, const std::vector<Query*>& batch, std::unique_lock<std::mutex>& lock);
+
+	public:
+		explicit QueryServer(ServerSettings settings = ServerSettings());
+		QueryServer(const QueryServer&) = delete;
+		QueryServer& operator=(const QueryServer&) = delete;
+
+		// Response line (without the newline) to one request line, see the protocol above. Thread-safe.
+		std::string Handle(const std::string& request);
+		// Answers the requests read line by line from in on out, flushing after each, until QUIT, SHUTDOWN or the end of in
+		void ServeStream(std::istream& in, std::ostream& out);
+		/*
+		Listens on a Unix domain socket at socket_path (replacing any file there) and serves each connection as
+		ServeStream does, on a thread of its own, until a client sends SHUTDOWN or Stop is called. Returns false, with
+		the reason in error, if the socket could not be set up, or on platforms without Unix domain sockets. */
+		bool ServeUnixSocket(const std::string& socket_path, std::string* error = nullptr);
+		// Makes ServeUnixSocket return (within a tenth of a second), closing the connections still open
+		void Stop() { stopping_ = true; }
+
+		ServerStats Stats() const;
+	};
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef BEV_ALLOCATION_COUNTER_H
+#define BEV_ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace bev_utils
+{
+	/*
+	Process-wide count of heap allocations, for benchmarks and checks asserting that a code path (e.g. a steady-state
+	surface solve, see Workspace) doesn't allocate. The counts only move once counting is installed, by defining
+	BEV_COUNT_ALLOCATIONS in exactly one source file of the program before including this header. That file then
+	replaces malloc/calloc/realloc on glibc, which catches Eigen's allocations as well as operator new, and elsewhere
+	operator new only (so Eigen's allocations are missed). Libraries never install it themselves.
+	USAGE:	AllocationCounts before = HeapAllocations();
+			...
+			long n_allocations = (HeapAllocations() - before).allocations; 
+			On glibc, the bytes in use are tracked as well (see LiveHeapBytes), for measuring the memory a code path holds. */
+	struct AllocationCounts {
+		unsigned long long allocations = 0;
+		unsigned long long bytes = 0;
+		AllocationCounts operator-(const AllocationCounts& other) const {
+			AllocationCounts difference;
+			difference.allocations = allocations - other.allocations;
+			difference.bytes = bytes - other.bytes;
+			return difference;
+		}
+	};
+
+	namespace detail
+	{
+		inline std::atomic<unsigned long long>* AllocationCounters() {
+			static std::atomic<unsigned long long> counters[2] = {{0}, {0}}; // allocations, bytes
+			return counters;
+		}
+		inline std::atomic<long long>* LiveHeapCounters() {
+			static std::atomic<long long> counters[2] = {{0}, {0}}; // bytes in use, peak bytes in use
+			return counters;
+		}
+		inline std::atomic<bool>& AllocationCountingInstalled() {
+			static std::atomic<bool> installed(false);
+			return installed;
+		}
+	}
+
+	// The hook called by the installed allocation functions for every allocation of size bytes
+	inline void CountAllocation(size_t size) {
+		detail::AllocationCounters()[0].fetch_add(1, std::memory_order_relaxed);
+		detail::AllocationCounters()[1].fetch_add(size, std::memory_order_relaxed);
+	}
+
+	// The hook called by the installed allocation functions when size (usable) bytes are taken (size > 0) or released (size < 0)
+	inline void CountLiveBytes(long long size) {
+		long long live = detail::LiveHeapCounters()[0].fetch_add(size, std::memory_order_relaxed) + size;
+		long long peak = detail::LiveHeapCounters()[1].load(std::memory_order_relaxed);
+		while (live > peak && !detail::LiveHeapCounters()[1].compare_exchange_weak(peak, live, std::memory_order_relaxed));
+	}
+
+	// Allocations counted since the program started, all zero when counting isn't installed
+	inline AllocationCounts HeapAllocations() {
+		AllocationCounts counts;
+		counts.allocations = detail::AllocationCounters()[0].load(std::memory_order_relaxed);
+		counts.bytes = detail::AllocationCounters()[1].load(std::memory_order_relaxed);
+		return counts;
+	}
+
+	/*
+	Heap bytes in use, and the most in use at once since the last ResetPeakHeapBytes (or the start of the program), both 
+	counted in usable sizes (slightly more than requested). Only tracked on glibc, zero elsewhere.
+	USAGE:	ResetPeakHeapBytes();
+			long long before = LiveHeapBytes();
+			...
+			long long held = PeakHeapBytes() - before; */
+	inline long long LiveHeapBytes() { return detail::LiveHeapCounters()[0].load(std::memory_order_relaxed); }
+	inline long long PeakHeapBytes() { return detail::LiveHeapCounters()[1].load(std::memory_order_relaxed); }
+	inline void ResetPeakHeapBytes() { detail::LiveHeapCounters()[1].store(LiveHeapBytes(), std::memory_order_relaxed); }
+
+	// Whether BEV_COUNT_ALLOCATIONS installed counting in this program
+	inline bool AllocationCountingEnabled() { return detail::AllocationCountingInstalled().load(); }
+}
+
+#ifdef BEV_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace bev_utils
+{
+	namespace detail
+	{
+		// Marks counting as installed before main runs
+		struct AllocationCountingInstaller {
+			AllocationCountingInstaller() { AllocationCountingInstalled().store(true); };
+		};
+		static AllocationCountingInstaller allocation_counting_installer;
+	}
+}
+
+#if defined(__GLIBC__)
+#include <cerrno>
+#include <malloc.h>
+
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* ptr);
+
+	void* malloc(size_t size) {
+		bev_utils::CountAllocation(size);
+		void* ptr = __libc_malloc(size);
+		bev_utils::CountLiveBytes(malloc_usable_size(ptr));
+		return ptr;
+	}
+	void* calloc(size_t n, size_t size) {
+		bev_utils::CountAllocation(n * size);
+		void* ptr = __libc_calloc(n, size);
+		bev_utils::CountLiveBytes(malloc_usable_size(ptr));
+		return ptr;
+	}
+	void* realloc(void* ptr, size_t size) {
+		bev_utils::CountAllocation(size);
+		long long old_size = malloc_usable_size(ptr);
+		void* new_ptr = __libc_realloc(ptr, size);
+		if (new_ptr || size == 0) // a failed realloc keeps the old block
+			bev_utils::CountLiveBytes((long long) malloc_usable_size(new_ptr) - old_size);
+		return new_ptr;
+	}
+	// the aligned allocations are replaced too, as the blocks they return are released through free
+	void* memalign(size_t alignment, size_t size) {
+		bev_utils::CountAllocation(size);
+		void* ptr = __libc_memalign(alignment, size);
+		bev_utils::CountLiveBytes(malloc_usable_size(ptr));
+		return ptr;
+	}
+	void* aligned_alloc(size_t alignment, size_t size) {
+		return memalign(alignment, size);
+	}
+	int posix_memalign(void** ptr, size_t alignment, size_t size) {
+		if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+			return EINVAL;
+		void* block = memalign(alignment, size);
+		if (!block)
+			return ENOMEM;
+		*ptr = block;
+		return 0;
+	}
+	void free(void* ptr) {
+		bev_utils::CountLiveBytes(-(long long) malloc_usable_size(ptr));
+		__libc_free(ptr);
+	}
+}
+#else
+void* operator new(size_t size) {
+	bev_utils::CountAllocation(size);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
+#endif
+
+#endif
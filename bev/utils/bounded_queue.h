@@ -0,0 +1,61 @@
+#ifndef BEV_BOUNDED_QUEUE_H
+#define BEV_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace thread_utils
+{
+	/*
+	Blocking first-in first-out queue of bounded capacity, linking the stages of a pipeline (e.g. loading and solving
+	in bev::SolveBatch). Push blocks while the queue is full, so a fast producer can't run ahead of its consumers by 
+	more than the capacity, which bounds the memory held by items in flight.
+	USAGE:	Producers Push items and the last producer to finish calls Close. Consumers Pop until it returns false. */
+	template <typename T>
+	class BoundedQueue {
+		std::mutex mutex_;
+		std::condition_variable not_full_;
+		std::condition_variable not_empty_;
+		std::deque<T> items_;
+		size_t capacity_;
+		bool closed_ = false;
+
+	public:
+		explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {};
+
+		// Waits for space and adds item. Returns false (dropping item) if the queue has been closed.
+		bool Push(T item) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+			if (closed_)
+				return false;
+			items_.push_back(std::move(item));
+			not_empty_.notify_one();
+			return true;
+		}
+
+		// Waits for an item and moves it into item. Returns false once the queue is closed and empty.
+		bool Pop(T& item) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+			if (items_.empty())
+				return false;
+			item = std::move(items_.front());
+			items_.pop_front();
+			not_full_.notify_one();
+			return true;
+		}
+
+		// No more items will be pushed: wakes every waiting consumer once the remaining items are taken.
+		void Close() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+			not_empty_.notify_all();
+			not_full_.notify_all();
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include "csv_loader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <Eigen/Dense>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+namespace data_utils
+{
+	namespace {
+		// End of the line starting at p, excluding the \n (or \r\n)
+		const char* LineEnd(const char* p, const char* end, const char*& next_line) {
+			const char* eol = (const char*) std::memchr(p, '\n', end - p);
+			next_line = eol ? eol + 1 : end;
+			if (!eol)
+				eol = end;
+			if (eol > p && eol[-1] == '\r')
+				eol--;
+			return eol;
+		}
+
+		// Splits a header line into its trimmed column names
+		std::vector<std::string> SplitHeader(const char* p, const char* line_end) {
+			std::vector<std::string> names;
+			while (true) {
+				const char* comma = (const char*) std::memchr(p, ',', line_end - p);
+				const char* field_end = comma ? comma : line_end;
+				const char* first = p;
+				const char* last = field_end;
+				while (first < last && (*first == ' ' || *first == '\t'))
+					first++;
+				while (last > first && (last[-1] == ' ' || last[-1] == '\t'))
+					last--;
+				names.push_back(std::string(first, last));
+				if (!comma)
+					return names;
+				p = comma + 1;
+			}
+		}
+
+		// Values parsed from one chunk of data lines, row by row
+		struct Chunk {
+			std::vector<double> values;
+			std::vector<int32_t> dates;
+			int n_rows = 0;
+			int n_lines = 0; // lines read, including blank lines
+			int error_line = 0; // line within the chunk (1-based) of the first parse error, 0 if none
+		};
+
+		/*
+		Parses the data lines in [p, end). field_slots[f] lists the output columns taken from field f of each line, and
+		n_fields is the number of distinct fields requested. Slot n_cols stands for the date column. Stops at the first line with a missing or invalid field. */
+		void ParseChunk(const char* p, const char* end, const std::vector<std::vector<int>>& field_slots, int n_fields, int n_cols, Chunk& chunk) {
+			const int n_field_slots = field_slots.size();
+			while (p < end) {
+				const char* next_line;
+				const char* line_end = LineEnd(p, end, next_line);
+				chunk.n_lines++;
+				if (line_end == p) { // blank line
+					p = next_line;
+					continue;
+				}
+				size_t row = chunk.values.size();
+				chunk.values.resize(row + n_cols);
+				int field = 0, found = 0;
+				while (found < n_fields && field < n_field_slots) {
+					const char* comma = (const char*) std::memchr(p, ',', line_end - p);
+					const char* field_end = comma ? comma : line_end;
+					if (!field_slots[field].empty()) {
+						double value = 0;
+						int32_t date = 0;
+						bool is_date = field_slots[field].back() == n_cols;
+						const char* q = is_date ? ParseDate(p, field_end, date) : ParseDouble(p, field_end, value);
+						while (q && q < field_end && (*q == ' ' || *q == '\t'))
+							q++;
+						if (q != field_end) {
+							chunk.error_line = chunk.n_lines;
+							return;
+						}
+						for (int slot : field_slots[field]) {
+							if (slot == n_cols)
+								chunk.dates.push_back(date);
+							else
+								chunk.values[row + slot] = value;
+						}
+						found++;
+					}
+					if (!comma)
+						break;
+					p = comma + 1;
+					field++;
+				}
+				if (found < n_fields) {
+					chunk.error_line = chunk.n_lines;
+					return;
+				}
+				chunk.n_rows++;
+				p = next_line;
+			}
+		}
+
+		/*
+		Reads columns col_nos, and the dates of column date_col unless it is -1, from the data lines [data, end) of file, 
+		first_line being the number of lines before data. The data lines are split into n_threads chunks at line boundaries
+		and parsed concurrently. */
+		CSVStatus ReadColumns(const char* data, const char* end, int first_line, const std::vector<int>& col_nos, int date_col, CSVColumns& columns, int n_threads) {
+			int n_cols = col_nos.size();
+			int max_col = std::max(date_col, col_nos.empty() ? -1 : *std::max_element(col_nos.begin(), col_nos.end()));
+			std::vector<std::vector<int>> field_slots(max_col + 1);
+			for (int k = 0; k < n_cols; k++)
+				field_slots[col_nos[k]].push_back(k);
+			if (date_col >= 0) {
+				if (!field_slots[date_col].empty())
+					return CSVStatus::ParseError; // a column can't be read both as numbers and as dates
+				field_slots[date_col].push_back(n_cols);
+			}
+			int n_fields = 0;
+			for (const std::vector<int>& slots : field_slots)
+				n_fields += !slots.empty();
+
+			// chunk boundaries, each moved forward to the start of the next line
+			size_t size = end - data;
+			int n_chunks = std::max(1, (int) std::min<size_t>(n_threads, size / 4096 + 1));
+			std::vector<const char*> bounds(n_chunks + 1, end);
+			bounds[0] = data;
+			for (int i = 1; i < n_chunks; i++) {
+				const char* p = std::max(data + size * i / n_chunks, bounds[i-1]);
+				const char* eol = (const char*) std::memchr(p, '\n', end - p);
+				bounds[i] = eol ? eol + 1 : end;
+			}
+
+			std::vector<Chunk> chunks(n_chunks);
+			auto ParseOne = [&] (int i) {
+				ParseChunk(bounds[i], bounds[i+1], field_slots, n_fields, n_cols, chunks[i]);
+			};
+			if (n_chunks > 1) {
+				thread_utils::ThreadPool pool(n_chunks);
+				pool.ParallelFor(n_chunks, ParseOne);
+			} else
+				ParseOne(0);
+
+			int n_rows = 0, line = first_line;
+			for (const Chunk& chunk : chunks) {
+				if (chunk.error_line) {
+					columns.error_line = line + chunk.error_line;
+					return CSVStatus::ParseError;
+				}
+				n_rows += chunk.n_rows;
+				line += chunk.n_lines;
+			}
+
+			columns.values.resize(n_rows, n_cols);
+			columns.dates.clear();
+			int row = 0;
+			for (const Chunk& chunk : chunks) {
+				columns.dates.insert(columns.dates.end(), chunk.dates.begin(), chunk.dates.end());
+				columns.values.middleRows(row, chunk.n_rows) = Eigen::Map<const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(chunk.values.data(), chunk.n_rows, n_cols);
+				row += chunk.n_rows;
+			}
+			return CSVStatus::Ok;
+		}
+	}
+
+	const char* CSVStatusMessage(CSVStatus status) {
+		switch (status) {
+			case CSVStatus::Ok: return "ok";
+			case CSVStatus::OpenFailed: return "file could not be opened";
+			case CSVStatus::EmptyFile: return "file is empty";
+			case CSVStatus::ColumnNotFound: return "column not found";
+			case CSVStatus::ParseError: return "invalid or missing value";
+		}
+		return "unknown status";
+	}
+
+	CSVStatus ReadCSVHeader(const std::string& csv_path, std::vector<std::string>& col_names) {
+		MappedFile file;
+		if (!file.Open(csv_path))
+			return CSVStatus::OpenFailed;
+		if (file.Size() == 0)
+			return CSVStatus::EmptyFile;
+		const char* data;
+		col_names = SplitHeader(file.Data(), LineEnd(file.Data(), file.Data() + file.Size(), data));
+		return CSVStatus::Ok;
+	}
+
+	CSVStatus LoadCSVColumns(const std::string& csv_path, const std::vector<std::string>& col_names, CSVColumns& columns, int n_threads, const std::string& date_col_name) {
+		MappedFile file;
+		if (!file.Open(csv_path))
+			return CSVStatus::OpenFailed;
+		const char* end = file.Data() + file.Size();
+		if (file.Size() == 0)
+			return CSVStatus::EmptyFile;
+
+		const char* data;
+		std::vector<std::string> header = SplitHeader(file.Data(), LineEnd(file.Data(), end, data));
+		std::vector<int> col_nos;
+		for (const std::string& name : col_names) {
+			auto it = std::find(header.begin(), header.end(), name);
+			if (it == header.end())
+				return CSVStatus::ColumnNotFound;
+			col_nos.push_back(it - header.begin());
+		}
+		int date_col = -1;
+		if (!date_col_name.empty()) {
+			auto it = std::find(header.begin(), header.end(), date_col_name);
+			if (it == header.end())
+				return CSVStatus::ColumnNotFound;
+			date_col = it - header.begin();
+		}
+		columns.names = col_names;
+		return ReadColumns(data, end, 1, col_nos, date_col, columns, n_threads);
+	}
+
+	CSVStatus LoadCSVColumns(const std::string& csv_path, const std::vector<int>& col_nos, bool header, CSVColumns& columns, int n_threads) {
+		MappedFile file;
+		if (!file.Open(csv_path))
+			return CSVStatus::OpenFailed;
+		const char* end = file.Data() + file.Size();
+		if (file.Size() == 0)
+			return CSVStatus::EmptyFile;
+
+		const char* data = file.Data();
+		columns.names.clear();
+		if (header) {
+			std::vector<std::string> names = SplitHeader(file.Data(), LineEnd(file.Data(), end, data));
+			for (int col : col_nos) {
+				if (col < 0 || col >= (int) names.size())
+					return CSVStatus::ColumnNotFound;
+				columns.names.push_back(names[col]);
+			}
+		} else {
+			for (int col : col_nos) {
+				if (col < 0)
+					return CSVStatus::ColumnNotFound;
+				columns.names.push_back(std::to_string(col));
+			}
+		}
+		return ReadColumns(data, end, header ? 1 : 0, col_nos, -1, columns, n_threads);
+	}
+
+	const char* ParseDouble(const char* begin, const char* end, double& value) {
+		// powers of ten exactly representable as doubles
+		static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+		const char* p = begin;
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		const char* start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int n_digits = 0, exponent = 0;
+		bool any_digits = false;
+		for (; p < end && *p >= '0' && *p <= '9'; p++) {
+			any_digits = true;
+			if (n_digits < 19) {
+				mantissa = mantissa*10 + (*p - '0');
+				n_digits += mantissa != 0; // leading zeros are not significant
+			} else {
+				n_digits++;
+				exponent++;
+			}
+		}
+		if (p < end && *p == '.') {
+			p++;
+			for (; p < end && *p >= '0' && *p <= '9'; p++) {
+				any_digits = true;
+				if (n_digits < 19) {
+					mantissa = mantissa*10 + (*p - '0');
+					n_digits += mantissa != 0;
+					exponent--;
+				} else
+					n_digits++;
+			}
+		}
+		if (!any_digits)
+			return nullptr;
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			const char* q = p + 1;
+			bool negative_exponent = false;
+			if (q < end && (*q == '-' || *q == '+')) {
+				negative_exponent = *q == '-';
+				q++;
+			}
+			if (q < end && *q >= '0' && *q <= '9') { // otherwise the 'e' is not part of the number
+				int e = 0;
+				for (; q < end && *q >= '0' && *q <= '9'; q++)
+					e = std::min(e*10 + (*q - '0'), 100000);
+				exponent += negative_exponent ? -e : e;
+				p = q;
+			}
+		}
+
+		if (n_digits < 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+			value = (double) mantissa;
+			value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+			if (negative)
+				value = -value;
+			return p;
+		}
+
+		// slow path, correctly rounded by the C library
+		std::string text(start, p);
+		value = std::strtod(text.c_str(), nullptr);
+		return p;
+	}
+
+	const char* ParseDate(const char* begin, const char* end, int32_t& date) {
+		const char* p = begin;
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		// reads n digits into value
+		auto Digits = [&p, end] (int n, int& value) {
+			value = 0;
+			for (int i = 0; i < n; i++, p++) {
+				if (p >= end || *p < '0' || *p > '9')
+					return false;
+				value = value*10 + (*p - '0');
+			}
+			return true;
+		};
+		int year, month, day;
+		if (!Digits(4, year))
+			return nullptr;
+		char separator = p < end && (*p == '-' || *p == '/') ? *p : 0;
+		if (separator)
+			p++;
+		if (!Digits(2, month))
+			return nullptr;
+		if (separator) {
+			if (p >= end || *p != separator)
+				return nullptr;
+			p++;
+		}
+		if (!Digits(2, day) || month < 1 || month > 12 || day < 1 || day > 31)
+			return nullptr;
+		date = year*10000 + month*100 + day;
+		return p;
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef BEV_CSV_LOADER_H
+#define BEV_CSV_LOADER_H
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace data_utils
+{
+	/*
+	Fast CSV loading for price data such as Yahoo Finance downloads (e.g. GOOG.csv).
+
+	The file is memory-mapped and parsed in a single pass straight from the mapping, with no per-line strings or streams,
+	extracting any number of columns at once (e.g. Close and Adj Close). Numbers are parsed by ParseDouble, which gives
+	the same (correctly rounded) values as std::stod. Large files can be split across threads at line boundaries.
+	Errors are reported through a CSVStatus return code, so callers loading many files can skip or report a bad file
+	and carry on.
+	Fields are split on commas only: quoted fields containing commas are not supported. Lines may end in \n or \r\n,
+	and blank lines are skipped. */
+
+	enum class CSVStatus {
+		Ok,
+		OpenFailed,		// the file could not be opened or mapped
+		EmptyFile,		// no header or data lines
+		ColumnNotFound,	// a requested column name is not in the header, or a column number is beyond the header's columns
+		ParseError		// a line is missing a requested field, or the field is not a number (e.g. "null")
+	};
+
+	// Short description of a status, for error messages
+	const char* CSVStatusMessage(CSVStatus status);
+
+	// Columns read by LoadCSVColumns
+	struct CSVColumns {
+		std::vector<std::string> names; // names of the columns read (from the header, or their numbers as text without a header)
+		Eigen::ArrayXXd values; // one column per requested column, one row per data line
+		std::vector<int32_t> dates; // dates of the date column as yyyymmdd, when one was requested
+		int error_line = 0; // on ParseError, the (1-based) line of the file at which parsing failed
+	};
+
+	/*
+	Reads the named columns of a CSV with a header line into columns.values, in the order requested.
+	USAGE:	CSVColumns columns;
+			if (LoadCSVColumns("GOOG.csv", {"Close", "Adj Close"}, columns) != CSVStatus::Ok) ... 
+			n_threads > 1 splits the data lines into that many chunks parsed concurrently, worthwhile for files of
+			several MB and more. If date_col_name is set, that column is also read into columns.dates (see ParseDate). */
+	CSVStatus LoadCSVColumns(const std::string& csv_path, const std::vector<std::string>& col_names, CSVColumns& columns, int n_threads = 1, const std::string& date_col_name = "");
+	// Same, selecting the columns by (zero-indexed) number. If header is false the first line is read as data.
+	CSVStatus LoadCSVColumns(const std::string& csv_path, const std::vector<int>& col_nos, bool header, CSVColumns& columns, int n_threads = 1);
+
+	// Reads the column names of the header line
+	CSVStatus ReadCSVHeader(const std::string& csv_path, std::vector<std::string>& col_names);
+
+	/*
+	Parses a decimal number (optional sign, digits, optional fraction and exponent) starting at begin, skipping leading
+	spaces, and stopping at end. Returns a pointer one past the last character used, or nullptr if there is no number.
+	Numbers whose digits fit in 53 bits (up to 15 significant digits) with a power of ten of at most 22 either way, i.e.
+	all typical prices, are converted with a single exact multiplication or division, and others fall back to 
+	std::strtod, so the result is always correctly rounded. */
+	const char* ParseDouble(const char* begin, const char* end, double& value);
+	// Parses a date written YYYY-MM-DD (or YYYY/MM/DD, or YYYYMMDD) into the integer yyyymmdd, as ParseDouble.
+	const char* ParseDate(const char* begin, const char* end, int32_t& date);
+}
+
+#endif
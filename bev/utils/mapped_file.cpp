@@ -0,0 +1,82 @@
+#include "mapped_file.h"
+#include <string>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace data_utils
+{
+	void MappedFile::Close() {
+#ifdef _WIN32
+		if (data_)
+			UnmapViewOfFile(data_);
+		if (mapping_)
+			CloseHandle((HANDLE) mapping_);
+		if (file_)
+			CloseHandle((HANDLE) file_);
+		file_ = nullptr;
+		mapping_ = nullptr;
+#else
+		if (data_)
+			munmap(const_cast<char*>(data_), size_);
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	bool MappedFile::Open(const std::string& path) {
+		Close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		file_ = file;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+			return false;
+		size_ = (size_t) size.QuadPart;
+		if (size_ == 0)
+			return true;
+		mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_)
+			return false;
+		data_ = (const char*) MapViewOfFile((HANDLE) mapping_, FILE_MAP_READ, 0, 0, 0);
+		return data_ != nullptr;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			return false;
+		}
+		size_ = (size_t) info.st_size;
+		if (size_ == 0) {
+			close(fd);
+			return true;
+		}
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping stays valid
+		if (data == MAP_FAILED) {
+			size_ = 0;
+			return false;
+		}
+		madvise(data, size_, MADV_SEQUENTIAL);
+		data_ = (const char*) data;
+		return true;
+#endif
+	}
+}
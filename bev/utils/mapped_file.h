@@ -0,0 +1,35 @@
+#ifndef BEV_MAPPED_FILE_H
+#define BEV_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace data_utils
+{
+	/*
+	Read-only memory mapping of a whole file (mmap, or MapViewOfFile on Windows), unmapped on destruction.
+	Used by the CSV loader (csv_loader.h) to parse straight from the page cache, and by the binary price cache 
+	(price_cache.h) to hand out zero-copy views of its columns for as long as the mapping is alive. */
+	class MappedFile {
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+#ifdef _WIN32
+		void* file_ = nullptr; // HANDLEs, kept opaque so that windows.h is not included here
+		void* mapping_ = nullptr;
+#endif
+		void Close();
+
+	public:
+		MappedFile() {};
+		~MappedFile() { Close(); };
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Maps the file at path, returning false if it can't be opened or mapped. An empty file maps to size 0.
+		bool Open(const std::string& path);
+		const char* Data() const { return data_; };
+		size_t Size() const { return size_; };
+	};
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef BEV_PHILOX_H
+#define BEV_PHILOX_H
+
+#include <cstdint>
+
+namespace data_utils
+{
+	/*
+	Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", 
+	SC11). Rather than stepping a hidden state, it maps a 128-bit counter and a 64-bit key (the seed) to four 
+	independent 32-bit random words, so any part of a random stream can be generated directly, in any order and on any 
+	thread, with the same result.
+	USAGE:	Philox4x32 rng(seed);
+			uint32_t words[4];
+			rng.Generate(block, stream, words); // e.g. stream = path number, block = position along the path */
+	class Philox4x32 {
+		uint32_t key_[2];
+
+		static void MulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+			const uint64_t product = (uint64_t) a * b;
+			hi = (uint32_t) (product >> 32);
+			lo = (uint32_t) product;
+		}
+
+	public:
+		explicit Philox4x32(uint64_t seed) : key_{(uint32_t) seed, (uint32_t) (seed >> 32)} {};
+
+		// Fills words with the four random words for counter (block, stream)
+		void Generate(uint64_t block, uint64_t stream, uint32_t words[4]) const {
+			uint32_t c[4] = {(uint32_t) block, (uint32_t) (block >> 32), (uint32_t) stream, (uint32_t) (stream >> 32)};
+			uint32_t k0 = key_[0], k1 = key_[1];
+			for (int round = 0; round < 10; round++) {
+				uint32_t hi0, lo0, hi1, lo1;
+				MulHiLo(0xD2511F53u, c[0], hi0, lo0);
+				MulHiLo(0xCD9E8D57u, c[2], hi1, lo1);
+				const uint32_t next[4] = {hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0};
+				c[0] = next[0]; c[1] = next[1]; c[2] = next[2]; c[3] = next[3];
+				k0 += 0x9E3779B9u; // Weyl sequence key schedule
+				k1 += 0xBB67AE85u;
+			}
+			words[0] = c[0]; words[1] = c[1]; words[2] = c[2]; words[3] = c[3];
+		}
+
+		// Uniform double in the open interval (0, 1) with 53 random bits, from two random words
+		static double ToUniform(uint32_t high, uint32_t low) {
+			const uint64_t bits = ((uint64_t) (high >> 5) << 26) | (low >> 6);
+			return (bits + 0.5) * (1.0 / 9007199254740992.0);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "price_cache.h"
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+namespace data_utils
+{
+	namespace {
+		const char kMagic[8] = {'B', 'E', 'V', 'P', 'R', 'I', 'C', 'E'};
+		const uint32_t kVersion = 1;
+		const size_t kAlignment = 64; // header, directory entries and columns all start on 64-byte boundaries
+		const size_t kNameLength = 48;
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t n_columns;
+			uint64_t n_rows;
+			uint64_t dates_offset;
+			char padding[32];
+		};
+		struct DirectoryEntry {
+			char name[kNameLength];
+			uint64_t offset;
+			char padding[8];
+		};
+		static_assert(sizeof(Header) == kAlignment && sizeof(DirectoryEntry) == kAlignment, "Cache header and directory entries must be 64 bytes.");
+
+		bool IsLittleEndian() {
+			const uint16_t one = 1;
+			unsigned char first_byte;
+			std::memcpy(&first_byte, &one, 1);
+			return first_byte == 1;
+		}
+
+		size_t Align(size_t offset) {
+			return (offset + kAlignment - 1) / kAlignment * kAlignment;
+		}
+	}
+
+	const char* CacheStatusMessage(CacheStatus status) {
+		switch (status) {
+			case CacheStatus::Ok: return "ok";
+			case CacheStatus::OpenFailed: return "cache could not be opened";
+			case CacheStatus::WriteFailed: return "cache could not be written";
+			case CacheStatus::InvalidFormat: return "not a valid price cache";
+		}
+		return "unknown status";
+	}
+
+	CacheStatus WritePriceCache(const std::string& cache_path, const CSVColumns& columns) {
+		if (!IsLittleEndian())
+			return CacheStatus::InvalidFormat;
+		const size_t n_rows = columns.values.rows();
+		const size_t n_columns = columns.values.cols();
+		if (columns.names.size() != n_columns || (!columns.dates.empty() && columns.dates.size() != n_rows))
+			return CacheStatus::InvalidFormat;
+
+		Header header = {};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.n_columns = (uint32_t) n_columns;
+		header.n_rows = n_rows;
+		std::vector<DirectoryEntry> directory(n_columns);
+		size_t offset = Align(sizeof(Header) + n_columns * sizeof(DirectoryEntry));
+		if (!columns.dates.empty()) {
+			header.dates_offset = offset;
+			offset = Align(offset + n_rows * sizeof(int32_t));
+		}
+		for (size_t k = 0; k < n_columns; k++) {
+			DirectoryEntry entry = {};
+			if (columns.names[k].size() >= kNameLength)
+				return CacheStatus::InvalidFormat;
+			std::memcpy(entry.name, columns.names[k].data(), columns.names[k].size());
+			entry.offset = offset;
+			directory[k] = entry;
+			offset = Align(offset + n_rows * sizeof(double));
+		}
+
+		// write next to the destination, then rename into place
+		std::string temp_path = cache_path + ".tmp";
+		{
+			std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+			if (!out)
+				return CacheStatus::WriteFailed;
+			const char zeros[kAlignment] = {};
+			size_t written = 0;
+			auto Write = [&] (const void* data, size_t size) {
+				out.write((const char*) data, size);
+				written += size;
+			};
+			auto PadTo = [&] (size_t position) {
+				Write(zeros, position - written);
+			};
+			Write(&header, sizeof(header));
+			Write(directory.data(), directory.size() * sizeof(DirectoryEntry));
+			if (!columns.dates.empty()) {
+				PadTo(header.dates_offset);
+				Write(columns.dates.data(), n_rows * sizeof(int32_t));
+			}
+			for (size_t k = 0; k < n_columns; k++) {
+				PadTo(directory[k].offset);
+				Write(columns.values.col(k).data(), n_rows * sizeof(double));
+			}
+			PadTo(offset);
+			if (!out)
+				return CacheStatus::WriteFailed;
+		}
+		if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+			// rename does not replace an existing file on every platform
+			std::remove(cache_path.c_str());
+			if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+				std::remove(temp_path.c_str());
+				return CacheStatus::WriteFailed;
+			}
+		}
+		return CacheStatus::Ok;
+	}
+
+	CacheStatus PriceCache::Open(const std::string& cache_path) {
+		n_rows_ = 0;
+		names_.clear();
+		columns_.clear();
+		dates_ = nullptr;
+		if (!file_.Open(cache_path))
+			return CacheStatus::OpenFailed;
+		if (!IsLittleEndian() || file_.Size() < sizeof(Header))
+			return CacheStatus::InvalidFormat;
+
+		Header header;
+		std::memcpy(&header, file_.Data(), sizeof(Header));
+		if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+			return CacheStatus::InvalidFormat;
+		const uint64_t size = file_.Size();
+		const uint64_t n_rows = header.n_rows;
+		if (n_rows > (uint64_t) INT32_MAX || header.n_columns > (size - sizeof(Header)) / sizeof(DirectoryEntry))
+			return CacheStatus::InvalidFormat;
+		// a column of element_size bytes per row must be aligned and lie within the file
+		auto ColumnFits = [&] (uint64_t offset, uint64_t element_size) {
+			return offset % kAlignment == 0 && offset <= size && n_rows * element_size <= size - offset;
+		};
+
+		const int32_t* dates = nullptr;
+		if (header.dates_offset) {
+			if (!ColumnFits(header.dates_offset, sizeof(int32_t)))
+				return CacheStatus::InvalidFormat;
+			dates = (const int32_t*) (file_.Data() + header.dates_offset);
+		}
+		std::vector<std::string> names;
+		std::vector<const double*> columns;
+		const DirectoryEntry* directory = (const DirectoryEntry*) (file_.Data() + sizeof(Header));
+		for (uint32_t k = 0; k < header.n_columns; k++) {
+			if (!ColumnFits(directory[k].offset, sizeof(double)))
+				return CacheStatus::InvalidFormat;
+			const char* name = directory[k].name;
+			names.push_back(std::string(name, std::find(name, name + kNameLength, '\0')));
+			columns.push_back((const double*) (file_.Data() + directory[k].offset));
+		}
+		n_rows_ = (int) n_rows;
+		names_ = names;
+		columns_ = columns;
+		dates_ = dates;
+		return CacheStatus::Ok;
+	}
+
+	const double* PriceCache::Column(int col_no) const {
+		if (col_no < 0 || col_no >= Columns())
+			return nullptr;
+		return columns_[col_no];
+	}
+
+	const double* PriceCache::Column(const std::string& col_name) const {
+		auto it = std::find(names_.begin(), names_.end(), col_name);
+		return it == names_.end() ? nullptr : columns_[it - names_.begin()];
+	}
+}
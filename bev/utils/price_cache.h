@@ -0,0 +1,62 @@
+#ifndef BEV_PRICE_CACHE_H
+#define BEV_PRICE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "mapped_file.h"
+#include "csv_loader.h"
+
+namespace data_utils
+{
+	/*
+	Binary columnar cache of a price history (e.g. one ticker's CSV), read back by memory-mapping with no parsing or copying.
+
+	Layout (all integers and doubles little-endian, every column starting on a 64-byte boundary):
+		header, 64 bytes:	char magic[8] = "BEVPRICE", uint32 version, uint32 number of double columns,
+							uint64 number of rows, uint64 offset of the date column (0 if none), padding
+		directory:			one 64-byte entry per double column: char name[48] (zero-padded), uint64 offset, padding
+		data:				the date column (int32 yyyymmdd per row), then each double column (one double per row).
+	USAGE:	Write once with WritePriceCache (or the csv_to_cache tool), then Open a PriceCache and use the columns in
+			place, e.g. with BEV::SetData. The column pointers stay valid for as long as the PriceCache is alive. */
+
+	enum class CacheStatus {
+		Ok,
+		OpenFailed,		// the file could not be opened or mapped
+		WriteFailed,	// the file could not be written
+		InvalidFormat	// not a price cache, an unsupported version, or truncated (also returned on big-endian hosts)
+	};
+
+	// Short description of a status, for error messages
+	const char* CacheStatusMessage(CacheStatus status);
+
+	/*
+	Writes the columns (names and values) and, if not empty, the dates of columns to a price cache at cache_path. The file
+	is written next to cache_path and renamed into place, so readers never see a partly written cache. Column names
+	are limited to 47 characters. */
+	CacheStatus WritePriceCache(const std::string& cache_path, const CSVColumns& columns);
+
+	// Read-only, memory-mapped price cache
+	class PriceCache {
+		MappedFile file_;
+		int n_rows_ = 0;
+		std::vector<std::string> names_;
+		std::vector<const double*> columns_;
+		const int32_t* dates_ = nullptr;
+
+	public:
+		// Maps the cache at cache_path and checks its header and directory, without reading the data itself.
+		CacheStatus Open(const std::string& cache_path);
+
+		int Rows() const { return n_rows_; };
+		int Columns() const { return (int) columns_.size(); };
+		const std::vector<std::string>& Names() const { return names_; };
+		// Pointer to the Rows() values of a column, or nullptr if there is no such column
+		const double* Column(int col_no) const;
+		const double* Column(const std::string& col_name) const;
+		// Pointer to the Rows() dates (yyyymmdd), or nullptr if the cache has no dates
+		const int32_t* Dates() const { return dates_; };
+	};
+}
+
+#endif
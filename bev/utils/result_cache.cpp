@@ -0,0 +1,264 @@
+#include "result_cache.h"
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <direct.h>
+	#include <process.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace data_utils
+{
+	namespace {
+		const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+		const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+		const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+		const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+
+		uint64_t RotateLeft(uint64_t x, int bits) {
+			return (x << bits) | (x >> (64 - bits));
+		}
+
+		// Final mix of a lane, so that every input bit affects every output bit (the MurmurHash3 finaliser)
+		uint64_t Avalanche(uint64_t x) {
+			x ^= x >> 33;
+			x *= 0xFF51AFD7ED558CCDULL;
+			x ^= x >> 33;
+			x *= 0xC4CEB9FE1A85EC53ULL;
+			x ^= x >> 33;
+			return x;
+		}
+
+		bool IsLittleEndian() {
+			const uint16_t one = 1;
+			unsigned char first_byte;
+			std::memcpy(&first_byte, &one, 1);
+			return first_byte == 1;
+		}
+
+		const char kMagic[8] = {'B', 'E', 'V', 'R', 'S', 'U', 'L', 'T'};
+		const uint32_t kVersion = 1;
+		const char kExtension[] = ".bevr";
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t padding;
+			uint64_t digest_high;
+			uint64_t digest_low;
+			uint64_t n_values;
+			uint64_t values_hash;
+		};
+		static_assert(sizeof(Header) == 48, "Result cache header must be 48 bytes.");
+
+		uint64_t ValuesHash(const double* values, size_t n_values) {
+			return Hasher().Add(values, n_values * sizeof(double)).Finish().low;
+		}
+
+		int ProcessId() {
+#ifdef _WIN32
+			return _getpid();
+#else
+			return (int) getpid();
+#endif
+		}
+
+		// Name of a file of its own next to path, for writing before renaming into place
+		std::string TemporaryPath(const std::string& path) {
+			static std::atomic<unsigned long long> counter{0};
+			return path + ".tmp." + std::to_string(ProcessId()) + "." + std::to_string(counter++);
+		}
+
+		bool WriteFile(const std::string& path, const void* data, size_t size, const void* more = nullptr, size_t more_size = 0) {
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			if (!out)
+				return false;
+			out.write((const char*) data, size);
+			if (more_size > 0)
+				out.write((const char*) more, more_size);
+			out.close();
+			return !out.fail();
+		}
+
+		// Opens the entry at path and checks its header against digest, leaving in at the values and their count in header
+		bool OpenEntry(const std::string& path, const Digest& digest, std::ifstream& in, Header& header) {
+			in.open(path, std::ios::binary | std::ios::ate);
+			if (!in)
+				return false;
+			uint64_t size = (uint64_t) in.tellg();
+			in.seekg(0);
+			if (size < sizeof(Header) || !in.read((char*) &header, sizeof(Header)))
+				return false;
+			return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion
+				&& header.digest_high == digest.high && header.digest_low == digest.low
+				&& header.n_values == (size - sizeof(Header)) / sizeof(double) && (size - sizeof(Header)) % sizeof(double) == 0;
+		}
+	}
+
+	std::string Digest::Hex() const {
+		char hex[33];
+		std::snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long) high, (unsigned long long) low);
+		return hex;
+	}
+
+	Hasher::Hasher(uint64_t seed) : a_(seed + kPrime1), b_(seed ^ kPrime4) {}
+
+	void Hasher::AddWord(uint64_t word) {
+		a_ = RotateLeft(a_ ^ (word * kPrime2), 31) * kPrime1;
+		b_ = RotateLeft(b_ + word * kPrime3, 27) * kPrime4 + kPrime2;
+	}
+
+	/*
+	Whole 8-byte words are read straight from data, while the bytes of a word split between calls are gathered in tail_,
+	so the words hashed are the same however the bytes are split. */
+	Hasher& Hasher::Add(const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*) data;
+		int pending = length_ % 8;
+		length_ += size;
+		while (pending > 0 && size > 0) {
+			tail_ |= (uint64_t) *bytes++ << (8 * pending++);
+			size--;
+			if (pending == 8) {
+				AddWord(tail_);
+				tail_ = 0;
+				pending = 0;
+			}
+		}
+		for (; size >= 8; bytes += 8, size -= 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			AddWord(word);
+		}
+		for (int k = 0; size > 0; k++, size--)
+			tail_ |= (uint64_t) *bytes++ << (8 * k);
+		return *this;
+	}
+
+	Digest Hasher::Finish() const {
+		uint64_t a = a_, b = b_;
+		if (length_ % 8 != 0) {
+			a = RotateLeft(a ^ (tail_ * kPrime2), 31) * kPrime1;
+			b = RotateLeft(b + tail_ * kPrime3, 27) * kPrime4 + kPrime2;
+		}
+		a ^= length_;
+		b ^= length_ * kPrime1;
+		Digest digest;
+		digest.high = Avalanche(a ^ RotateLeft(b, 17));
+		digest.low = Avalanche(b + a * kPrime3);
+		return digest;
+	}
+
+	std::string ResultCache::EntryPath(const Digest& digest) const {
+		return directory_ + "/" + digest.Hex() + kExtension;
+	}
+
+	CacheStatus ResultCache::Open(const std::string& directory) {
+		directory_ = directory;
+		if (!IsLittleEndian())
+			return CacheStatus::InvalidFormat;
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0777);
+#endif
+		// whether or not it was just created, the directory is usable if a file can be written in it
+		std::string probe = TemporaryPath(directory + "/probe");
+		bool writable = WriteFile(probe, kMagic, sizeof(kMagic));
+		std::remove(probe.c_str());
+		return writable ? CacheStatus::Ok : CacheStatus::OpenFailed;
+	}
+
+	bool ResultCache::Load(const Digest& digest, std::vector<double>& values) {
+		std::ifstream in;
+		Header header;
+		bool found = OpenEntry(EntryPath(digest), digest, in, header);
+		if (found) {
+			values.resize(header.n_values);
+			found = (header.n_values == 0 || in.read((char*) values.data(), header.n_values * sizeof(double)))
+				&& ValuesHash(values.data(), values.size()) == header.values_hash;
+		}
+		(found ? hits_ : misses_)++;
+		return found;
+	}
+
+	bool ResultCache::Load(const Digest& digest, double* values, size_t n_values) {
+		std::ifstream in;
+		Header header;
+		bool found = OpenEntry(EntryPath(digest), digest, in, header) && header.n_values == n_values
+			&& (n_values == 0 || in.read((char*) values, n_values * sizeof(double))) && ValuesHash(values, n_values) == header.values_hash;
+		(found ? hits_ : misses_)++;
+		return found;
+	}
+
+	/*
+	Written to a temporary file of this process and renamed into place, which replaces any existing entry atomically on
+	POSIX systems. Where rename does not replace files, an entry already in place holds the same result, so it is kept. */
+	bool ResultCache::Store(const Digest& digest, const double* values, size_t n_values) {
+		Header header = {};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.digest_high = digest.high;
+		header.digest_low = digest.low;
+		header.n_values = n_values;
+		header.values_hash = ValuesHash(values, n_values);
+
+		std::string path = EntryPath(digest);
+		std::string temp_path = TemporaryPath(path);
+		bool stored = WriteFile(temp_path, &header, sizeof(header), values, n_values * sizeof(double));
+		if (stored && std::rename(temp_path.c_str(), path.c_str()) != 0)
+			stored = std::ifstream(path).good();
+		std::remove(temp_path.c_str()); // no-op once renamed
+		(stored ? stores_ : failed_stores_)++;
+		return stored;
+	}
+
+	int ResultCache::Clear() {
+		std::vector<std::string> names;
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((directory_ + "/*" + kExtension + "*").c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE) {
+			do
+				names.push_back(found.cFileName);
+			while (FindNextFileA(search, &found));
+			FindClose(search);
+		}
+#else
+		if (DIR* dir = opendir(directory_.c_str())) {
+			while (dirent* entry = readdir(dir)) {
+				if (std::strstr(entry->d_name, kExtension))
+					names.push_back(entry->d_name);
+			}
+			closedir(dir);
+		}
+#endif
+		int n_removed = 0;
+		for (const std::string& name : names)
+			n_removed += std::remove((directory_ + "/" + name).c_str()) == 0;
+		return n_removed;
+	}
+
+	ResultCache::Stats ResultCache::GetStats() const {
+		Stats stats;
+		stats.hits = hits_;
+		stats.misses = misses_;
+		stats.stores = stores_;
+		stats.failed_stores = failed_stores_;
+		return stats;
+	}
+}
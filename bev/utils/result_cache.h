@@ -0,0 +1,91 @@
+#ifndef BEV_RESULT_CACHE_H
+#define BEV_RESULT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "price_cache.h"
+
+namespace data_utils
+{
+	// 128-bit content digest, see Hasher
+	struct Digest {
+		uint64_t high = 0, low = 0;
+		// 32 lowercase hexadecimal digits
+		std::string Hex() const;
+		bool operator==(const Digest& other) const { return high == other.high && low == other.low; };
+		bool operator!=(const Digest& other) const { return !(*this == other); };
+	};
+
+	/*
+	Streaming 128-bit hash of bytes (two independent 64-bit lanes, multiply-rotate mixing over 8-byte words and a final
+	avalanche), for content addressing. Not cryptographic: it tells apart inputs that differ, not inputs built to collide.
+	The digest depends on the bytes and their order only, not on how they were split between calls to Add.
+	USAGE:	Hasher hasher;
+			hasher.Add(prices.data(), prices.size() * sizeof(double)).Add(interest_rate).Add(n_days);
+			Digest digest = hasher.Finish(); */
+	class Hasher {
+		uint64_t a_, b_;
+		uint64_t length_ = 0; // bytes added so far
+		uint64_t tail_ = 0; // bytes added after the last full word, in its low bytes
+		void AddWord(uint64_t word);
+
+	public:
+		Hasher(uint64_t seed = 0);
+		Hasher& Add(const void* data, size_t size);
+		// Adds the bytes of an integer, enum, bool or floating-point value (e.g. a double's bit pattern)
+		template <typename T>
+		Hasher& Add(T value) {
+			static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Only arithmetic values and enums are hashed by value.");
+			return Add(&value, sizeof(T));
+		};
+		Digest Finish() const;
+	};
+
+	/*
+	Content-addressed store of results (vectors of doubles) on disk, one file per result named by the digest of
+	everything it was computed from, in a directory shared by any number of processes. A result is written once to a
+	file of its own and renamed into place, so readers see either the whole file or none; results under the same digest
+	are the same, so writers racing to store one need no locking. Every file records its digest, length and a hash of
+	its values, and is ignored (as a miss) unless they all check out.
+
+	Layout of <directory>/<digest hex>.bevr (little-endian): char magic[8] = "BEVRSULT", uint32 version, uint32 padding,
+	uint64 digest high and low words, uint64 number of values, uint64 hash of the values, then the values (doubles).
+	USAGE:	auto cache = std::make_shared<ResultCache>();
+			if (cache->Open("bev_results") == CacheStatus::Ok)
+				bev.SetResultCache(cache); // see BEV::SetResultCache */
+	class ResultCache {
+		std::string directory_;
+		std::atomic<long long> hits_{0}, misses_{0}, stores_{0}, failed_stores_{0};
+		std::string EntryPath(const Digest& digest) const;
+
+	public:
+		// Counters of the lookups and stores made through this object
+		struct Stats {
+			long long hits = 0, misses = 0, stores = 0, failed_stores = 0;
+		};
+
+		/*
+		Uses directory for the results, creating it (but not its parents) if missing. Returns OpenFailed if it is not a
+		directory that could be written to, or InvalidFormat on big-endian hosts. */
+		CacheStatus Open(const std::string& directory);
+		const std::string& Directory() const { return directory_; };
+
+		// Reads the result stored under digest into values, returning false (leaving values unspecified) if there is none.
+		bool Load(const Digest& digest, std::vector<double>& values);
+		// Same for a result of exactly n_values values, read into values[0, n_values)
+		bool Load(const Digest& digest, double* values, size_t n_values);
+		// Stores n_values values under digest, returning false if they could not be written. Thread- and process-safe.
+		bool Store(const Digest& digest, const double* values, size_t n_values);
+		// Removes every result (and any temporary file left by an interrupted store) from the directory, returning the
+		// number of files removed. Not to be called while other processes use the directory.
+		int Clear();
+
+		Stats GetStats() const;
+	};
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace thread_utils
+{
+	ThreadPool::ThreadPool(int n_threads) {
+		if (n_threads <= 0)
+			n_threads = std::max(1, (int) std::thread::hardware_concurrency());
+		for (int i = 0; i < n_threads; i++)
+			queues_.emplace_back(new WorkQueue);
+		for (int i = 0; i < n_threads; i++)
+			workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		job_ready_.notify_all();
+		for (std::thread& worker : workers_)
+			worker.join();
+	}
+
+	/*
+	Pops a task from the back of the worker's own queue, otherwise steals from the front of another worker's queue.
+	Returns false once every queue is empty. */
+	bool ThreadPool::PopTask(int id, int& task) {
+		{
+			WorkQueue& own = *queues_[id];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = own.tasks.back();
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		int n = (int) queues_.size();
+		for (int k = 1; k < n; k++) {
+			WorkQueue& victim = *queues_[(id + k) % n];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ThreadPool::WorkerLoop(int id) {
+		unsigned long seen_generation = 0;
+		while (true) {
+			const std::function<void(int)>* job;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				job_ready_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+				if (stop_)
+					return;
+				seen_generation = generation_;
+				job = job_;
+			}
+			int task;
+			while (PopTask(id, task)) {
+				try {
+					(*job)(task);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (!error_)
+						error_ = std::current_exception();
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				active_workers_--;
+				if (active_workers_ == 0)
+					job_done_.notify_all();
+			}
+		}
+	}
+
+	void ThreadPool::ParallelFor(int n_tasks, const std::function<void(int)>& task) {
+		if (n_tasks <= 0)
+			return;
+		std::lock_guard<std::mutex> call_lock(call_mutex_);
+		// Deal contiguous blocks of task indices to the workers; stealing evens out the rest
+		int n = (int) queues_.size();
+		for (int i = 0; i < n; i++) {
+			int begin = (int) ((long long) n_tasks * i / n);
+			int end = (int) ((long long) n_tasks * (i + 1) / n);
+			std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+			for (int t = begin; t < end; t++)
+				queues_[i]->tasks.push_back(t);
+		}
+		std::exception_ptr error;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			job_ = &task;
+			error_ = nullptr;
+			active_workers_ = n;
+			generation_++;
+			job_ready_.notify_all();
+			job_done_.wait(lock, [this] { return active_workers_ == 0; });
+			job_ = nullptr;
+			error = error_;
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef BEV_THREAD_POOL_H
+#define BEV_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace thread_utils
+{
+	/*
+	Fixed-size work-stealing thread pool used to spread independent solves (e.g. the cells of a BEV surface) over several cores.
+
+	Each worker owns a deque of task indices. A worker pops tasks from the back of its own deque and, once it runs dry,
+	steals from the front of the other workers' deques, so uneven task costs (long-dated cells are far more expensive
+	than short-dated ones) are balanced without a central queue.
+	USAGE:	Construct once with the desired thread count and call ParallelFor as often as needed. ParallelFor blocks until
+			every task has run. Tasks must not call ParallelFor on the same pool (no nested parallelism). */
+	class ThreadPool {
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<int> tasks;
+		};
+
+		std::vector<std::thread> workers_;
+		std::vector<std::unique_ptr<WorkQueue>> queues_; // one queue per worker
+		std::mutex mutex_; // guards the job state below
+		std::condition_variable job_ready_;
+		std::condition_variable job_done_;
+		const std::function<void(int)>* job_ = nullptr; // task body of the current ParallelFor call
+		unsigned long generation_ = 0; // incremented for every new job so workers wake exactly once per job
+		int active_workers_ = 0; // workers still busy with the current job
+		bool stop_ = false;
+		std::exception_ptr error_; // first exception thrown by a task, rethrown by ParallelFor
+		std::mutex call_mutex_; // serialises concurrent ParallelFor callers
+
+		void WorkerLoop(int id);
+		bool PopTask(int id, int& task);
+
+	public:
+		// n_threads <= 0 uses std::thread::hardware_concurrency()
+		explicit ThreadPool(int n_threads = 0);
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		int Size() const { return (int) workers_.size(); };
+
+		// Runs task(i) for every i in [0, n_tasks) across the pool and returns once all have finished.
+		// Task indices are dealt out to the workers' deques in contiguous blocks before the workers are woken.
+		void ParallelFor(int n_tasks, const std::function<void(int)>& task);
+	};
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include "utils.h"
+#include "csv_loader.h"
+#include "philox.h"
+#include "thread_pool.h"
 #include <Eigen/Dense>
 #include <string>
 #include <cstring>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -10,58 +14,48 @@
 #include <functional>
 #include <iomanip>
 #include <random>
+#include <algorithm>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
 
 namespace data_utils 
 {
 	/* 
 		Function reads specified column from the CSV in csv_path and outputs an Eigen array (column vector) of corresponding size.
 		If header is true, function searches for specific column name, otherwise it uses the specified column
-		number. */
+		number. Delegates to LoadCSVColumns (see csv_loader.h), terminating if the file can't be read; use LoadCSVColumns
+		directly for recoverable error codes or several columns at once. */
 	Eigen::ArrayXXd CSVToEigenArray(std::string csv_path, int col_no, bool header, std::string col_name) {
-		// Open stream
-		std::ifstream csv(csv_path);
-		if(!csv) {
-			std::cerr << "File could not be opened." << std::endl;
-			std::cerr << "Error code: " << std::strerror(errno) << std::endl;
-			csv.close();
-			std::terminate(); // as yet, unsure if this is really bad. use < throw; > ?
-		}
+		CSVColumns columns;
+		CSVStatus status;
 		// if header exists then make sure a column name was inputted, else need a column number
 		if (header) {
 			assert(col_name != "undefined" && "Insert column name");
-			// get first line 
-			std::string line;
-			std::getline(csv, line);
-			std::stringstream lineStream(line);
-			// find column count of desired column
-			std::string cell;
-			std::getline(lineStream, cell, ',');
-			int count = 0;
-			while (cell != col_name) {
-				std::getline(lineStream, cell, ',');
-				count++;
-			}
-			col_no = count;
-		} else
+			status = LoadCSVColumns(csv_path, std::vector<std::string>{col_name}, columns);
+		} else {
 			assert(col_no != -1 && "Choose column number, zero indexed");
-
-		std::vector<double> values;
-		int nRows = 0;
-		std::string line;
-		// Populate values vector with value from correct column
-		while (std::getline(csv, line)) {
-			std::stringstream lineStream(line);
-			std::string cell;
-			int j = 0;
-			while (j <= col_no) {
-				std::getline(lineStream, cell, ',');
-				j++;
-			}
-			values.push_back(std::stod(cell));
-			nRows++;
+			status = LoadCSVColumns(csv_path, std::vector<int>{col_no}, false, columns);
+		}
+		if (status != CSVStatus::Ok) {
+			std::cerr << "Could not read " << csv_path << ": " << CSVStatusMessage(status);
+			if (status == CSVStatus::OpenFailed)
+				std::cerr << " (" << std::strerror(errno) << ")";
+			else if (status == CSVStatus::ParseError)
+				std::cerr << " on line " << columns.error_line;
+			std::cerr << std::endl;
+			std::terminate();
 		}
-		csv.close();
-		return Eigen::Map<Eigen::ArrayXXd>(values.data(), nRows, 1);
+		return columns.values;
 	}
 
 	/*	Function to generate a GBM sample path with given parameters.
@@ -76,10 +70,91 @@ namespace data_utils
 
 		int N = 21*12*T_years; // number of days, assuming 21 business days per month
 		double dt = 1.0 / (21.0 * 12.0); // or (double) T/N;
-		S(0,0) = 100;
+		S(0,0) = S_0;
 		for (int i = 1; i < N+1; i++)
 			S(i, 0) = S(i-1, 0) * std::exp((mu - 0.5 * std::pow(sigma, 2)) * dt + sigma * std::sqrt(dt) * dnorm(generator));
 	}
+
+	void GenerateGBMPaths(Eigen::ArrayXXd& S, double S_0, double mu, double sigma, int T_years, int n_paths, uint64_t seed, uint64_t first_path, int n_threads) {
+		const int N = 21*12*T_years;
+		const double dt = 1.0 / (21.0 * 12.0);
+		if (S.rows() != N + 1 || S.cols() != n_paths)
+			S = Eigen::ArrayXXd(N + 1, n_paths);
+		const Philox4x32 rng(seed);
+		const int n_pairs = (N + 1) / 2; // each counter block gives a pair of uniforms, i.e. two normals
+		const double drift = (mu - 0.5 * sigma * sigma) * dt, vol = sigma * std::sqrt(dt);
+
+		auto GeneratePath = [&] (int m) {
+			Eigen::ArrayXd u1(n_pairs), u2(n_pairs);
+			uint32_t words[4];
+			for (int j = 0; j < n_pairs; j++) {
+				rng.Generate(j, first_path + m, words);
+				u1(j) = Philox4x32::ToUniform(words[0], words[1]);
+				u2(j) = Philox4x32::ToUniform(words[2], words[3]);
+			}
+			// Box-Muller: r cos(theta) and r sin(theta) are independent standard normals
+			Eigen::ArrayXd r = (-2.0 * u1.log()).sqrt(), theta = 2.0 * math_constants::pi * u2;
+			Eigen::ArrayXd log_returns(2 * n_pairs);
+			log_returns.head(n_pairs) = drift + vol * r * theta.cos();
+			log_returns.tail(n_pairs) = drift + vol * r * theta.sin();
+			std::partial_sum(log_returns.data(), log_returns.data() + N, log_returns.data());
+			S(0, m) = S_0;
+			S.col(m).tail(N) = S_0 * log_returns.head(N).exp();
+		};
+		if (n_threads > 1 && n_paths > 1) {
+			thread_utils::ThreadPool pool(n_threads);
+			pool.ParallelFor(n_paths, GeneratePath);
+		}
+		else {
+			for (int m = 0; m < n_paths; m++)
+				GeneratePath(m);
+		}
+	}
+
+	std::vector<std::string> ListFiles(const std::string& directory, const std::string& extension) {
+		std::vector<std::string> names;
+		auto Add = [&] (const std::string& file_name) {
+			if (file_name.size() > extension.size() && file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0)
+				names.push_back(file_name);
+		};
+#ifdef _WIN32
+		WIN32_FIND_DATAA entry;
+		HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &entry);
+		if (find != INVALID_HANDLE_VALUE) {
+			do {
+				if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+					Add(entry.cFileName);
+			} while (FindNextFileA(find, &entry));
+			FindClose(find);
+		}
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (dir) {
+			while (dirent* entry = readdir(dir))
+				Add(entry->d_name);
+			closedir(dir);
+		}
+#endif
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	bool WriteSurfaceCSV(const std::string& csv_path, const std::vector<double>& strikes, const std::vector<int>& maturities, const Eigen::ArrayXXd& surface) {
+		std::ofstream csv(csv_path);
+		if (!csv)
+			return false;
+		csv << "Maturity";
+		for (double k : strikes)
+			csv << ',' << k;
+		csv << '\n' << std::setprecision(17); // values written in full, so they read back exactly
+		for (int i = 0; i < (int) maturities.size(); i++) {
+			csv << maturities[i];
+			for (int j = 0; j < (int) strikes.size(); j++)
+				csv << ',' << surface(i, j);
+			csv << '\n';
+		}
+		return (bool) csv;
+	}
 }
 
 namespace norm_dbn_utils
@@ -92,25 +167,42 @@ namespace norm_dbn_utils
 
 namespace bev_utils 
 {
-	/*
-	Finds the root of the function f via the secant method, which approximates the derivative of f using two points. */
-	double RootBySecantMethod(std::function<double(double)> f, double x0, double initial_step_size, double xtol, double ftol) {
-		double fx0 = f(x0);
-		double x1 = x0 - initial_step_size;
-		double fx1 = f(x1);
-		double m, next_x;
-
-		// two stopping conditions, one for x convergence and then another condition where x-axis is near parallel to f (f asymptotically approaches zero as x->0)
-		while((std::abs(x1 - x0) > xtol) && (std::abs(fx1) > ftol)) { 
-			fx1 = f(x1);
-			m = (fx1 - fx0) / (x1 - x0);
-			next_x = x0 - fx0/m;
-			x0 = x1;
-			fx0 = fx1;
-			x1 = next_x;
+	void PchipSlopes(const double* x, const double* y, int n, double* slopes) {
+		assert(n >= 2 && "PCHIP needs at least two nodes.");
+		auto Secant = [&] (int k) { return (y[k + 1] - y[k]) / (x[k + 1] - x[k]); };
+		if (n == 2) {
+			slopes[0] = slopes[1] = Secant(0);
+			return;
 		}
+		for (int k = 1; k < n - 1; k++) {
+			double h0 = x[k] - x[k - 1], h1 = x[k + 1] - x[k];
+			double s0 = Secant(k - 1), s1 = Secant(k);
+			if (s0 * s1 <= 0) {
+				slopes[k] = 0;
+			} else {
+				double w0 = 2*h1 + h0, w1 = h1 + 2*h0;
+				slopes[k] = (w0 + w1) / (w0 / s0 + w1 / s1);
+			}
+		}
+		// one-sided slope at an end from the two secants next to it (h0, s0 the nearer), kept to the sign of the nearer 
+		// secant and to three times its size where the data turns
+		auto EndSlope = [] (double h0, double h1, double s0, double s1) {
+			double slope = ((2*h0 + h1) * s0 - h0 * s1) / (h0 + h1);
+			if (slope * s0 <= 0)
+				return 0.0;
+			if (s0 * s1 <= 0 && std::abs(slope) > 3 * std::abs(s0))
+				return 3 * s0;
+			return slope;
+		};
+		slopes[0] = EndSlope(x[1] - x[0], x[2] - x[1], Secant(0), Secant(1));
+		slopes[n - 1] = EndSlope(x[n - 1] - x[n - 2], x[n - 2] - x[n - 3], Secant(n - 2), Secant(n - 3));
+	}
 
-		return x1;
+	double HermiteInterpolate(double x0, double x1, double y0, double y1, double d0, double d1, double t) {
+		double h = x1 - x0;
+		double s = (t - x0) / h;
+		double s2 = s * s, s3 = s2 * s;
+		return (2*s3 - 3*s2 + 1) * y0 + (s3 - 2*s2 + s) * h * d0 + (-2*s3 + 3*s2) * y1 + (s3 - s2) * h * d1;
 	}
 
 	/*	Function to print volatility surface to std::cout. */
@@ -8,6 +8,10 @@
 #include <cmath>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <cstdint>
 
 namespace math_constants 
 {
@@ -48,10 +52,11 @@ namespace eigen_utils
 		}
 	}
 
-	// Probability density function for normal distribution applied element-wise to array
+	// Probability density function for normal distribution applied element-wise to array, in the array's scalar type (e.g. float)
 	template <typename Derived>
 	Derived NormPDF(const Eigen::ArrayBase<Derived>& a, double mu = 0, double sigma = 1) {
-		return (1 / (sigma * std::sqrt(2*math_constants::pi))) * ((-0.5 * (((a - mu) / sigma).pow(2))).exp());
+		typedef typename Derived::Scalar Scalar;
+		return Scalar(1 / (sigma * std::sqrt(2*math_constants::pi))) * ((Scalar(-0.5) * (((a - Scalar(mu)) / Scalar(sigma)).pow(2))).exp());
 	}
 }
 
@@ -69,6 +74,22 @@ namespace data_utils
 	/*	Function to generate a GBM sample path with given parameters.
 		Fills in the column vector/(N+1)x1 array S (correct size initialisation not required). */
 	void GenerateGBMData(Eigen::ArrayXXd& S, double S_0, double mu, double sigma, int T_years, int seed);
+	/*
+	Generates n_paths GBM sample paths at once, filling the columns of the (N+1) x n_paths array S (N = 252*T_years days).
+	Column m holds path number first_path + m of the stream given by seed: its normal draws come from a counter-based 
+	generator (Philox4x32, see philox.h) keyed on seed and counted by path number and position, so every path is the 
+	same whatever first_path, n_paths or n_threads, and a large set of paths can be built in pieces or in parallel. 
+	The draws are made by Box-Muller on whole arrays of uniforms, and each path is S_0 times the exponential of the 
+	cumulative sum of its log-returns. n_threads > 1 spreads the paths over a thread pool. */
+	void GenerateGBMPaths(Eigen::ArrayXXd& S, double S_0, double mu, double sigma, int T_years, int n_paths, uint64_t seed, uint64_t first_path = 0, int n_threads = 1);
+
+	// Names of the files in directory ending in extension (e.g. ".csv"), sorted. Empty if the directory can't be read.
+	std::vector<std::string> ListFiles(const std::string& directory, const std::string& extension);
+
+	/*
+	Writes a BEV surface to a CSV file, with a header row of the strikes and one row per maturity (the first column 
+	holding the maturity in months). Returns false if the file can't be written. */
+	bool WriteSurfaceCSV(const std::string& csv_path, const std::vector<double>& strikes, const std::vector<int>& maturities, const Eigen::ArrayXXd& surface);
 }
 
 namespace norm_dbn_utils
@@ -85,12 +106,217 @@ namespace bev_utils {
 	/*
 	Utility functions for the break-even volatility methodology and the optimisation processes it requires.
 	*/
-	// double RootByNewtonsMethod() // need derivative of pnl function wrt sigma
+	// Why a root finder stopped
+	enum class RootStop {
+		None,			// still running
+		XTol,			// the step (or bracket) became no larger than xtol
+		FTol,			// |f| fell to ftol or below
+		MaxIterations,	// the iteration limit was reached
+		NonFinite		// f or the iterate became NaN or infinite
+	};
+
+	/*
+	Summary of a root-finding run. Evaluations counts calls of the function passed to the solver, where a call returning
+	both the value and the derivative counts once, as it requires a single pass over the path data. */
+	struct RootResult {
+		double root = std::numeric_limits<double>::quiet_NaN();
+		int iterations = 0;
+		int evaluations = 0;
+		bool converged = false;
+		RootStop stop = RootStop::None;
+	};
+
+	/*
+	Step-wise form of the secant method below. The member x holds the point at which f must be evaluated next: feed f(x) 
+	to Update until it returns false, at which point result holds the root. This lets many independent solves be advanced 
+	in lockstep (see BEV::SetBatchedSolve). The iterates are identical to those of RootBySecantMethod. */
+	class SecantStepper {
+		double x0_, fx0_ = 0, x1_;
+		double xtol_, ftol_;
+		int max_iterations_;
+		int stage_ = 0; // 0 => awaiting f(x0), 1 => awaiting the first f(x1), 2 => awaiting f(x1) of a later iteration
+
+		// dx and f are the step and value the stopping conditions were checked against
+		bool Finish(double dx, double f) {
+			x = x1_;
+			result.root = x1_;
+			if (!std::isfinite(x1_))
+				result.stop = RootStop::NonFinite;
+			else if (std::abs(dx) <= xtol_)
+				result.stop = RootStop::XTol;
+			else if (std::abs(f) <= ftol_)
+				result.stop = RootStop::FTol;
+			else
+				result.stop = RootStop::NonFinite;
+			result.converged = result.stop != RootStop::NonFinite;
+			return false;
+		}
+
+	public:
+		double x;
+		RootResult result;
+
+		SecantStepper(double x0, double initial_step_size = 0.01, double xtol = 1e-12, double ftol = 1e-12, int max_iterations = 100)
+			: x0_(x0), x1_(x0 - initial_step_size), xtol_(xtol), ftol_(ftol), max_iterations_(max_iterations), x(x0) {}
+
+		// Takes f(x) and returns true while another evaluation (at the updated x) is needed.
+		bool Update(double f) {
+			result.evaluations++;
+			if (stage_ == 0) {
+				fx0_ = f;
+				x = x1_;
+				stage_ = 1;
+				return true;
+			}
+			// two stopping conditions, one for x convergence and then another condition where x-axis is near parallel to f (f asymptotically approaches zero as x->0)
+			if (stage_ == 1 && !((std::abs(x1_ - x0_) > xtol_) && (std::abs(f) > ftol_)))
+				return Finish(x1_ - x0_, f);
+			stage_ = 2;
+			double m = (f - fx0_) / (x1_ - x0_);
+			double next_x = x0_ - fx0_/m;
+			x0_ = x1_;
+			fx0_ = f;
+			x1_ = next_x;
+			result.iterations++;
+			// as in the original loop, the f-tolerance is checked against the value at the previous iterate
+			if (!((std::abs(x1_ - x0_) > xtol_) && (std::abs(fx0_) > ftol_)))
+				return Finish(x1_ - x0_, fx0_);
+			x = x1_;
+			if (result.iterations >= max_iterations_) { // e.g. cycling in the noise of a float PnL, which never meets ftol
+				result.root = x1_;
+				result.stop = RootStop::MaxIterations;
+				result.converged = false;
+				return false;
+			}
+			return true;
+		}
+	};
 
 	// Function returns the root of the inputted function f (usage with lambda function) via the secant method,
 	// like Newton's method but uses approx. derivative.
-	// Parameters: x0 = starting point, initial_step_size to calculate first secant, xtol/ftol for convergence/stopping criteria
-	double RootBySecantMethod(std::function<double(double)> f, double x0, double initial_step_size = 0.01, double xtol = 1e-12, double ftol = 1e-12);
+	// Parameters: x0 = starting point, initial_step_size to calculate first secant, xtol/ftol for convergence/stopping criteria,
+	// result (optional) to report iteration/evaluation counts, max_iterations as a safeguard against functions without a root.
+	// Templated on the callable so lambdas are called directly rather than through std::function.
+	template <typename F>
+	double RootBySecantMethod(F f, double x0, double initial_step_size = 0.01, double xtol = 1e-12, double ftol = 1e-12, RootResult* result = nullptr, int max_iterations = 100) {
+		SecantStepper stepper(x0, initial_step_size, xtol, ftol, max_iterations);
+		while (stepper.Update(f(stepper.x)));
+		if (result)
+			*result = stepper.result;
+		return stepper.result.root;
+	}
+
+	/*
+	Step-wise form of the safeguarded Newton-Brent method below, used in the same way as SecantStepper except that Update
+	takes both f(x) and f'(x). */
+	class NewtonBrentStepper {
+		double lower_, upper_;
+		double xtol_, ftol_;
+		int max_iterations_;
+		double x_pos_ = 0, f_pos_ = 0, x_neg_ = 0, f_neg_ = 0; // last points with f > 0 and f < 0
+		bool have_pos_ = false, have_neg_ = false;
+		double x_prev_, f_prev_ = std::numeric_limits<double>::infinity(); // previous iterate
+		double width_prev_; // bracket width before the previous step
+
+		bool Finish(RootStop stop) {
+			result.root = x;
+			result.stop = stop;
+			result.converged = stop == RootStop::XTol || stop == RootStop::FTol;
+			return false;
+		}
+
+	public:
+		double x;
+		RootResult result;
+
+		NewtonBrentStepper(double x0, double lower, double upper, double xtol = 1e-12, double ftol = 1e-12, int max_iterations = 100)
+			: lower_(lower), upper_(upper), xtol_(xtol), ftol_(ftol), max_iterations_(max_iterations)
+			, x(std::min(std::max(x0, lower), upper)) 
+		{
+			x_prev_ = x;
+			width_prev_ = upper - lower;
+		}
+
+		// Takes f(x) and f'(x) and returns true while another evaluation (at the updated x) is needed.
+		bool Update(double f, double df) {
+			result.evaluations++;
+			if (!std::isfinite(f))
+				return Finish(RootStop::NonFinite);
+			if (std::abs(f) <= ftol_)
+				return Finish(RootStop::FTol);
+			if (f > 0) {
+				x_pos_ = x; f_pos_ = f; have_pos_ = true;
+			} else {
+				x_neg_ = x; f_neg_ = f; have_neg_ = true;
+			}
+			bool bracketed = have_pos_ && have_neg_;
+			double lo = bracketed ? std::min(x_pos_, x_neg_) : lower_;
+			double hi = bracketed ? std::max(x_pos_, x_neg_) : upper_;
+
+			double next_x = x - f/df;
+			bool newton_ok = std::isfinite(next_x) && next_x > lo && next_x < hi && std::abs(f) <= 0.5*std::abs(f_prev_);
+			if (!newton_ok) {
+				if (bracketed) {
+					double secant_x = x_neg_ - f_neg_ * (x_pos_ - x_neg_) / (f_pos_ - f_neg_);
+					double width = hi - lo;
+					bool secant_ok = std::isfinite(secant_x) && secant_x > lo && secant_x < hi && width <= 0.5*width_prev_;
+					next_x = secant_ok ? secant_x : 0.5*(lo + hi);
+					width_prev_ = width;
+				} else {
+					// no bracket yet, fall back to a secant step through the previous point, else move halfway to the bound 
+					// in the direction of the step (downwards when neither step is usable)
+					double secant_x = result.iterations > 0 ? x - f * (x - x_prev_) / (f - f_prev_) : std::numeric_limits<double>::quiet_NaN();
+					if (std::isfinite(secant_x) && secant_x > lower_ && secant_x < upper_)
+						next_x = secant_x;
+					else {
+						bool up = std::isfinite(secant_x) ? secant_x > x : (std::isfinite(next_x) ? next_x > x : false);
+						next_x = up ? 0.5*(x + upper_) : 0.5*(x + lower_);
+					}
+				}
+			}
+			x_prev_ = x;
+			f_prev_ = f;
+			result.iterations++;
+
+			bool converged = std::abs(next_x - x) <= xtol_ || (bracketed && hi - lo <= xtol_);
+			x = next_x;
+			if (converged)
+				return Finish(RootStop::XTol);
+			if (result.iterations >= max_iterations_)
+				return Finish(RootStop::MaxIterations);
+			return true;
+		}
+	};
+
+	/*
+	Safeguarded Newton root finder (Newton steps with a Brent-style secant/bisection fallback) for a function whose 
+	derivative is available. fdf(x) must return std::pair<double, double> holding f(x) and f'(x).
+	Parameters: x0 = starting point, [lower, upper] = hard bounds on the root, xtol/ftol for convergence/stopping criteria
+	(same meaning as in RootBySecantMethod), max_iterations as a safeguard against functions without a root.
+	The solver keeps the last points found on each side of the root as a bracket. A Newton step is accepted when it stays 
+	inside the bracket (or the bounds, until a sign change has been seen) and the previous step at least halved |f|. Otherwise, 
+	once bracketed, a secant step through the bracket ends is taken, or bisection when that secant would not shrink the 
+	bracket quickly enough. Before a bracket is found, rejected steps fall back to a secant step through the previous iterate 
+	(as RootBySecantMethod would take), which copes with the local minima the PnL function can have for far out-of-the-money
+	strikes. */
+	template <typename FDF>
+	RootResult RootByNewtonBrent(FDF fdf, double x0, double lower, double upper, double xtol = 1e-12, double ftol = 1e-12, int max_iterations = 100) {
+		NewtonBrentStepper stepper(x0, lower, upper, xtol, ftol, max_iterations);
+		std::pair<double, double> fx;
+		do {
+			fx = fdf(stepper.x);
+		} while (stepper.Update(fx.first, fx.second));
+		return stepper.result;
+	}
+
+	/*
+	Slopes at the n >= 2 nodes (x, y) of the monotone piecewise cubic Hermite interpolant (PCHIP, Fritsch-Carlson), for 
+	use with HermiteInterpolate. x must be increasing. Interior slopes are weighted harmonic means of the neighbouring 
+	secants, or 0 where the data turns, so the interpolant is monotone wherever the data is and never overshoots it. The 
+	end slopes are one-sided three-point estimates, limited in the same spirit (as in Moler's pchip). */
+	void PchipSlopes(const double* x, const double* y, int n, double* slopes);
+	// Value at t of the cubic with values y0, y1 and slopes d0, d1 at x0 and x1 (t normally in [x0, x1])
+	double HermiteInterpolate(double x0, double x1, double y0, double y1, double d0, double d1, double t);
 
 	/*	Function to print volatility surface to std::cout. */
 	void PrintResults(std::vector<double> strikes, std::vector<int> maturities, Eigen::ArrayXXd volatilities, int decimal_precision = 4);
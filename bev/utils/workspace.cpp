@@ -0,0 +1,115 @@
+#include "workspace.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace bev_utils
+{
+	// Definition of the in-class constant, which std::max (taking references) odr-uses; C++14 has no inline variables
+	const size_t ScratchArena::kAlignment;
+
+	ScratchArena::ScratchArena(size_t bytes) {
+		AddBlock(std::max(bytes, kAlignment));
+	}
+
+	// Blocks are over-allocated by kAlignment so that their usable space can start on an aligned address
+	void ScratchArena::AddBlock(size_t size) {
+		blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size + kAlignment]), size});
+		heap_allocations_++;
+	}
+
+	/*
+	Allocates from the current block, moving on to the next block (after a Frame rewound the arena to an earlier one),
+	or adding a block of at least twice the arena's capacity once the last is full. */
+	void* ScratchArena::AllocateBytes(size_t bytes) {
+		bytes = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+		while (true) {
+			if (block_ < blocks_.size()) {
+				Block& block = blocks_[block_];
+				if (offset_ + bytes <= block.size) {
+					uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+					char* aligned = reinterpret_cast<char*>((base + kAlignment - 1) / kAlignment * kAlignment);
+					void* buffer = aligned + offset_;
+					offset_ += bytes;
+					return buffer;
+				}
+				if (block_ + 1 < blocks_.size()) {
+					block_++;
+					offset_ = 0;
+					continue;
+				}
+			}
+			AddBlock(std::max(bytes, 2 * Capacity()));
+			block_ = blocks_.size() - 1;
+			offset_ = 0;
+		}
+	}
+
+	void ScratchArena::Reset() {
+		if (blocks_.size() > 1) {
+			size_t capacity = Capacity();
+			blocks_.clear();
+			AddBlock(capacity);
+		}
+		block_ = 0;
+		offset_ = 0;
+	}
+
+	size_t ScratchArena::Capacity() const {
+		size_t capacity = 0;
+		for (const Block& block : blocks_)
+			capacity += block.size;
+		return capacity;
+	}
+
+	Workspace::Lease::~Lease() {
+		if (arena_)
+			workspace_->Release(arena_);
+	}
+
+	Workspace::Workspace(size_t arena_bytes, int n_arenas) : arena_bytes_(arena_bytes) {
+		for (int k = 0; k < n_arenas; k++) {
+			arenas_.emplace_back(new ScratchArena(arena_bytes_));
+			free_.push_back(arenas_.back().get());
+		}
+	}
+
+	Workspace::Lease Workspace::Acquire() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (free_.empty()) {
+			arenas_.emplace_back(new ScratchArena(arena_bytes_));
+			free_.reserve(arenas_.size()); // so that Release never allocates
+			heap_allocations_++;
+			return Lease(this, arenas_.back().get());
+		}
+		ScratchArena* arena = free_.back();
+		free_.pop_back();
+		return Lease(this, arena);
+	}
+
+	void Workspace::Release(ScratchArena* arena) {
+		arena->Reset();
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_.push_back(arena);
+	}
+
+	int Workspace::NumArenas() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return arenas_.size();
+	}
+
+	size_t Workspace::Capacity() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		size_t capacity = 0;
+		for (const std::unique_ptr<ScratchArena>& arena : arenas_)
+			capacity += arena->Capacity();
+		return capacity;
+	}
+
+	long Workspace::HeapAllocations() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		long allocations = heap_allocations_;
+		for (const std::unique_ptr<ScratchArena>& arena : arenas_)
+			allocations += arena->HeapAllocations();
+		return allocations;
+	}
+}
@@ -0,0 +1,124 @@
+#ifndef BEV_WORKSPACE_H
+#define BEV_WORKSPACE_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace bev_utils
+{
+	// Bump allocator over a list of blocks, only ever used by one thread at a time, see Workspace
+	class ScratchArena {
+		struct Block {
+			std::unique_ptr<char[]> data;
+			size_t size;
+		};
+		std::vector<Block> blocks_;
+		size_t block_ = 0; // block allocations are currently made from
+		size_t offset_ = 0; // bytes used in that block
+		long heap_allocations_ = 0; // blocks allocated over the arena's lifetime
+
+		void AddBlock(size_t size);
+		void* AllocateBytes(size_t bytes);
+
+	public:
+		// Alignment of every buffer, a cache line, which also suits any SIMD packet loads made from them
+		static const size_t kAlignment = 64;
+
+		explicit ScratchArena(size_t bytes);
+		ScratchArena(const ScratchArena&) = delete;
+		ScratchArena& operator=(const ScratchArena&) = delete;
+
+		// Uninitialised space for n objects of type T, which the caller must construct or assign before reading.
+		// Only for types that don't need destroying, as the arena releases memory without running destructors.
+		template <typename T>
+		T* Allocate(size_t n) {
+			static_assert(std::is_trivially_destructible<T>::value, "Arena buffers are released without calling destructors.");
+			static_assert(alignof(T) <= kAlignment, "Arena buffers are only aligned to kAlignment.");
+			return static_cast<T*>(AllocateBytes(n * sizeof(T)));
+		}
+		// Space for n copies of value
+		template <typename T>
+		T* Allocate(size_t n, const T& value) {
+			T* buffer = Allocate<T>(n);
+			for (size_t k = 0; k < n; k++)
+				new (buffer + k) T(value);
+			return buffer;
+		}
+
+		/*
+		Marks the current position of the arena and rewinds it there when destroyed, releasing everything allocated in
+		between. Lets a function called many times per solve (e.g. once per lockstep round) reuse the same space. */
+		class Frame {
+			ScratchArena& arena_;
+			size_t block_, offset_;
+		public:
+			explicit Frame(ScratchArena& arena) : arena_(arena), block_(arena.block_), offset_(arena.offset_) {};
+			~Frame() { arena_.block_ = block_; arena_.offset_ = offset_; };
+			Frame(const Frame&) = delete;
+			Frame& operator=(const Frame&) = delete;
+		};
+
+		// Releases every buffer, merging the blocks into one when the arena has grown
+		void Reset();
+		size_t Capacity() const; // bytes held in all blocks
+		long HeapAllocations() const { return heap_allocations_; };
+	};
+
+	/*
+	Scratch memory for the root solves of BEV::SolveForBEV (and Bootstrap): the lane arrays of the lockstep solves, the
+	starting points of the subpath solves, bootstrap resamples and the like, which would otherwise be heap allocated for
+	every cell. A Workspace holds a pool of arenas. Each solve task leases one, carves its buffers out of it by bumping an
+	offset, and hands it back (rewound) when done, so the same memory serves every cell, surface and, when shared between
+	BEV objects (see BEV::SetWorkspace), every ticker. An arena grows by adding heap blocks when a solve needs more than
+	it holds, and merges them into one block of the combined size once rewound, so after the first solve of a surface the
+	solves of surfaces of the same shape draw all their scratch memory from the arenas without allocating.
+	USAGE:	Workspace::Lease scratch = workspace.Acquire();
+			double* sigmas = scratch->Allocate<double>(n_lanes);
+			Leases are taken by one thread each, while the Workspace itself may be shared between threads. */
+	class Workspace {
+	public:
+		/*
+		Exclusive use of one of the workspace's arenas, returned to the workspace (and rewound) on destruction. */
+		class Lease {
+			Workspace* workspace_ = nullptr;
+			ScratchArena* arena_ = nullptr;
+		public:
+			Lease(Workspace* workspace, ScratchArena* arena) : workspace_(workspace), arena_(arena) {};
+			Lease(Lease&& other) : workspace_(other.workspace_), arena_(other.arena_) { other.arena_ = nullptr; };
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+			Lease& operator=(Lease&&) = delete;
+			~Lease();
+			ScratchArena& operator*() const { return *arena_; };
+			ScratchArena* operator->() const { return arena_; };
+		};
+
+	private:
+		std::mutex mutex_; // guards the lists of arenas
+		std::vector<std::unique_ptr<ScratchArena>> arenas_; // every arena created, leased or not
+		std::vector<ScratchArena*> free_; // arenas not currently leased
+		size_t arena_bytes_; // initial size of new arenas
+		long heap_allocations_ = 0; // arenas created by Acquire
+		void Release(ScratchArena* arena);
+
+	public:
+		// Pre-sizes n_arenas arenas (e.g. one per solver thread) of arena_bytes each. More are created when more are leased at once.
+		explicit Workspace(size_t arena_bytes = 64 * 1024, int n_arenas = 1);
+		Workspace(const Workspace&) = delete;
+		Workspace& operator=(const Workspace&) = delete;
+
+		// Leases a free arena, creating one if all are in use
+		Lease Acquire();
+		// Arenas created so far, the bytes they hold and the heap allocations made by them (and by Acquire) over the workspace's 
+		// lifetime. Only exact between solves, as leased arenas may be growing.
+		int NumArenas();
+		size_t Capacity();
+		long HeapAllocations();
+	};
+}
+
+#endif
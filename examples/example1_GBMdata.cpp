@@ -5,7 +5,7 @@
 	
 	Compilation: Must include paths to Eigen library, bev and utils. Must link bev.cpp and utils.cpp as well (or their respective object files).
 	Compile with (for example, if using GCC):
-		g++ -I path/to/eigen -I ../bev -I ../bev/utils -o example1 example1_GBMdata.cpp ../bev/bev.cpp ../bev/utils/utils.cpp
+		g++ -I path/to/eigen -pthread -I ../bev -I ../bev/utils -o example1 example1_GBMdata.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
 	or with CMake (when building entire repo).
 */
 
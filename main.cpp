@@ -2,7 +2,7 @@
 	Calculating the break-even volatility surface for Google/Alphabet's share price from 2018-2023.
 
 	Compile with:
-		g++ -I path/to/eigen -I path/to/bev -I path/to/utils -o main main.cpp bev.cpp utils.cpp
+		g++ -pthread -I path/to/eigen -I path/to/bev -I path/to/utils -o main main.cpp bev.cpp pnl_context.cpp utils.cpp thread_pool.cpp csv_loader.cpp mapped_file.cpp price_cache.cpp result_cache.cpp workspace.cpp
 	or with cmake.
 */
 #include <iostream>
@@ -0,0 +1,53 @@
+/*
+	Solves the BEV surface of every price series in a directory (CSV files such as GOOG.csv, and/or price caches built
+	by csv_to_cache) on a shared strike/maturity grid with bev::SolveBatch (see batch.h), writing 
+	<output directory>/<name>_surface.csv for every <input directory>/<name>.csv or <name>.bevc. Series which can't be
+	loaded or are too short for the longest maturity are reported and skipped. Prints the throughput in tickers per second.
+
+	Usage:	batch_surfaces <input directory> <output directory> [threads, default all cores] [max series resident, default 2 x threads]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o batch_surfaces batch_surfaces.cpp ../bev/batch.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/csv_loader.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/mapped_file.cpp ../bev/utils/thread_pool.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "utils.h"
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "Usage: batch_surfaces <input directory> <output directory> [threads, default all cores] [max series resident, default 2 x threads]" << std::endl;
+		return 1;
+	}
+	std::string input_dir = argv[1], output_dir = argv[2];
+
+	std::vector<std::string> names = data_utils::ListFiles(input_dir, ".csv");
+	std::vector<std::string> caches = data_utils::ListFiles(input_dir, ".bevc");
+	names.insert(names.end(), caches.begin(), caches.end());
+	std::vector<std::string> paths;
+	for (const std::string& name : names)
+		paths.push_back(input_dir + "/" + name);
+
+	bev::BatchSettings settings;
+	settings.strikes = {0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.15, 1.2};
+	settings.maturities = {1, 2, 3, 6, 9, 12};
+	settings.n_threads = argc > 3 ? std::stoi(argv[3]) : 0;
+	settings.max_resident = argc > 4 ? std::stoi(argv[4]) : 0;
+
+	bev::BatchStats stats = bev::SolveBatch(paths, settings, [&] (const bev::SeriesResult& result) {
+		const std::string& name = names[result.index];
+		if (!result.error.empty()) {
+			std::cerr << "Skipping " << result.path << ": " << result.error << std::endl;
+			return;
+		}
+		std::string surface_path = output_dir + "/" + name.substr(0, name.rfind('.')) + "_surface.csv";
+		if (!data_utils::WriteSurfaceCSV(surface_path, settings.strikes, settings.maturities, result.surface))
+			std::cerr << "Could not write " << surface_path << std::endl;
+	});
+
+	std::cout << "Solved " << stats.n_series - stats.n_failed << " of " << stats.n_series << " series in " << stats.seconds 
+		<< " s (" << stats.SeriesPerSecond() << " tickers/s)" << std::endl;
+	return stats.n_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+/*
+	Resident BEV query server (see query_server.h for the protocol). Keeps the price series loaded with LOAD, and the
+	surfaces solved on them, for as long as it runs, so repeated queries from risk tools are answered from memory rather
+	than by a new process re-reading the CSV and re-solving. Serves stdin/stdout (one request per line, e.g. when
+	started as a co-process), or a Unix domain socket when a socket path is given.
+
+	Usage:	bev_server [socket path, default serve stdin/stdout] [threads per solve, default 1] [interest rate, default 0.015]
+	Example:	printf 'LOAD GOOG GOOG.csv\nCELL GOOG PNL 3 1.05\nSURFACE GOOG BEV 1,3,6 0.9,1,1.1\n' | tools/bev_server
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev -I ../bev/utils -o bev_server bev_server.cpp ../bev/query_server.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/csv_loader.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/mapped_file.cpp ../bev/utils/thread_pool.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <string>
+#include "query_server.h"
+
+int main(int argc, char* argv[]) {
+	std::string socket_path = argc > 1 ? argv[1] : "";
+	bev::ServerSettings settings;
+	settings.n_threads = argc > 2 ? std::stoi(argv[2]) : 1;
+	settings.interest_rate = argc > 3 ? std::stod(argv[3]) : 0.015;
+	bev::QueryServer server(settings);
+
+	if (socket_path.empty() || socket_path == "-") {
+		std::ios::sync_with_stdio(false);
+		server.ServeStream(std::cin, std::cout);
+		return 0;
+	}
+	std::string error;
+	std::cerr << "Serving on " << socket_path << std::endl;
+	if (!server.ServeUnixSocket(socket_path, &error)) {
+		std::cerr << "Could not serve on " << socket_path << ": " << error << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,70 @@
+/*
+	Builds binary price caches (see price_cache.h) from a directory of CSV price histories, e.g. Yahoo Finance downloads
+	such as GOOG.csv, writing <cache directory>/<name>.bevc for every <csv directory>/<name>.csv. Every column other than
+	the date column is stored as doubles, and the date column as yyyymmdd integers. Files which can't be parsed (e.g.
+	with "null" prices) are reported and skipped.
+
+	Usage:	csv_to_cache <csv directory> <cache directory> [date column name, default Date] [threads per file, default 1]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -I path/to/eigen -I ../bev/utils -o csv_to_cache csv_to_cache.cpp ../bev/utils/utils.cpp ../bev/utils/csv_loader.cpp ../bev/utils/price_cache.cpp ../bev/utils/mapped_file.cpp ../bev/utils/thread_pool.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "csv_loader.h"
+#include "price_cache.h"
+#include "utils.h"
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "Usage: csv_to_cache <csv directory> <cache directory> [date column name, default Date] [threads per file, default 1]" << std::endl;
+		return 1;
+	}
+	std::string csv_dir = argv[1], cache_dir = argv[2];
+	std::string date_col = argc > 3 ? argv[3] : "Date";
+	int n_threads = argc > 4 ? std::stoi(argv[4]) : 1;
+
+	auto start = std::chrono::steady_clock::now();
+	int n_written = 0, n_failed = 0;
+	for (const std::string& file_name : data_utils::ListFiles(csv_dir, ".csv")) {
+		std::string name = file_name.substr(0, file_name.size() - 4);
+		std::string csv_path = csv_dir + "/" + file_name;
+		std::string cache_path = cache_dir + "/" + name + ".bevc";
+
+		std::vector<std::string> header;
+		data_utils::CSVColumns columns;
+		data_utils::CSVStatus status = data_utils::ReadCSVHeader(csv_path, header);
+		if (status == data_utils::CSVStatus::Ok) {
+			bool has_dates = std::find(header.begin(), header.end(), date_col) != header.end();
+			std::vector<std::string> value_cols;
+			for (const std::string& col : header) {
+				if (col != date_col)
+					value_cols.push_back(col);
+			}
+			status = data_utils::LoadCSVColumns(csv_path, value_cols, columns, n_threads, has_dates ? date_col : "");
+		}
+		if (status != data_utils::CSVStatus::Ok) {
+			std::cerr << csv_path << ": " << data_utils::CSVStatusMessage(status);
+			if (status == data_utils::CSVStatus::ParseError)
+				std::cerr << " on line " << columns.error_line;
+			std::cerr << ", skipped" << std::endl;
+			n_failed++;
+			continue;
+		}
+
+		data_utils::CacheStatus cache_status = data_utils::WritePriceCache(cache_path, columns);
+		if (cache_status != data_utils::CacheStatus::Ok) {
+			std::cerr << cache_path << ": " << data_utils::CacheStatusMessage(cache_status) << ", skipped" << std::endl;
+			n_failed++;
+			continue;
+		}
+		n_written++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Wrote " << n_written << " price caches to " << cache_dir << " (" << n_failed << " files skipped) in " << seconds << " s" << std::endl;
+	return n_failed > 0 ? 2 : 0;
+}
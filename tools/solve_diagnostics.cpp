@@ -0,0 +1,59 @@
+/*
+	Solves the GOOG surface (or that of another CSV) and prints the diagnostics of every cell: root solves, iterations,
+	PnL evaluations, wall time, largest |PnL| at a root, the stopping criteria that fired (x => sigma step tolerance,
+	f => PnL tolerance) and the number of solves which did not converge or ended on a NaN root. Useful for spotting cells
+	(typically far out-of-the-money strikes) where the root finder struggles.
+	Needs the library built with BEV_ENABLE_DIAGNOSTICS defined (cmake -DBEV_DIAGNOSTICS=ON).
+
+	Usage:	solve_diagnostics [path to CSV, default ../GOOG.csv] [column name, default Close] [secant|newton, default secant]
+			[average|subpaths, default average] [batched, to solve skews in lockstep]
+	Compile with (for example, if using GCC):
+		g++ -O2 -pthread -DBEV_ENABLE_DIAGNOSTICS -I path/to/eigen -I ../bev -I ../bev/utils -o solve_diagnostics solve_diagnostics.cpp ../bev/bev.cpp ../bev/pnl_context.cpp ../bev/utils/utils.cpp ../bev/utils/thread_pool.cpp ../bev/utils/csv_loader.cpp ../bev/utils/mapped_file.cpp ../bev/utils/price_cache.cpp ../bev/utils/result_cache.cpp ../bev/utils/workspace.cpp
+	or with CMake (when building entire repo).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "bev.h"
+
+int main(int argc, char* argv[]) {
+	std::string csv_path = argc > 1 ? argv[1] : "../GOOG.csv";
+	std::string col_name = argc > 2 ? argv[2] : "Close";
+	bool newton = argc > 3 && std::string(argv[3]) == "newton";
+	bool average_pnls = !(argc > 4 && std::string(argv[4]) == "subpaths");
+	bool batched = argc > 5 && std::string(argv[5]) == "batched";
+
+	std::vector<double> strikes = {0.80, 0.85, 0.90, 0.95, 1.00, 1.05, 1.10, 1.15, 1.20};
+	std::vector<int> maturities = {1, 2, 3, 4, 5, 6, 9, 12, 15, 18};
+	bev::BEV bev_obj(csv_path, 0.015, strikes, maturities, -1, true, col_name);
+	bev_obj.SetRootFinder(newton ? bev::RootFinder::NewtonBrent : bev::RootFinder::Secant);
+	bev_obj.SetBatchedSolve(batched);
+
+	bev::SolveDiagnostics diagnostics;
+	Eigen::ArrayXXd surface = bev_obj.SolveForBEV(average_pnls, &diagnostics);
+	if (!diagnostics.enabled) {
+		std::cerr << "Diagnostics are disabled: rebuild with BEV_ENABLE_DIAGNOSTICS defined (cmake -DBEV_DIAGNOSTICS=ON)." << std::endl;
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(6) << "term" << std::setw(8) << "strike" << std::right << std::setw(10) << "BEV"
+		<< std::setw(8) << "solves" << std::setw(8) << "iters" << std::setw(8) << "evals" << std::setw(12) << "ms"
+		<< std::setw(12) << "max|PnL|" << std::setw(7) << "x" << std::setw(7) << "f" << std::setw(9) << "failed" << std::setw(6) << "NaN" << std::endl;
+	int n_failed = 0;
+	for (int row = 0; row < diagnostics.rows; row++) {
+		for (int col = 0; col < diagnostics.cols; col++) {
+			const bev::CellDiagnostics& cell = diagnostics.Cell(row, col);
+			n_failed += cell.not_converged;
+			std::cout << std::left << std::fixed << std::setprecision(2) << std::setw(6) << maturities[row] << std::setw(8) << strikes[col]
+				<< std::right << std::setprecision(4) << std::setw(10) << surface(row, col) << std::setw(8) << cell.solves << std::setw(8) << cell.iterations
+				<< std::setw(8) << cell.evaluations << std::setprecision(3) << std::setw(12) << cell.seconds * 1e3 << std::scientific
+				<< std::setprecision(1) << std::setw(12) << cell.max_abs_pnl << std::setw(7) << cell.xtol_stops << std::setw(7) << cell.ftol_stops
+				<< std::setw(9) << cell.not_converged << std::setw(6) << cell.nan_roots << std::endl;
+		}
+	}
+	std::cout << std::fixed << std::setprecision(3) << "Solved in " << diagnostics.seconds << " s, " << n_failed << " solves did not converge." << std::endl;
+	return 0;
+}